@@ -56,8 +56,10 @@ module testbench;
 		.trace_data  (trace_data )
 	);
 
-	reg [7:0] memory [0:256*1024-1];
+	reg [7:0] memory [0:256*1024-1] /* verilator public */;
+`ifndef NO_READMEMH
 	initial $readmemh("dhry.hex", memory);
+`endif
 
 	assign mem_ready = 1;
 
@@ -41,8 +41,10 @@ module testbench;
 		.mem_rdata   (mem_rdata  )
 	);
 
-	reg [7:0] memory [0:256*1024-1];
+	reg [7:0] memory [0:256*1024-1] /* verilator public */;
+`ifndef NO_READMEMH
 	initial $readmemh("dhry.hex", memory);
+`endif
 
 	always @(posedge clk) begin
 		mem_ready <= 1'b0;
@@ -0,0 +1,63 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+
+#include "firmware.h"
+
+// Block device of testbench.v, backed by a host file with
+// "testbench_cli --blkdev=FILE". Without a backing file there are no blocks.
+
+#define BLKDEV_BASE 0x30000000
+
+#define reg_blkdev_cmd     (*(volatile uint32_t*)(BLKDEV_BASE + 0x00))
+#define reg_blkdev_status  (*(volatile uint32_t*)(BLKDEV_BASE + 0x04))
+#define reg_blkdev_block   (*(volatile uint32_t*)(BLKDEV_BASE + 0x08))
+#define reg_blkdev_count   (*(volatile uint32_t*)(BLKDEV_BASE + 0x0c))
+#define reg_blkdev_addr    (*(volatile uint32_t*)(BLKDEV_BASE + 0x10))
+#define reg_blkdev_nblocks (*(volatile uint32_t*)(BLKDEV_BASE + 0x14))
+#define reg_blkdev_blksize (*(volatile uint32_t*)(BLKDEV_BASE + 0x18))
+
+#define BLKDEV_CMD_READ  1
+#define BLKDEV_CMD_WRITE 2
+
+#define BLKDEV_STATUS_IDLE 0
+#define BLKDEV_STATUS_BUSY 1
+
+uint32_t blkdev_nblocks(void)
+{
+	return reg_blkdev_nblocks;
+}
+
+uint32_t blkdev_blksize(void)
+{
+	return reg_blkdev_blksize;
+}
+
+static bool blkdev_cmd(uint32_t cmd, uint32_t block, uint32_t count, uint32_t addr)
+{
+	uint32_t status;
+
+	if (addr & 3)
+		return false;
+
+	reg_blkdev_block = block;
+	reg_blkdev_count = count;
+	reg_blkdev_addr = addr;
+	reg_blkdev_cmd = cmd;
+
+	while ((status = reg_blkdev_status) == BLKDEV_STATUS_BUSY) { }
+	return status == BLKDEV_STATUS_IDLE;
+}
+
+bool blkdev_read(uint32_t block, uint32_t count, void *buf)
+{
+	return blkdev_cmd(BLKDEV_CMD_READ, block, count, (uint32_t)(uintptr_t)buf);
+}
+
+bool blkdev_write(uint32_t block, uint32_t count, const void *buf)
+{
+	return blkdev_cmd(BLKDEV_CMD_WRITE, block, count, (uint32_t)(uintptr_t)buf);
+}
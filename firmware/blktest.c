@@ -0,0 +1,69 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+
+#include "firmware.h"
+
+// Round trip through the block device (make test_blkdev). The host file has
+// at least two blocks, and byte i of block 0 is (i & 255). The test reads
+// block 0, writes block 1 with (i & 255) ^ 0xa5 and reads it back. The
+// Makefile then checks block 1 in the host file.
+
+#define BLKTEST_XOR 0xa5
+
+static uint8_t blktest_buf[512] __attribute__((aligned(4)));
+
+static void blktest_error(const char *what)
+{
+	print_str(what);
+	print_str(" ERROR!\n");
+	__asm__ volatile ("ebreak");
+}
+
+static bool blktest_check(int xor_value)
+{
+	for (int i = 0; i < 512; i++)
+		if (blktest_buf[i] != ((i & 255) ^ xor_value))
+			return false;
+	return true;
+}
+
+void blktest(void)
+{
+	uint32_t nblocks = blkdev_nblocks();
+
+	print_str("blkdev   ");
+	print_dec(nblocks);
+	print_str(" blocks of ");
+	print_dec(blkdev_blksize());
+	print_str(" bytes\n");
+
+	if (nblocks < 2 || blkdev_blksize() != 512) {
+		blktest_error("blkdev size");
+		return;
+	}
+
+	if (!blkdev_read(0, 1, blktest_buf) || !blktest_check(0)) {
+		blktest_error("blkdev read ");
+		return;
+	}
+
+	for (int i = 0; i < 512; i++)
+		blktest_buf[i] = (i & 255) ^ BLKTEST_XOR;
+	if (!blkdev_write(1, 1, blktest_buf)) {
+		blktest_error("blkdev write");
+		return;
+	}
+
+	for (int i = 0; i < 512; i++)
+		blktest_buf[i] = 0;
+	if (!blkdev_read(1, 1, blktest_buf) || !blktest_check(BLKTEST_XOR)) {
+		blktest_error("blkdev read back");
+		return;
+	}
+
+	print_str("blkdev   read/write OK\n");
+}
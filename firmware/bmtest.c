@@ -0,0 +1,516 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+
+// Test and benchmark for the bit-manipulation coprocessor (ENABLE_BITMANIP):
+// every instruction is compared with a C reference on random operands, then
+// CRC32, GHASH and AES-128 run with the new instructions (and CRC32 and
+// GHASH also without) and print their cycles per byte. Each kernel is a ROI,
+// so testbench_cli reports the same numbers.
+
+#include "firmware.h"
+
+// The firmware is compiled for rv32i, so the instructions are written as
+// .insn (opcode, funct3, funct7 or immediate)
+
+#define BM_OP(name, funct3, funct7) \
+	static inline uint32_t name(uint32_t a, uint32_t b) \
+	{ \
+		uint32_t r; \
+		__asm__ (".insn r 0x33, " #funct3 ", " #funct7 ", %0, %1, %2" : "=r"(r) : "r"(a), "r"(b)); \
+		return r; \
+	}
+
+#define BM_OPIMM(name, funct3, imm) \
+	static inline uint32_t name(uint32_t a) \
+	{ \
+		uint32_t r; \
+		__asm__ (".insn i 0x13, " #funct3 ", %0, %1, " #imm : "=r"(r) : "r"(a)); \
+		return r; \
+	}
+
+BM_OP(hard_clmul,  1, 0x05)
+BM_OP(hard_clmulr, 2, 0x05)
+BM_OP(hard_clmulh, 3, 0x05)
+BM_OP(hard_andn,   7, 0x20)
+BM_OP(hard_orn,    6, 0x20)
+BM_OP(hard_xnor,   4, 0x20)
+BM_OP(hard_rol,    1, 0x30)
+BM_OP(hard_ror,    5, 0x30)
+BM_OP(hard_pack,   4, 0x04)
+BM_OP(hard_packh,  7, 0x04)
+BM_OP(hard_xperm4, 2, 0x14)
+BM_OP(hard_xperm8, 4, 0x14)
+
+BM_OPIMM(hard_rori8,  5, 0x608)
+BM_OPIMM(hard_rori16, 5, 0x610)
+BM_OPIMM(hard_rori24, 5, 0x618)
+BM_OPIMM(hard_brev8,  5, 0x687)
+BM_OPIMM(hard_rev8,   5, 0x698)
+BM_OPIMM(hard_zip,    1, 0x08f)
+BM_OPIMM(hard_unzip,  5, 0x08f)
+
+static uint32_t xorshift32(void) {
+	static uint32_t x = 161803398;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return x;
+}
+
+static inline unsigned int rdcycle(void)
+{
+	unsigned int c;
+	__asm__ volatile ("rdcycle %0" : "=r"(c));
+	return c;
+}
+
+// ------------------------------------------------------------------------
+// C references
+
+static uint64_t soft_clmul(uint32_t a, uint32_t b)
+{
+	uint64_t p = 0;
+	for (int i = 0; i < 32; i++)
+		if ((b >> i) & 1)
+			p ^= (uint64_t)a << i;
+	return p;
+}
+
+static uint32_t soft_ror(uint32_t a, uint32_t b)
+{
+	b &= 31;
+	return (a >> b) | (a << ((32 - b) & 31));
+}
+
+static uint32_t soft_brev8(uint32_t a)
+{
+	uint32_t r = 0;
+	for (int i = 0; i < 32; i++)
+		if ((a >> i) & 1)
+			r |= 1u << ((i & ~7) | (7 - (i & 7)));
+	return r;
+}
+
+static uint32_t soft_rev8(uint32_t a)
+{
+	return a << 24 | (a & 0xff00) << 8 | (a >> 8 & 0xff00) | a >> 24;
+}
+
+static uint32_t soft_zip(uint32_t a)
+{
+	uint32_t r = 0;
+	for (int i = 0; i < 16; i++)
+		r |= ((a >> i) & 1) << (2*i) | ((a >> (i + 16)) & 1) << (2*i + 1);
+	return r;
+}
+
+static uint32_t soft_unzip(uint32_t a)
+{
+	uint32_t r = 0;
+	for (int i = 0; i < 16; i++)
+		r |= ((a >> (2*i)) & 1) << i | ((a >> (2*i + 1)) & 1) << (i + 16);
+	return r;
+}
+
+// xperm4 (bits = 4) and xperm8 (bits = 8)
+static uint32_t soft_xperm(uint32_t a, uint32_t b, int bits)
+{
+	uint32_t r = 0, mask = (1u << bits) - 1;
+	for (int i = 0; i < 32; i += bits) {
+		uint32_t idx = (b >> i) & mask;
+		if (idx < 32u / bits)
+			r |= ((a >> (idx * bits)) & mask) << i;
+	}
+	return r;
+}
+
+static bool check(const char *name, uint32_t a, uint32_t b, uint32_t hard, uint32_t soft)
+{
+	if (hard == soft)
+		return true;
+
+	print_str(name);
+	print_str(" ");
+	print_hex(a, 8);
+	print_str(" ");
+	print_hex(b, 8);
+	print_str("  hard ");
+	print_hex(hard, 8);
+	print_str("  soft ");
+	print_hex(soft, 8);
+	print_str("  ERROR!\n");
+	__asm__ volatile ("ebreak");
+	return false;
+}
+
+static bool bmtest_insns(void)
+{
+	for (int i = 0; i < 8; i++)
+	{
+		uint32_t a = xorshift32();
+		uint32_t b = xorshift32();
+		uint64_t p = soft_clmul(a, b);
+
+		// small indices for half of the xperm tests
+		uint32_t idx = i & 1 ? b & 0x33333333 : b;
+
+		if (!check("clmul ", a, b, hard_clmul(a, b),  p)       ||
+		    !check("clmulr", a, b, hard_clmulr(a, b), p >> 31) ||
+		    !check("clmulh", a, b, hard_clmulh(a, b), p >> 32) ||
+		    !check("andn  ", a, b, hard_andn(a, b),   a & ~b) ||
+		    !check("orn   ", a, b, hard_orn(a, b),    a | ~b) ||
+		    !check("xnor  ", a, b, hard_xnor(a, b),   ~(a ^ b)) ||
+		    !check("rol   ", a, b, hard_rol(a, b),    soft_ror(a, 32 - (b & 31))) ||
+		    !check("ror   ", a, b, hard_ror(a, b),    soft_ror(a, b)) ||
+		    !check("rori  ", a, 8, hard_rori8(a),     soft_ror(a, 8)) ||
+		    !check("rori  ", a, 24, hard_rori24(a),   soft_ror(a, 24)) ||
+		    !check("pack  ", a, b, hard_pack(a, b),   (a & 0xffff) | b << 16) ||
+		    !check("packh ", a, b, hard_packh(a, b),  (a & 0xff) | (b & 0xff) << 8) ||
+		    !check("brev8 ", a, 0, hard_brev8(a),     soft_brev8(a)) ||
+		    !check("rev8  ", a, 0, hard_rev8(a),      soft_rev8(a)) ||
+		    !check("zip   ", a, 0, hard_zip(a),       soft_zip(a)) ||
+		    !check("unzip ", a, 0, hard_unzip(a),     soft_unzip(a)) ||
+		    !check("xperm4", a, idx, hard_xperm4(a, idx), soft_xperm(a, idx, 4)) ||
+		    !check("xperm8", a, idx, hard_xperm8(a, idx), soft_xperm(a, idx, 8)))
+			return false;
+	}
+	return true;
+}
+
+// ------------------------------------------------------------------------
+// CRC32 (IEEE 802.3, bit-reflected)
+
+#define CRC32_POLY 0xedb88320  // P(x) without x^32, reflected
+#define CRC32_MU   0xfb808b20  // floor(x^64 / P(x)) without x^32, reflected
+
+static uint32_t crc32_soft(uint32_t crc, const uint8_t *p, int n)
+{
+	while (n--) {
+		crc ^= *p++;
+		for (int k = 0; k < 8; k++)
+			crc = (crc >> 1) ^ (CRC32_POLY & -(crc & 1));
+	}
+	return crc;
+}
+
+// Barrett reduction, one word per step: for c = crc ^ word, the quotient of
+// c * x^32 by P(x) is clmulh(c, mu) ^ c and the new CRC is the low half of
+// quotient * P(x). With reflected bits, the low half of a product is clmulr
+// and the high half is clmul shifted left by one.
+static uint32_t crc32_clmul(uint32_t crc, const uint32_t *p, int nwords)
+{
+	while (nwords--) {
+		uint32_t c = crc ^ *p++;
+		uint32_t q = hard_clmul(c, CRC32_MU) << 1 ^ c;
+		crc = hard_clmulr(q, CRC32_POLY);
+	}
+	return crc;
+}
+
+// ------------------------------------------------------------------------
+// GHASH multiplication in GF(2^128) mod x^128 + x^7 + x^2 + x + 1. GCM
+// reflects the bits: bit 7 of byte 0 is the coefficient of x^0.
+
+// Bit by bit (NIST SP 800-38D, algorithm 1), on big-endian words
+static void ghash_mul_soft(uint32_t *x, const uint32_t *h)
+{
+	uint32_t z[4] = {0, 0, 0, 0}, v[4];
+	for (int i = 0; i < 4; i++)
+		v[i] = soft_rev8(h[i]);
+	for (int i = 0; i < 128; i++) {
+		if ((soft_rev8(x[i >> 5]) >> (31 - (i & 31))) & 1)
+			for (int j = 0; j < 4; j++)
+				z[j] ^= v[j];
+		uint32_t lsb = v[3] & 1;
+		v[3] = v[3] >> 1 | v[2] << 31;
+		v[2] = v[2] >> 1 | v[1] << 31;
+		v[1] = v[1] >> 1 | v[0] << 31;
+		v[0] = v[0] >> 1 ^ (0xe1000000 & -lsb);
+	}
+	for (int i = 0; i < 4; i++)
+		x[i] = soft_rev8(z[i]);
+}
+
+// brev8 of the little-endian words gives the polynomial with x^0 in bit 0
+// of word 0. 16 clmul/clmulh pairs for the 256 bit product, then the upper
+// half is folded back with x^128 = x^7 + x^2 + x + 1.
+static void ghash_mul_clmul(uint32_t *x, const uint32_t *h)
+{
+	uint32_t a[4], b[4], p[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+	for (int i = 0; i < 4; i++) {
+		a[i] = hard_brev8(x[i]);
+		b[i] = hard_brev8(h[i]);
+	}
+	for (int i = 0; i < 4; i++)
+		for (int j = 0; j < 4; j++) {
+			p[i+j] ^= hard_clmul(a[i], b[j]);
+			p[i+j+1] ^= hard_clmulh(a[i], b[j]);
+		}
+	for (int k = 7; k >= 4; k--) {
+		uint32_t t = p[k];
+		p[k-4] ^= t ^ t << 1 ^ t << 2 ^ t << 7;
+		p[k-3] ^= t >> 31 ^ t >> 30 ^ t >> 25;
+	}
+	for (int i = 0; i < 4; i++)
+		x[i] = hard_brev8(p[i]);
+}
+
+static void ghash(uint32_t *y, const uint32_t *h, const uint32_t *p, int nblocks, bool clmul)
+{
+	for (int i = 0; i < 4; i++)
+		y[i] = 0;
+	for (; nblocks--; p += 4) {
+		for (int i = 0; i < 4; i++)
+			y[i] ^= p[i];
+		if (clmul)
+			ghash_mul_clmul(y, h);
+		else
+			ghash_mul_soft(y, h);
+	}
+}
+
+// ------------------------------------------------------------------------
+// AES-128 encryption without lookup tables. The S-box inverts in the tower
+// field GF((2^4)^2) = GF(2^4)[y] / (y^2 + y + 8), with GF(2^4) = GF(2)[x] /
+// (x^4 + x + 1). Every GF(2^4) table and the linear maps in and out of the
+// tower field are 16 nibbles (two words), applied to 8 bytes at a time with
+// xperm4. There are no memory accesses that depend on the data, so the
+// encryption takes the same time for every key and plaintext.
+
+// 16-entry nibble tables: entries 0-7 in the first word, 8-15 in the second
+static const uint32_t gf16_x1[2]    = { 0xeca86420, 0xdf9b5713 };  // a * x
+static const uint32_t gf16_x2[2]    = { 0xfb73c840, 0x9d15ae26 };  // a * x^2
+static const uint32_t gf16_x3[2]    = { 0xd5e6b380, 0x192a7f4c };  // a * x^3
+static const uint32_t gf16_sq[2]    = { 0x67235410, 0xabef98dc };  // a^2
+static const uint32_t gf16_sqlam[2] = { 0x5d3be680, 0xf7914c2a };  // a^2 * 8
+static const uint32_t gf16_inv[2]   = { 0x67bde910, 0x834a5c2f };  // a^-1, 0 for 0
+
+// Linear maps from the AES field to the tower field (aes_in) and from the
+// tower field through the affine transformation of the S-box without its
+// constant (aes_out), as high/low output nibble from high/low input nibble
+static const uint32_t aes_in[4][2] = {
+	{ 0xde03ed30, 0x30ed03de }, { 0x66442200, 0x22006644 },
+	{ 0xd18495c0, 0x84d1c095 }, { 0x76761010, 0xbabadcdc }
+};
+static const uint32_t aes_out[4][2] = {
+	{ 0x05366350, 0x63500536 }, { 0x01baab10, 0x32899823 },
+	{ 0x9b75ce20, 0x9b75ce20 }, { 0x694bd2f0, 0x0f2db496 }
+};
+
+static inline uint32_t nib_lookup(const uint32_t *t, uint32_t v)
+{
+	return hard_xperm4(t[0], v) ^ hard_xperm4(t[1], v ^ 0x88888888);
+}
+
+// all ones in the nibbles where bit i of b is set
+static inline uint32_t nib_mask(uint32_t b, int i)
+{
+	uint32_t m = (b >> i) & 0x11111111;
+	return (m << 4) - m;
+}
+
+static inline uint32_t nib_mul(uint32_t a, uint32_t b)
+{
+	return (a & nib_mask(b, 0)) ^
+	       (nib_lookup(gf16_x1, a) & nib_mask(b, 1)) ^
+	       (nib_lookup(gf16_x2, a) & nib_mask(b, 2)) ^
+	       (nib_lookup(gf16_x3, a) & nib_mask(b, 3));
+}
+
+static inline void nib_linear(const uint32_t t[4][2], uint32_t *h, uint32_t *l)
+{
+	uint32_t nh = nib_lookup(t[0], *h) ^ nib_lookup(t[1], *l);
+	uint32_t nl = nib_lookup(t[2], *h) ^ nib_lookup(t[3], *l);
+	*h = nh;
+	*l = nl;
+}
+
+// S-box on the 8 bytes of w[0] and w[1]
+static void aes_sub8(uint32_t *w)
+{
+	uint32_t l = (w[0] & 0x0f0f0f0f) | (w[1] & 0x0f0f0f0f) << 4;
+	uint32_t h = (w[0] >> 4 & 0x0f0f0f0f) | (w[1] & 0xf0f0f0f0);
+
+	nib_linear(aes_in, &h, &l);
+
+	// (h y + l)^-1 = (h y + h + l) / (8 h^2 + h l + l^2)
+	uint32_t d = nib_lookup(gf16_inv, nib_lookup(gf16_sqlam, h) ^ nib_mul(h, l) ^ nib_lookup(gf16_sq, l));
+	l = nib_mul(h ^ l, d);
+	h = nib_mul(h, d);
+
+	nib_linear(aes_out, &h, &l);
+	h ^= 0x66666666;
+	l ^= 0x33333333;
+
+	w[0] = (l & 0x0f0f0f0f) | (h & 0x0f0f0f0f) << 4;
+	w[1] = (l >> 4 & 0x0f0f0f0f) | (h & 0xf0f0f0f0);
+}
+
+// The state is column major, with the bytes of a column in little-endian
+// order in one word
+static void aes_round(uint32_t *s, const uint32_t *rk, bool mix)
+{
+	uint32_t t[4];
+
+	aes_sub8(s);
+	aes_sub8(s + 2);
+
+	for (int c = 0; c < 4; c++)
+		t[c] = (s[c] & 0x000000ff) | (s[(c+1) & 3] & 0x0000ff00) |
+		       (s[(c+2) & 3] & 0x00ff0000) | (s[(c+3) & 3] & 0xff000000);
+
+	for (int c = 0; c < 4; c++) {
+		uint32_t a = t[c];
+		if (mix) {
+			// 2 a[r] ^ 3 a[r+1] ^ a[r+2] ^ a[r+3]
+			uint32_t r = hard_rori8(a);
+			uint32_t x = a ^ r;
+			uint32_t m = x >> 7 & 0x01010101;
+			x = (x & 0x7f7f7f7f) << 1 ^ m << 4 ^ m << 3 ^ m << 1 ^ m;
+			a = x ^ r ^ hard_rori16(a) ^ hard_rori24(a);
+		}
+		s[c] = a ^ rk[c];
+	}
+}
+
+static void aes128_expand(uint32_t *rk, const uint32_t *key)
+{
+	uint32_t rcon = 1;
+	for (int i = 0; i < 4; i++)
+		rk[i] = key[i];
+	for (int i = 4; i < 44; i++) {
+		uint32_t t = rk[i-1];
+		if ((i & 3) == 0) {
+			uint32_t w[2] = { hard_rori8(t), 0 };
+			aes_sub8(w);
+			t = w[0] ^ rcon;
+			rcon = rcon << 1 ^ (0x11b & -(rcon >> 7));
+		}
+		rk[i] = rk[i-4] ^ t;
+	}
+}
+
+static void aes128_encrypt(uint32_t *s, const uint32_t *rk)
+{
+	for (int c = 0; c < 4; c++)
+		s[c] ^= rk[c];
+	for (int r = 1; r < 10; r++)
+		aes_round(s, rk + 4*r, true);
+	aes_round(s, rk + 40, false);
+}
+
+// ------------------------------------------------------------------------
+
+#define NDATA 8  // words
+
+enum {
+	ROI_CRC32_SOFT = 0x0b00,
+	ROI_CRC32_CLMUL,
+	ROI_GHASH_SOFT,
+	ROI_GHASH_CLMUL,
+	ROI_AES128
+};
+
+static void bm_report(const char *name, unsigned int cycles, unsigned int bytes)
+{
+	print_str(name);
+	print_dec(cycles);
+	print_str(" cycles, ");
+	print_dec(cycles / bytes);
+	print_str(".");
+	print_dec((10 * cycles / bytes) % 10);
+	print_str(" cycles/byte\n");
+}
+
+static void bm_error(const char *name)
+{
+	print_str(name);
+	print_str(" ERROR!\n");
+	__asm__ volatile ("ebreak");
+}
+
+void bmtest(void)
+{
+	uint32_t data[NDATA], h[4], y_soft[4], y_clmul[4], rk[44];
+	unsigned int c;
+
+	if (!bmtest_insns())
+		return;
+	print_str("bitmanip insns OK\n");
+
+	for (int i = 0; i < NDATA; i++)
+		data[i] = xorshift32();
+	for (int i = 0; i < 4; i++)
+		h[i] = xorshift32();
+
+	// "123456789"
+	static const uint32_t crc_check[3] = { 0x34333231, 0x38373635, 0x39 };
+	uint32_t crc = crc32_clmul(~0, crc_check, 2);
+	crc = crc32_soft(crc, (const uint8_t *)(crc_check + 2), 1);
+	if (~crc != 0xcbf43926) {
+		bm_error("crc32 check value");
+		return;
+	}
+
+	c = rdcycle();
+	ROI_BEGIN(ROI_CRC32_SOFT);
+	uint32_t crc_soft = crc32_soft(~0, (const uint8_t *)data, 4 * NDATA);
+	ROI_BYTES(4 * NDATA);
+	ROI_END(ROI_CRC32_SOFT);
+	bm_report("crc32 soft   ", rdcycle() - c, 4 * NDATA);
+
+	c = rdcycle();
+	ROI_BEGIN(ROI_CRC32_CLMUL);
+	uint32_t crc_clmul = crc32_clmul(~0, data, NDATA);
+	ROI_BYTES(4 * NDATA);
+	ROI_END(ROI_CRC32_CLMUL);
+	bm_report("crc32 clmul  ", rdcycle() - c, 4 * NDATA);
+
+	if (crc_soft != crc_clmul) {
+		bm_error("crc32");
+		return;
+	}
+
+	c = rdcycle();
+	ROI_BEGIN(ROI_GHASH_SOFT);
+	ghash(y_soft, h, data, NDATA / 4, false);
+	ROI_BYTES(4 * NDATA);
+	ROI_END(ROI_GHASH_SOFT);
+	bm_report("ghash soft   ", rdcycle() - c, 4 * NDATA);
+
+	c = rdcycle();
+	ROI_BEGIN(ROI_GHASH_CLMUL);
+	ghash(y_clmul, h, data, NDATA / 4, true);
+	ROI_BYTES(4 * NDATA);
+	ROI_END(ROI_GHASH_CLMUL);
+	bm_report("ghash clmul  ", rdcycle() - c, 4 * NDATA);
+
+	for (int i = 0; i < 4; i++)
+		if (y_soft[i] != y_clmul[i]) {
+			bm_error("ghash");
+			return;
+		}
+
+	// FIPS-197, appendix C.1
+	static const uint32_t aes_key[4] = { 0x03020100, 0x07060504, 0x0b0a0908, 0x0f0e0d0c };
+	static const uint32_t aes_ct[4] = { 0xd8e0c469, 0x30047b6a, 0x80b7cdd8, 0x5ac5b470 };
+	uint32_t s[4] = { 0x33221100, 0x77665544, 0xbbaa9988, 0xffeeddcc };
+	aes128_expand(rk, aes_key);
+
+	c = rdcycle();
+	ROI_BEGIN(ROI_AES128);
+	aes128_encrypt(s, rk);
+	ROI_BYTES(16);
+	ROI_END(ROI_AES128);
+	bm_report("aes128 xperm ", rdcycle() - c, 16);
+
+	for (int i = 0; i < 4; i++)
+		if (s[i] != aes_ct[i]) {
+			bm_error("aes128");
+			return;
+		}
+}
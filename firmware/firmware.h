@@ -11,6 +11,13 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+// Region-of-interest markers: testbench_cli reports cycles and instructions
+// per ROI id and can restrict tracing to ROIs (--roi-only). ROI_BYTES adds
+// to the bytes processed by the innermost open ROI, for cycles per byte.
+#define ROI_BEGIN(id) (*(volatile uint32_t*)0x20000004 = (id))
+#define ROI_END(id)   (*(volatile uint32_t*)0x20000008 = (id))
+#define ROI_BYTES(n)  (*(volatile uint32_t*)0x2000000c = (n))
+
 // irq.c
 uint32_t *irq(uint32_t *regs, uint32_t irqs);
 
@@ -35,9 +42,26 @@ uint32_t hard_div(uint32_t a, uint32_t b);
 uint32_t hard_divu(uint32_t a, uint32_t b);
 uint32_t hard_rem(uint32_t a, uint32_t b);
 uint32_t hard_remu(uint32_t a, uint32_t b);
+uint32_t hard_mul_mulhu(uint32_t a, uint32_t b, uint32_t *mul);
+uint32_t hard_mulh_mul(uint32_t a, uint32_t b, uint32_t *mulh);
+uint32_t hard_mul_mulh(uint32_t a, uint32_t b, uint32_t *mul);
+uint32_t hard_mul_mulhu_other(uint32_t a, uint32_t b, uint32_t c, uint32_t d, uint32_t *mul);
+uint32_t hard_mul_divu_mulhu(uint32_t a, uint32_t b, uint32_t c, uint32_t d, uint32_t *mul_divu);
 void multest(void);
 
+// bmtest.c
+void bmtest(void);
+
 // stats.c
 void stats(void);
 
+// blkdev.c
+uint32_t blkdev_nblocks(void);
+uint32_t blkdev_blksize(void);
+bool blkdev_read(uint32_t block, uint32_t count, void *buf);
+bool blkdev_write(uint32_t block, uint32_t count, const void *buf);
+
+// blktest.c
+void blktest(void);
+
 #endif
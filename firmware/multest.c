@@ -146,6 +146,35 @@ void multest(void)
 		}
 
 		print_str(" OK\n");
+
+		// Back-to-back pairs (ENABLE_MUL_REUSE): MUL then MULHU on the same
+		// operands, MULH then MUL, MUL then MULH (other signedness), MUL then
+		// MULHU on swapped operands, and MUL, DIVU, MULHU with the DIVU
+		// issued while the multiplier may still run in the background
+		uint32_t p_mul[5], p_high[5], p_mul_divu[2];
+		print_str("hard pairs ");
+
+		p_high[0] = hard_mul_mulhu(a, b, &p_mul[0]);
+		p_mul[1] = hard_mulh_mul(a, b, &p_high[1]);
+		p_high[2] = hard_mul_mulh(a, b, &p_mul[2]);
+		p_high[3] = hard_mul_mulhu_other(a, b, b, a, &p_mul[3]);
+		p_high[4] = hard_mul_divu_mulhu(a, b, a, b, p_mul_divu);
+		p_mul[4] = p_mul_divu[0];
+
+		for (int k = 0; k < 5; k++) {
+			print_hex(p_high[k], 8);
+			print_str("  ");
+		}
+
+		if (p_mul[0] != s_mul || p_high[0] != s_mulhu || p_mul[1] != s_mul || p_high[1] != s_mulh ||
+				p_mul[2] != s_mul || p_high[2] != s_mulh || p_mul[3] != s_mul || p_high[3] != s_mulhu ||
+				p_mul[4] != s_mul || p_high[4] != s_mulhu || p_mul_divu[1] != s_divu) {
+			print_str("ERROR!\n");
+			__asm__ volatile ("ebreak");
+			return;
+		}
+
+		print_str(" OK\n");
 	}
 }
 
@@ -0,0 +1,189 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+
+#include <stdint.h>
+#include "microbench.h"
+
+#define OUTPORT 0x10000000
+
+struct kernel {
+	const char *name;
+	void (*run)(unsigned int result[2]);
+	int loop_overhead;
+};
+
+// KERNEL: asm kernel from kernels.S, the loop overhead (empty kernel) is
+// subtracted. CKERNEL: C kernel (mul64.c, select.c) that reports its whole
+// loop.
+#define KERNEL(_name, _sym) \
+	void mb_ ## _sym(unsigned int result[2]); \
+	static const struct kernel kernel_ ## _sym = { _name, mb_ ## _sym, 1 };
+#define CKERNEL(_name, _sym) \
+	static const struct kernel kernel_ ## _sym = { _name, mb_ ## _sym, 0 };
+
+KERNEL("empty", empty)
+KERNEL("add", add)
+KERNEL("addi", addi)
+KERNEL("sub", sub)
+KERNEL("and", and)
+KERNEL("xor", xor)
+KERNEL("slt", slt)
+KERNEL("sltu", sltu)
+KERNEL("lui", lui)
+KERNEL("auipc", auipc)
+KERNEL("slli_1", slli_1)
+KERNEL("slli_4", slli_4)
+KERNEL("slli_8", slli_8)
+KERNEL("slli_16", slli_16)
+KERNEL("slli_31", slli_31)
+KERNEL("srai_31", srai_31)
+KERNEL("sll_31", sll_31)
+#ifdef __riscv_mul
+KERNEL("mul_8", mul_8)
+KERNEL("mul_16", mul_16)
+KERNEL("mul_32", mul_32)
+KERNEL("mulh_32", mulh_32)
+KERNEL("mulhu_32", mulhu_32)
+KERNEL("div_8", div_8)
+KERNEL("div_16", div_16)
+KERNEL("div_32", div_32)
+KERNEL("divu_32", divu_32)
+KERNEL("rem_32", rem_32)
+KERNEL("mulhu+mul", mulhu_mul)
+KERNEL("mul+mulhu", mul_mulhu)
+KERNEL("mulh+mul", mulh_mul)
+KERNEL("div+8add", div_add8)
+KERNEL("div+dep", div_dep)
+CKERNEL("c:umul32x32", c_umul32x32)
+CKERNEL("c:smul32x32", c_smul32x32)
+CKERNEL("c:umul64x64", c_umul64x64)
+#endif
+KERNEL("lw", lw)
+KERNEL("lh", lh)
+KERNEL("lhu", lhu)
+KERNEL("lb", lb)
+KERNEL("lbu", lbu)
+KERNEL("sw", sw)
+KERNEL("sh", sh)
+KERNEL("sb", sb)
+KERNEL("beq_taken", beq_taken)
+KERNEL("beq_not_taken", beq_not_taken)
+KERNEL("blt_taken", blt_taken)
+KERNEL("blt_not_taken", blt_not_taken)
+KERNEL("jal", jal)
+KERNEL("jalr+ret", jalr_ret)
+CKERNEL("c:minmax", c_minmax)
+CKERNEL("c:clamp", c_clamp)
+CKERNEL("c:select", c_select)
+#ifdef __riscv_zicond
+KERNEL("czero.eqz", czero_eqz)
+#endif
+#ifdef __riscv_compressed
+KERNEL("c.addi", c_addi)
+KERNEL("c.add", c_add)
+KERNEL("c.mv", c_mv)
+KERNEL("c.lw", c_lw)
+KERNEL("c.sw", c_sw)
+KERNEL("c.j", c_j)
+KERNEL("c.beqz", c_beqz)
+KERNEL("c.nop+add", c_nop_add)
+#endif
+#ifdef ENABLE_IRQ
+KERNEL("irq", irq)
+#endif
+
+static const struct kernel *const kernels[] = {
+	&kernel_add, &kernel_addi, &kernel_sub, &kernel_and, &kernel_xor,
+	&kernel_slt, &kernel_sltu, &kernel_lui, &kernel_auipc,
+	&kernel_slli_1, &kernel_slli_4, &kernel_slli_8, &kernel_slli_16,
+	&kernel_slli_31, &kernel_srai_31, &kernel_sll_31,
+#ifdef __riscv_mul
+	&kernel_mul_8, &kernel_mul_16, &kernel_mul_32, &kernel_mulh_32,
+	&kernel_mulhu_32, &kernel_div_8, &kernel_div_16, &kernel_div_32,
+	&kernel_divu_32, &kernel_rem_32, &kernel_mulhu_mul, &kernel_mul_mulhu,
+	&kernel_mulh_mul, &kernel_div_add8, &kernel_div_dep,
+	&kernel_c_umul32x32, &kernel_c_smul32x32, &kernel_c_umul64x64,
+#endif
+	&kernel_lw, &kernel_lh, &kernel_lhu, &kernel_lb, &kernel_lbu,
+	&kernel_sw, &kernel_sh, &kernel_sb,
+	&kernel_beq_taken, &kernel_beq_not_taken, &kernel_blt_taken,
+	&kernel_blt_not_taken, &kernel_jal, &kernel_jalr_ret,
+	&kernel_c_minmax, &kernel_c_clamp, &kernel_c_select,
+#ifdef __riscv_zicond
+	&kernel_czero_eqz,
+#endif
+#ifdef __riscv_compressed
+	&kernel_c_addi, &kernel_c_add, &kernel_c_mv, &kernel_c_lw,
+	&kernel_c_sw, &kernel_c_j, &kernel_c_beqz, &kernel_c_nop_add,
+#endif
+#ifdef ENABLE_IRQ
+	&kernel_irq,
+#endif
+};
+
+static void print_chr(char ch)
+{
+	*((volatile uint32_t*)OUTPORT) = ch;
+}
+
+static void print_str(const char *p)
+{
+	while (*p != 0)
+		print_chr(*(p++));
+}
+
+static void print_dec(unsigned int val)
+{
+	char buffer[10];
+	char *p = buffer;
+	do {
+		*(p++) = '0' + val % 10;
+		val = val / 10;
+	} while (val);
+	while (p != buffer)
+		print_chr(*(--p));
+}
+
+// One line per kernel, parsed by run.py:
+//   mb: <name> <ops> ops <cycles> cycles <instret> instret
+// cycles and instret are the loop deltas, minus those of the empty kernel
+// for asm kernels. A failed self-check prints "mb: ERROR <what>".
+int main(void)
+{
+	unsigned int base[2], result[2];
+	unsigned int ops = MB_ITERS * MB_UNROLL;
+
+#ifdef __riscv_mul
+	if (!mul64_check()) {
+		print_str("mb: ERROR 64-bit products\n");
+		return 1;
+	}
+#endif
+	if (!select_check()) {
+		print_str("mb: ERROR conditional selects\n");
+		return 1;
+	}
+
+	kernel_empty.run(base);
+	for (unsigned int i = 0; i < sizeof(kernels) / sizeof(*kernels); i++) {
+		kernels[i]->run(result);
+		if (kernels[i]->loop_overhead) {
+			result[0] = result[0] > base[0] ? result[0] - base[0] : 0;
+			result[1] = result[1] > base[1] ? result[1] - base[1] : 0;
+		}
+		print_str("mb: ");
+		print_str(kernels[i]->name);
+		print_str(" ");
+		print_dec(ops);
+		print_str(" ops ");
+		print_dec(result[0]);
+		print_str(" cycles ");
+		print_dec(result[1]);
+		print_str(" instret\n");
+	}
+	return 0;
+}
@@ -0,0 +1,29 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+
+#ifndef MICROBENCH_H
+#define MICROBENCH_H
+
+// Every kernel runs MB_ITERS iterations of a loop with MB_UNROLL copies of
+// the measured operation (see kernels.S)
+#define MB_ITERS 64
+#define MB_UNROLL 16
+
+#ifndef __ASSEMBLER__
+// mul64.c
+int mul64_check(void);
+void mb_c_umul32x32(unsigned int result[2]);
+void mb_c_smul32x32(unsigned int result[2]);
+void mb_c_umul64x64(unsigned int result[2]);
+// select.c
+int select_check(void);
+void mb_c_minmax(unsigned int result[2]);
+void mb_c_clamp(unsigned int result[2]);
+void mb_c_select(unsigned int result[2]);
+#endif
+
+#endif
@@ -0,0 +1,143 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+
+// 64-bit math kernels in C, for ENABLE_MUL_REUSE. GCC compiles every 64-bit
+// product to a MUL and a MULH[[S]U] on the same operands. Like
+// firmware/multest.c, the results are checked against a reference that only
+// uses 16x16 bit products (no MULH), so a wrong reused result is caught.
+
+#include <stdint.h>
+#include "microbench.h"
+
+#ifdef __riscv_mul
+
+#define NOPS (MB_ITERS * MB_UNROLL)
+#define NVALS 64
+
+static uint32_t val_a[NVALS], val_b[NVALS];
+
+static uint32_t xorshift32(void)
+{
+	static uint32_t x = 314159265;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return x;
+}
+
+static inline unsigned int rdcycle(void)
+{
+	unsigned int c;
+	__asm__ volatile ("rdcycle %0" : "=r"(c));
+	return c;
+}
+
+static inline unsigned int rdinstret(void)
+{
+	unsigned int c;
+	__asm__ volatile ("rdinstret %0" : "=r"(c));
+	return c;
+}
+
+// 32x32 -> 64 bit unsigned product from 16-bit halves
+static uint64_t ref_umul(uint32_t a, uint32_t b)
+{
+	uint32_t al = a & 0xffff, ah = a >> 16;
+	uint32_t bl = b & 0xffff, bh = b >> 16;
+	uint64_t mid = (uint64_t)(al * bh) + (ah * bl);
+	return ((uint64_t)(ah * bh) << 32) + (mid << 16) + al * bl;
+}
+
+static uint64_t ref_smul(uint32_t a, uint32_t b)
+{
+	uint64_t p = ref_umul(a, b);
+	if (a >> 31)
+		p -= (uint64_t)b << 32;
+	if (b >> 31)
+		p -= (uint64_t)a << 32;
+	return p;
+}
+
+static uint64_t __attribute__((noinline)) umul32x32(uint32_t a, uint32_t b)
+{
+	return (uint64_t)a * b;
+}
+
+static int64_t __attribute__((noinline)) smul32x32(int32_t a, int32_t b)
+{
+	return (int64_t)a * b;
+}
+
+static uint64_t __attribute__((noinline)) umul64x64(uint64_t a, uint64_t b)
+{
+	return a * b;
+}
+
+// Fills the operand table (first call) and checks all kernels against the
+// reference. Returns 0 on a mismatch.
+int mul64_check(void)
+{
+	for (int i = 0; i < NVALS; i++) {
+		val_a[i] = xorshift32();
+		val_b[i] = xorshift32();
+	}
+	val_a[0] = 0x80000000;
+	val_b[0] = 0xffffffff;
+	val_a[1] = val_b[1] = 0xffffffff;
+
+	for (int i = 0; i < NVALS; i++) {
+		uint32_t a = val_a[i], b = val_b[i], c = val_a[(i + 1) % NVALS];
+		if (umul32x32(a, b) != ref_umul(a, b))
+			return 0;
+		// same operands again, now with signed upper halves
+		if ((uint64_t)smul32x32((int32_t)a, (int32_t)b) != ref_smul(a, b))
+			return 0;
+		uint64_t x = (uint64_t)c << 32 | a;
+		if (umul64x64(x, b) != ref_umul(a, b) + ((uint64_t)(c * b) << 32))
+			return 0;
+	}
+	return 1;
+}
+
+// result[0] and result[1] are the cycles and instructions of the whole loop,
+// including the loop and the call (main.c does not subtract the overhead of
+// the empty kernel for these)
+
+void mb_c_umul32x32(unsigned int result[2])
+{
+	uint64_t acc = 0;
+	unsigned int c = rdcycle(), n = rdinstret();
+	for (int i = 0; i < NOPS; i++)
+		acc += umul32x32(val_a[i % NVALS], val_b[i % NVALS]);
+	result[0] = rdcycle() - c;
+	result[1] = rdinstret() - n;
+	__asm__ volatile ("" : : "r"((uint32_t)acc), "r"((uint32_t)(acc >> 32)));
+}
+
+void mb_c_smul32x32(unsigned int result[2])
+{
+	int64_t acc = 0;
+	unsigned int c = rdcycle(), n = rdinstret();
+	for (int i = 0; i < NOPS; i++)
+		acc += smul32x32((int32_t)val_a[i % NVALS], (int32_t)val_b[i % NVALS]);
+	result[0] = rdcycle() - c;
+	result[1] = rdinstret() - n;
+	__asm__ volatile ("" : : "r"((uint32_t)acc), "r"((uint32_t)(acc >> 32)));
+}
+
+void mb_c_umul64x64(unsigned int result[2])
+{
+	uint64_t acc = 0;
+	unsigned int c = rdcycle(), n = rdinstret();
+	for (int i = 0; i < NOPS; i++)
+		acc ^= umul64x64((uint64_t)val_a[(i + 1) % NVALS] << 32 | val_a[i % NVALS], val_b[i % NVALS]);
+	result[0] = rdcycle() - c;
+	result[1] = rdinstret() - n;
+	__asm__ volatile ("" : : "r"((uint32_t)acc), "r"((uint32_t)(acc >> 32)));
+}
+
+#endif
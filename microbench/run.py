@@ -0,0 +1,78 @@
+#!/usr/bin/env python3
+#
+# Per-instruction cost model for a matrix of picorv32 configurations.
+#
+# For every configuration in scripts/ppa/configs.txt, build ppa_tb
+# (scripts/ppa/ppa.v, zero wait state memory) with Verilator using the
+# parameters of the configuration, run the microbenchmark build for its ISA
+# (mb_<isa>.elf, or mb_<isa>_irq.elf with ENABLE_IRQ=1) and print the cycles
+# per operation of every kernel as a markdown table (or CSV with --csv).
+#
+# Usage: run.py [-c CONFIGS] [-j N] [--csv] [CONFIG ...]
+#
+
+import argparse, os, re, sys
+from concurrent.futures import ThreadPoolExecutor
+
+srcdir = os.path.dirname(os.path.abspath(__file__))
+ppadir = os.path.join(srcdir, "..", "scripts", "ppa")
+sys.path.insert(0, ppadir)
+from ppalib import read_configs, run, build_ppa_tb, print_table
+
+parser = argparse.ArgumentParser(description="picorv32 microbenchmark latency table")
+parser.add_argument("configs", nargs="*", help="only run these configurations (default: all)")
+parser.add_argument("-c", "--config-file", default=os.path.join(ppadir, "configs.txt"), metavar="FILE",
+                    help="configuration matrix (default: scripts/ppa/configs.txt)")
+parser.add_argument("-b", "--build-dir", default="build", metavar="DIR", help="work directory (default: build)")
+parser.add_argument("-j", "--jobs", type=int, default=1, metavar="N", help="configurations processed in parallel")
+parser.add_argument("--csv", action="store_true", help="print CSV instead of a markdown table")
+parser.add_argument("--verilator", default=os.environ.get("VERILATOR", "verilator"))
+args = parser.parse_args()
+
+configs = read_configs(args.config_file, args.configs)
+
+def evaluate(config):
+    name, isa, params = config
+    wdir = os.path.abspath(os.path.join(args.build_dir, name))
+    os.makedirs(wdir, exist_ok=True)
+    tb = build_ppa_tb(args.verilator, params, wdir)
+
+    irq = any(k == "ENABLE_IRQ" and int(v, 0) for k, v in params)
+    elf = os.path.join(srcdir, "mb_%s%s.elf" % (isa, "_irq" if irq else ""))
+    log = os.path.join(wdir, "microbench.log")
+    run([tb, elf], log)
+
+    results = {}
+    with open(log, "r") as f:
+        for line in f:
+            if line.startswith("mb: ERROR"):
+                raise RuntimeError("%s: %s" % (name, line[4:].strip()))
+            m = re.match(r"mb: (\S+) (\d+) ops (\d+) cycles (\d+) instret", line)
+            if m:
+                results[m.group(1)] = (int(m.group(2)), int(m.group(3)), int(m.group(4)))
+    if not results:
+        raise RuntimeError("no results in %s" % log)
+    print("%s: %d kernels" % (name, len(results)), file=sys.stderr)
+    return name, results
+
+try:
+    with ThreadPoolExecutor(max_workers=max(1, args.jobs)) as pool:
+        rows = list(pool.map(evaluate, configs))
+except RuntimeError as e:
+    print("Error: %s" % e, file=sys.stderr)
+    sys.exit(1)
+
+# kernels in the order of the build with the most kernels (main.c order)
+kernels = max((list(r) for _, r in rows), key=len)
+header = ["Kernel"] + [name for name, _ in rows]
+table = []
+for k in kernels:
+    row = [k]
+    for _, results in rows:
+        ops, cycles, _ = results.get(k, (0, 0, 0))
+        row.append("%.2f" % (cycles / ops) if ops else "-")
+    table.append(row)
+
+if not args.csv:
+    print("Cycles per operation (loop overhead removed):\n")
+print_table(header, table, args.csv, 1)
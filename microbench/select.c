@@ -0,0 +1,147 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+
+// Branch-heavy kernels in C: running min/max, clamping and selection on
+// random data, so every comparison is taken about half the time. Built
+// with -march=..._zicond, GCC turns the conditional moves into czero.eqz /
+// czero.nez sequences (ENABLE_ZICOND). Like mul64.c, the results are
+// checked against a reference that only uses masks, no branches.
+
+#include <stdint.h>
+#include "microbench.h"
+
+#define NOPS (MB_ITERS * MB_UNROLL)
+#define NVALS 64
+#define CLAMP_LO (-1000000)
+#define CLAMP_HI 1000000
+
+static int32_t vals[NVALS], alts[NVALS];
+
+static uint32_t xorshift32(void)
+{
+	static uint32_t x = 271828183;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return x;
+}
+
+static inline unsigned int rdcycle(void)
+{
+	unsigned int c;
+	__asm__ volatile ("rdcycle %0" : "=r"(c));
+	return c;
+}
+
+static inline unsigned int rdinstret(void)
+{
+	unsigned int c;
+	__asm__ volatile ("rdinstret %0" : "=r"(c));
+	return c;
+}
+
+// all ones if a < b
+static int32_t ref_ltmask(int32_t a, int32_t b)
+{
+	return -(int32_t)(a < b);
+}
+
+static int32_t ref_select(int32_t mask, int32_t a, int32_t b)
+{
+	return (a & mask) | (b & ~mask);
+}
+
+static void __attribute__((noinline)) minmax(int n, int32_t *lo, int32_t *hi)
+{
+	int32_t l = vals[0], h = vals[0];
+	for (int i = 0; i < n; i++) {
+		int32_t v = vals[i % NVALS];
+		l = v < l ? v : l;
+		h = v > h ? v : h;
+	}
+	*lo = l;
+	*hi = h;
+}
+
+static int32_t __attribute__((noinline)) clamp_sum(int n)
+{
+	int32_t acc = 0;
+	for (int i = 0; i < n; i++) {
+		int32_t v = vals[i % NVALS];
+		v = v < CLAMP_LO ? CLAMP_LO : v;
+		v = v > CLAMP_HI ? CLAMP_HI : v;
+		acc += v;
+	}
+	return acc;
+}
+
+static int32_t __attribute__((noinline)) select_sum(int n)
+{
+	int32_t acc = 0;
+	for (int i = 0; i < n; i++) {
+		int32_t v = vals[i % NVALS];
+		acc += v & 1 ? v : alts[i % NVALS];
+	}
+	return acc;
+}
+
+// Fills the operand table (first call) and checks all kernels against the
+// reference. Returns 0 on a mismatch.
+int select_check(void)
+{
+	for (int i = 0; i < NVALS; i++) {
+		// about half of the values outside of the clamping range
+		vals[i] = (int32_t)xorshift32() >> 10;
+		alts[i] = (int32_t)xorshift32();
+	}
+
+	int32_t lo = vals[0], hi = vals[0], clamp = 0, sel = 0;
+	for (int i = 0; i < NVALS; i++) {
+		int32_t v = vals[i];
+		lo = ref_select(ref_ltmask(v, lo), v, lo);
+		hi = ref_select(ref_ltmask(hi, v), v, hi);
+		int32_t c = ref_select(ref_ltmask(v, CLAMP_LO), CLAMP_LO, v);
+		clamp += ref_select(ref_ltmask(CLAMP_HI, c), CLAMP_HI, c);
+		sel += ref_select(-(v & 1), v, alts[i]);
+	}
+
+	int32_t l, h;
+	minmax(NVALS, &l, &h);
+	return l == lo && h == hi && clamp_sum(NVALS) == clamp && select_sum(NVALS) == sel;
+}
+
+// result[0] and result[1] are the cycles and instructions of the whole loop,
+// including the call (main.c does not subtract the overhead of the empty
+// kernel for these)
+
+void mb_c_minmax(unsigned int result[2])
+{
+	int32_t lo, hi;
+	unsigned int c = rdcycle(), n = rdinstret();
+	minmax(NOPS, &lo, &hi);
+	result[0] = rdcycle() - c;
+	result[1] = rdinstret() - n;
+	__asm__ volatile ("" : : "r"(lo), "r"(hi));
+}
+
+void mb_c_clamp(unsigned int result[2])
+{
+	unsigned int c = rdcycle(), n = rdinstret();
+	int32_t acc = clamp_sum(NOPS);
+	result[0] = rdcycle() - c;
+	result[1] = rdinstret() - n;
+	__asm__ volatile ("" : : "r"(acc));
+}
+
+void mb_c_select(unsigned int result[2])
+{
+	unsigned int c = rdcycle(), n = rdinstret();
+	int32_t acc = select_sum(NOPS);
+	result[0] = rdcycle() - c;
+	result[1] = rdinstret() - n;
+	__asm__ volatile ("" : : "r"(acc));
+}
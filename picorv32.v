@@ -82,7 +82,11 @@ module picorv32 #(
 	parameter [ 0:0] ENABLE_PCPI = 0,
 	parameter [ 0:0] ENABLE_MUL = 0,
 	parameter [ 0:0] ENABLE_FAST_MUL = 0,
+	parameter [ 0:0] ENABLE_MUL_REUSE = 0,
 	parameter [ 0:0] ENABLE_DIV = 0,
+	parameter [ 0:0] DECOUPLED_PCPI = 0,
+	parameter [ 0:0] ENABLE_ZICOND = 0,
+	parameter [ 0:0] ENABLE_BITMANIP = 0,
 	parameter [ 0:0] ENABLE_IRQ = 0,
 	parameter [ 0:0] ENABLE_IRQ_QREGS = 1,
 	parameter [ 0:0] ENABLE_IRQ_TIMER = 1,
@@ -173,7 +177,84 @@ module picorv32 #(
 	localparam integer regfile_size = (ENABLE_REGS_16_31 ? 32 : 16) + 4*ENABLE_IRQ*ENABLE_IRQ_QREGS;
 	localparam integer regindex_bits = (ENABLE_REGS_16_31 ? 5 : 4) + ENABLE_IRQ*ENABLE_IRQ_QREGS;
 
-	localparam WITH_PCPI = ENABLE_PCPI || ENABLE_MUL || ENABLE_FAST_MUL || ENABLE_DIV;
+	localparam WITH_PCPI = ENABLE_PCPI || ENABLE_MUL || ENABLE_FAST_MUL || ENABLE_DIV || ENABLE_BITMANIP;
+
+	// Simulation only: with PICORV32_RUNTIME_CONFIG the parameters below become
+	// runtime straps, so that one compiled model covers every combination. All
+	// optional datapaths are built, the module parameters only set the default
+	// values. The straps are read from plusargs at time zero (+BARREL_SHIFTER=1,
+	// +ENABLE_MUL=0, ...) and may be written from C++ while resetn is low.
+	// Without the define they are constants and synthesis is unaffected.
+`ifdef PICORV32_RUNTIME_CONFIG
+	reg cfg_enable_counters      /* verilator public_flat_rw */;
+	reg cfg_enable_counters64    /* verilator public_flat_rw */;
+	reg cfg_enable_regs_dualport /* verilator public_flat_rw */;
+	reg cfg_two_stage_shift      /* verilator public_flat_rw */;
+	reg cfg_barrel_shifter       /* verilator public_flat_rw */;
+	reg cfg_two_cycle_compare    /* verilator public_flat_rw */;
+	reg cfg_two_cycle_alu        /* verilator public_flat_rw */;
+	reg cfg_compressed_isa       /* verilator public_flat_rw */;
+	reg cfg_catch_misalign       /* verilator public_flat_rw */;
+	reg cfg_catch_illinsn        /* verilator public_flat_rw */;
+	reg cfg_enable_mul           /* verilator public_flat_rw */;
+	reg cfg_enable_fast_mul      /* verilator public_flat_rw */;
+	reg cfg_enable_div           /* verilator public_flat_rw */;
+	reg cfg_enable_zicond        /* verilator public_flat_rw */;
+	reg cfg_enable_bitmanip      /* verilator public_flat_rw */;
+	wire cfg_with_pcpi = ENABLE_PCPI || cfg_enable_mul || cfg_enable_fast_mul || cfg_enable_div || cfg_enable_bitmanip;
+
+	integer cfg_value;
+	initial begin
+		cfg_enable_counters      = ENABLE_COUNTERS;
+		cfg_enable_counters64    = ENABLE_COUNTERS64;
+		cfg_enable_regs_dualport = ENABLE_REGS_DUALPORT;
+		cfg_two_stage_shift      = TWO_STAGE_SHIFT;
+		cfg_barrel_shifter       = BARREL_SHIFTER;
+		cfg_two_cycle_compare    = TWO_CYCLE_COMPARE;
+		cfg_two_cycle_alu        = TWO_CYCLE_ALU;
+		cfg_compressed_isa       = COMPRESSED_ISA;
+		cfg_catch_misalign       = CATCH_MISALIGN;
+		cfg_catch_illinsn        = CATCH_ILLINSN;
+		cfg_enable_mul           = ENABLE_MUL;
+		cfg_enable_fast_mul      = ENABLE_FAST_MUL;
+		cfg_enable_div           = ENABLE_DIV;
+		cfg_enable_zicond        = ENABLE_ZICOND;
+		cfg_enable_bitmanip      = ENABLE_BITMANIP;
+
+		if ($value$plusargs("ENABLE_COUNTERS=%d", cfg_value)) cfg_enable_counters = cfg_value != 0;
+		if ($value$plusargs("ENABLE_COUNTERS64=%d", cfg_value)) cfg_enable_counters64 = cfg_value != 0;
+		if ($value$plusargs("ENABLE_REGS_DUALPORT=%d", cfg_value)) cfg_enable_regs_dualport = cfg_value != 0;
+		if ($value$plusargs("TWO_STAGE_SHIFT=%d", cfg_value)) cfg_two_stage_shift = cfg_value != 0;
+		if ($value$plusargs("BARREL_SHIFTER=%d", cfg_value)) cfg_barrel_shifter = cfg_value != 0;
+		if ($value$plusargs("TWO_CYCLE_COMPARE=%d", cfg_value)) cfg_two_cycle_compare = cfg_value != 0;
+		if ($value$plusargs("TWO_CYCLE_ALU=%d", cfg_value)) cfg_two_cycle_alu = cfg_value != 0;
+		if ($value$plusargs("COMPRESSED_ISA=%d", cfg_value)) cfg_compressed_isa = cfg_value != 0;
+		if ($value$plusargs("CATCH_MISALIGN=%d", cfg_value)) cfg_catch_misalign = cfg_value != 0;
+		if ($value$plusargs("CATCH_ILLINSN=%d", cfg_value)) cfg_catch_illinsn = cfg_value != 0;
+		if ($value$plusargs("ENABLE_MUL=%d", cfg_value)) cfg_enable_mul = cfg_value != 0;
+		if ($value$plusargs("ENABLE_FAST_MUL=%d", cfg_value)) cfg_enable_fast_mul = cfg_value != 0;
+		if ($value$plusargs("ENABLE_DIV=%d", cfg_value)) cfg_enable_div = cfg_value != 0;
+		if ($value$plusargs("ENABLE_ZICOND=%d", cfg_value)) cfg_enable_zicond = cfg_value != 0;
+		if ($value$plusargs("ENABLE_BITMANIP=%d", cfg_value)) cfg_enable_bitmanip = cfg_value != 0;
+	end
+`else
+	localparam cfg_enable_counters      = ENABLE_COUNTERS;
+	localparam cfg_enable_counters64    = ENABLE_COUNTERS64;
+	localparam cfg_enable_regs_dualport = ENABLE_REGS_DUALPORT;
+	localparam cfg_two_stage_shift      = TWO_STAGE_SHIFT;
+	localparam cfg_barrel_shifter       = BARREL_SHIFTER;
+	localparam cfg_two_cycle_compare    = TWO_CYCLE_COMPARE;
+	localparam cfg_two_cycle_alu        = TWO_CYCLE_ALU;
+	localparam cfg_compressed_isa       = COMPRESSED_ISA;
+	localparam cfg_catch_misalign       = CATCH_MISALIGN;
+	localparam cfg_catch_illinsn        = CATCH_ILLINSN;
+	localparam cfg_enable_mul           = ENABLE_MUL;
+	localparam cfg_enable_fast_mul      = ENABLE_FAST_MUL;
+	localparam cfg_enable_div           = ENABLE_DIV;
+	localparam cfg_enable_zicond        = ENABLE_ZICOND;
+	localparam cfg_enable_bitmanip      = ENABLE_BITMANIP;
+	localparam cfg_with_pcpi            = WITH_PCPI;
+`endif
 
 	localparam [35:0] TRACE_BRANCH = {4'b 0001, 32'b 0};
 	localparam [35:0] TRACE_ADDR   = {4'b 0010, 32'b 0};
@@ -195,8 +276,20 @@ module picorv32 #(
 	wire [ 3:0] dbg_mem_wstrb = mem_wstrb;
 	wire [31:0] dbg_mem_rdata = mem_rdata;
 
-	assign pcpi_rs1 = reg_op1;
-	assign pcpi_rs2 = reg_op2;
+	// DECOUPLED_PCPI: an instruction on a PCPI core that asserts pcpi_wait
+	// keeps running in the background while the CPU continues. pcpi_busy_rd
+	// is the one scoreboard entry, pcpi_valid/insn/rs1/rs2 are held for the
+	// co-processor until pcpi_ready, the result then waits in
+	// pcpi_busy_result for a cycle in which the register file is not written.
+	reg pcpi_busy;
+	reg pcpi_busy_done;
+	reg pcpi_busy_kill;
+	reg [regindex_bits-1:0] pcpi_busy_rd;
+	reg [31:0] pcpi_busy_rs1, pcpi_busy_rs2, pcpi_busy_result;
+	reg [31:0] pcpi_next_insn;
+
+	assign pcpi_rs1 = DECOUPLED_PCPI && pcpi_busy ? pcpi_busy_rs1 : reg_op1;
+	assign pcpi_rs2 = DECOUPLED_PCPI && pcpi_busy ? pcpi_busy_rs2 : reg_op2;
 
 	wire [31:0] next_pc;
 
@@ -271,13 +364,88 @@ module picorv32 #(
 	wire        pcpi_div_wait;
 	wire        pcpi_div_ready;
 
+	wire        pcpi_bmp_wr;
+	wire [31:0] pcpi_bmp_rd;
+	wire        pcpi_bmp_wait;
+	wire        pcpi_bmp_ready;
+
 	reg        pcpi_int_wr;
 	reg [31:0] pcpi_int_rd;
 	reg        pcpi_int_wait;
 	reg        pcpi_int_ready;
 
+`ifdef PICORV32_RUNTIME_CONFIG
+	// both multipliers and the divider, pcpi_valid gated by the straps
+	wire        pcpi_fast_mul_wr, pcpi_slow_mul_wr;
+	wire [31:0] pcpi_fast_mul_rd, pcpi_slow_mul_rd;
+	wire        pcpi_fast_mul_wait, pcpi_slow_mul_wait;
+	wire        pcpi_fast_mul_ready, pcpi_slow_mul_ready;
+
+	picorv32_pcpi_fast_mul #(
+		.REUSE_RESULT(ENABLE_MUL_REUSE)
+	) pcpi_fast_mul (
+		.clk       (clk            ),
+		.resetn    (resetn         ),
+		.pcpi_valid(pcpi_valid && cfg_enable_fast_mul),
+		.pcpi_insn (pcpi_insn      ),
+		.pcpi_rs1  (pcpi_rs1       ),
+		.pcpi_rs2  (pcpi_rs2       ),
+		.pcpi_wr   (pcpi_fast_mul_wr),
+		.pcpi_rd   (pcpi_fast_mul_rd),
+		.pcpi_wait (pcpi_fast_mul_wait),
+		.pcpi_ready(pcpi_fast_mul_ready)
+	);
+
+	picorv32_pcpi_mul #(
+		.REUSE_RESULT(ENABLE_MUL_REUSE)
+	) pcpi_mul (
+		.clk       (clk            ),
+		.resetn    (resetn         ),
+		.pcpi_valid(pcpi_valid && cfg_enable_mul && !cfg_enable_fast_mul),
+		.pcpi_insn (pcpi_insn      ),
+		.pcpi_rs1  (pcpi_rs1       ),
+		.pcpi_rs2  (pcpi_rs2       ),
+		.pcpi_wr   (pcpi_slow_mul_wr),
+		.pcpi_rd   (pcpi_slow_mul_rd),
+		.pcpi_wait (pcpi_slow_mul_wait),
+		.pcpi_ready(pcpi_slow_mul_ready)
+	);
+
+	assign pcpi_mul_wr    = cfg_enable_fast_mul ? pcpi_fast_mul_wr    : pcpi_slow_mul_wr;
+	assign pcpi_mul_rd    = cfg_enable_fast_mul ? pcpi_fast_mul_rd    : pcpi_slow_mul_rd;
+	assign pcpi_mul_wait  = cfg_enable_fast_mul ? pcpi_fast_mul_wait  : pcpi_slow_mul_wait;
+	assign pcpi_mul_ready = cfg_enable_fast_mul ? pcpi_fast_mul_ready : pcpi_slow_mul_ready;
+
+	picorv32_pcpi_div pcpi_div (
+		.clk       (clk            ),
+		.resetn    (resetn         ),
+		.pcpi_valid(pcpi_valid && cfg_enable_div),
+		.pcpi_insn (pcpi_insn      ),
+		.pcpi_rs1  (pcpi_rs1       ),
+		.pcpi_rs2  (pcpi_rs2       ),
+		.pcpi_wr   (pcpi_div_wr    ),
+		.pcpi_rd   (pcpi_div_rd    ),
+		.pcpi_wait (pcpi_div_wait  ),
+		.pcpi_ready(pcpi_div_ready )
+	);
+
+	picorv32_pcpi_bitmanip pcpi_bmp (
+		.clk       (clk            ),
+		.resetn    (resetn         ),
+		.pcpi_valid(pcpi_valid && cfg_enable_bitmanip),
+		.pcpi_insn (pcpi_insn      ),
+		.pcpi_rs1  (pcpi_rs1       ),
+		.pcpi_rs2  (pcpi_rs2       ),
+		.pcpi_wr   (pcpi_bmp_wr    ),
+		.pcpi_rd   (pcpi_bmp_rd    ),
+		.pcpi_wait (pcpi_bmp_wait  ),
+		.pcpi_ready(pcpi_bmp_ready )
+	);
+`else
 	generate if (ENABLE_FAST_MUL) begin
-		picorv32_pcpi_fast_mul pcpi_mul (
+		picorv32_pcpi_fast_mul #(
+			.REUSE_RESULT(ENABLE_MUL_REUSE)
+		) pcpi_mul (
 			.clk       (clk            ),
 			.resetn    (resetn         ),
 			.pcpi_valid(pcpi_valid     ),
@@ -290,7 +458,9 @@ module picorv32 #(
 			.pcpi_ready(pcpi_mul_ready )
 		);
 	end else if (ENABLE_MUL) begin
-		picorv32_pcpi_mul pcpi_mul (
+		picorv32_pcpi_mul #(
+			.REUSE_RESULT(ENABLE_MUL_REUSE)
+		) pcpi_mul (
 			.clk       (clk            ),
 			.resetn    (resetn         ),
 			.pcpi_valid(pcpi_valid     ),
@@ -329,11 +499,34 @@ module picorv32 #(
 		assign pcpi_div_ready = 0;
 	end endgenerate
 
+	generate if (ENABLE_BITMANIP) begin
+		picorv32_pcpi_bitmanip pcpi_bmp (
+			.clk       (clk            ),
+			.resetn    (resetn         ),
+			.pcpi_valid(pcpi_valid     ),
+			.pcpi_insn (pcpi_insn      ),
+			.pcpi_rs1  (pcpi_rs1       ),
+			.pcpi_rs2  (pcpi_rs2       ),
+			.pcpi_wr   (pcpi_bmp_wr    ),
+			.pcpi_rd   (pcpi_bmp_rd    ),
+			.pcpi_wait (pcpi_bmp_wait  ),
+			.pcpi_ready(pcpi_bmp_ready )
+		);
+	end else begin
+		assign pcpi_bmp_wr = 0;
+		assign pcpi_bmp_rd = 32'bx;
+		assign pcpi_bmp_wait = 0;
+		assign pcpi_bmp_ready = 0;
+	end endgenerate
+`endif
+
 	always @* begin
 		pcpi_int_wr = 0;
 		pcpi_int_rd = 32'bx;
-		pcpi_int_wait  = |{ENABLE_PCPI && pcpi_wait,  (ENABLE_MUL || ENABLE_FAST_MUL) && pcpi_mul_wait,  ENABLE_DIV && pcpi_div_wait};
-		pcpi_int_ready = |{ENABLE_PCPI && pcpi_ready, (ENABLE_MUL || ENABLE_FAST_MUL) && pcpi_mul_ready, ENABLE_DIV && pcpi_div_ready};
+		pcpi_int_wait  = |{ENABLE_PCPI && pcpi_wait,  (cfg_enable_mul || cfg_enable_fast_mul) && pcpi_mul_wait,  cfg_enable_div && pcpi_div_wait,
+				cfg_enable_bitmanip && pcpi_bmp_wait};
+		pcpi_int_ready = |{ENABLE_PCPI && pcpi_ready, (cfg_enable_mul || cfg_enable_fast_mul) && pcpi_mul_ready, cfg_enable_div && pcpi_div_ready,
+				cfg_enable_bitmanip && pcpi_bmp_ready};
 
 		(* parallel_case *)
 		case (1'b1)
@@ -341,17 +534,26 @@ module picorv32 #(
 				pcpi_int_wr = ENABLE_PCPI ? pcpi_wr : 0;
 				pcpi_int_rd = ENABLE_PCPI ? pcpi_rd : 0;
 			end
-			(ENABLE_MUL || ENABLE_FAST_MUL) && pcpi_mul_ready: begin
+			(cfg_enable_mul || cfg_enable_fast_mul) && pcpi_mul_ready: begin
 				pcpi_int_wr = pcpi_mul_wr;
 				pcpi_int_rd = pcpi_mul_rd;
 			end
-			ENABLE_DIV && pcpi_div_ready: begin
+			cfg_enable_div && pcpi_div_ready: begin
 				pcpi_int_wr = pcpi_div_wr;
 				pcpi_int_rd = pcpi_div_rd;
 			end
+			cfg_enable_bitmanip && pcpi_bmp_ready: begin
+				pcpi_int_wr = pcpi_bmp_wr;
+				pcpi_int_rd = pcpi_bmp_rd;
+			end
 		endcase
 	end
 
+	// leave the instruction to the multiplier or divider once it waits
+	wire pcpi_int_decouple = DECOUPLED_PCPI && pcpi_valid && !pcpi_busy && !pcpi_int_ready &&
+			(((cfg_enable_mul || cfg_enable_fast_mul) && pcpi_mul_wait) || (cfg_enable_div && pcpi_div_wait));
+	wire pcpi_busy_hold = DECOUPLED_PCPI && pcpi_busy && pcpi_valid && !pcpi_int_ready;
+
 
 	// Memory Interface
 
@@ -366,8 +568,8 @@ module picorv32 #(
 
 	wire mem_xfer;
 	reg mem_la_secondword, mem_la_firstword_reg, last_mem_valid;
-	wire mem_la_firstword = COMPRESSED_ISA && (mem_do_prefetch || mem_do_rinst) && next_pc[1] && !mem_la_secondword;
-	wire mem_la_firstword_xfer = COMPRESSED_ISA && mem_xfer && (!last_mem_valid ? mem_la_firstword : mem_la_firstword_reg);
+	wire mem_la_firstword = cfg_compressed_isa && (mem_do_prefetch || mem_do_rinst) && next_pc[1] && !mem_la_secondword;
+	wire mem_la_firstword_xfer = cfg_compressed_isa && mem_xfer && (!last_mem_valid ? mem_la_firstword : mem_la_firstword_reg);
 
 	reg prefetched_high_word;
 	reg clear_prefetched_high_word;
@@ -376,7 +578,7 @@ module picorv32 #(
 	wire [31:0] mem_rdata_latched_noshuffle;
 	wire [31:0] mem_rdata_latched;
 
-	wire mem_la_use_prefetched_high_word = COMPRESSED_ISA && mem_la_firstword && prefetched_high_word && !clear_prefetched_high_word;
+	wire mem_la_use_prefetched_high_word = cfg_compressed_isa && mem_la_firstword && prefetched_high_word && !clear_prefetched_high_word;
 	assign mem_xfer = (mem_valid && mem_ready) || (mem_la_use_prefetched_high_word && mem_do_rinst);
 
 	wire mem_busy = |{mem_do_prefetch, mem_do_rinst, mem_do_rdata, mem_do_wdata};
@@ -385,14 +587,14 @@ module picorv32 #(
 
 	assign mem_la_write = resetn && !mem_state && mem_do_wdata;
 	assign mem_la_read = resetn && ((!mem_la_use_prefetched_high_word && !mem_state && (mem_do_rinst || mem_do_prefetch || mem_do_rdata)) ||
-			(COMPRESSED_ISA && mem_xfer && (!last_mem_valid ? mem_la_firstword : mem_la_firstword_reg) && !mem_la_secondword && &mem_rdata_latched[1:0]));
+			(cfg_compressed_isa && mem_xfer && (!last_mem_valid ? mem_la_firstword : mem_la_firstword_reg) && !mem_la_secondword && &mem_rdata_latched[1:0]));
 	assign mem_la_addr = (mem_do_prefetch || mem_do_rinst) ? {next_pc[31:2] + mem_la_firstword_xfer, 2'b00} : {reg_op1[31:2], 2'b00};
 
 	assign mem_rdata_latched_noshuffle = (mem_xfer || LATCHED_MEM_RDATA) ? mem_rdata : mem_rdata_q;
 
-	assign mem_rdata_latched = COMPRESSED_ISA && mem_la_use_prefetched_high_word ? {16'bx, mem_16bit_buffer} :
-			COMPRESSED_ISA && mem_la_secondword ? {mem_rdata_latched_noshuffle[15:0], mem_16bit_buffer} :
-			COMPRESSED_ISA && mem_la_firstword ? {16'bx, mem_rdata_latched_noshuffle[31:16]} : mem_rdata_latched_noshuffle;
+	assign mem_rdata_latched = cfg_compressed_isa && mem_la_use_prefetched_high_word ? {16'bx, mem_16bit_buffer} :
+			cfg_compressed_isa && mem_la_secondword ? {mem_rdata_latched_noshuffle[15:0], mem_16bit_buffer} :
+			cfg_compressed_isa && mem_la_firstword ? {16'bx, mem_rdata_latched_noshuffle[31:16]} : mem_rdata_latched_noshuffle;
 
 	always @(posedge clk) begin
 		if (!resetn) begin
@@ -436,11 +638,11 @@ module picorv32 #(
 
 	always @(posedge clk) begin
 		if (mem_xfer) begin
-			mem_rdata_q <= COMPRESSED_ISA ? mem_rdata_latched : mem_rdata;
-			next_insn_opcode <= COMPRESSED_ISA ? mem_rdata_latched : mem_rdata;
+			mem_rdata_q <= cfg_compressed_isa ? mem_rdata_latched : mem_rdata;
+			next_insn_opcode <= cfg_compressed_isa ? mem_rdata_latched : mem_rdata;
 		end
 
-		if (COMPRESSED_ISA && mem_done && (mem_do_prefetch || mem_do_rinst)) begin
+		if (cfg_compressed_isa && mem_done && (mem_do_prefetch || mem_do_rinst)) begin
 			case (mem_rdata_latched[1:0])
 				2'b00: begin // Quadrant 0
 					case (mem_rdata_latched[15:13])
@@ -605,7 +807,7 @@ module picorv32 #(
 					`assert(mem_valid == !mem_la_use_prefetched_high_word);
 					`assert(mem_instr == (mem_do_prefetch || mem_do_rinst));
 					if (mem_xfer) begin
-						if (COMPRESSED_ISA && mem_la_read) begin
+						if (cfg_compressed_isa && mem_la_read) begin
 							mem_valid <= 1;
 							mem_la_secondword <= 1;
 							if (!mem_la_use_prefetched_high_word)
@@ -613,7 +815,7 @@ module picorv32 #(
 						end else begin
 							mem_valid <= 0;
 							mem_la_secondword <= 0;
-							if (COMPRESSED_ISA && !mem_do_rdata) begin
+							if (cfg_compressed_isa && !mem_do_rdata) begin
 								if (~&mem_rdata[1:0] || mem_la_secondword) begin
 									mem_16bit_buffer <= mem_rdata[31:16];
 									prefetched_high_word <= 1;
@@ -655,6 +857,7 @@ module picorv32 #(
 	reg instr_lb, instr_lh, instr_lw, instr_lbu, instr_lhu, instr_sb, instr_sh, instr_sw;
 	reg instr_addi, instr_slti, instr_sltiu, instr_xori, instr_ori, instr_andi, instr_slli, instr_srli, instr_srai;
 	reg instr_add, instr_sub, instr_sll, instr_slt, instr_sltu, instr_xor, instr_srl, instr_sra, instr_or, instr_and;
+	reg instr_czero_eqz, instr_czero_nez;
 	reg instr_rdcycle, instr_rdcycleh, instr_rdinstr, instr_rdinstrh, instr_ecall_ebreak, instr_fence;
 	reg instr_getq, instr_setq, instr_retirq, instr_maskirq, instr_waitirq, instr_timer;
 	wire instr_trap;
@@ -683,11 +886,12 @@ module picorv32 #(
 	reg is_alu_reg_reg;
 	reg is_compare;
 
-	assign instr_trap = (CATCH_ILLINSN || WITH_PCPI) && !{instr_lui, instr_auipc, instr_jal, instr_jalr,
+	assign instr_trap = (cfg_catch_illinsn || cfg_with_pcpi) && !{instr_lui, instr_auipc, instr_jal, instr_jalr,
 			instr_beq, instr_bne, instr_blt, instr_bge, instr_bltu, instr_bgeu,
 			instr_lb, instr_lh, instr_lw, instr_lbu, instr_lhu, instr_sb, instr_sh, instr_sw,
 			instr_addi, instr_slti, instr_sltiu, instr_xori, instr_ori, instr_andi, instr_slli, instr_srli, instr_srai,
 			instr_add, instr_sub, instr_sll, instr_slt, instr_sltu, instr_xor, instr_srl, instr_sra, instr_or, instr_and,
+			instr_czero_eqz, instr_czero_nez,
 			instr_rdcycle, instr_rdcycleh, instr_rdinstr, instr_rdinstrh, instr_fence,
 			instr_getq, instr_setq, instr_retirq, instr_maskirq, instr_waitirq, instr_timer};
 
@@ -750,6 +954,9 @@ module picorv32 #(
 		if (instr_or)       new_ascii_instr = "or";
 		if (instr_and)      new_ascii_instr = "and";
 
+		if (instr_czero_eqz) new_ascii_instr = "czeroeqz";
+		if (instr_czero_nez) new_ascii_instr = "czeronez";
+
 		if (instr_rdcycle)  new_ascii_instr = "rdcycle";
 		if (instr_rdcycleh) new_ascii_instr = "rdcycleh";
 		if (instr_rdinstr)  new_ascii_instr = "rdinstr";
@@ -897,7 +1104,7 @@ module picorv32 #(
 				decoded_rs1 <= ENABLE_IRQ_QREGS ? irqregs_offset : 3; // instr_retirq
 
 			compressed_instr <= 0;
-			if (COMPRESSED_ISA && mem_rdata_latched[1:0] != 2'b11) begin
+			if (cfg_compressed_isa && mem_rdata_latched[1:0] != 2'b11) begin
 				compressed_instr <= 1;
 				decoded_rd <= 0;
 				decoded_rs1 <= 0;
@@ -1041,8 +1248,14 @@ module picorv32 #(
 			end
 		end
 
+		if (DECOUPLED_PCPI && pcpi_busy && pcpi_valid && pcpi_int_ready)
+			pcpi_insn <= pcpi_next_insn;
+
 		if (decoder_trigger && !decoder_pseudo_trigger) begin
-			pcpi_insn <= WITH_PCPI ? mem_rdata_q : 'bx;
+			if (pcpi_busy_hold)
+				pcpi_next_insn <= mem_rdata_q;
+			else
+				pcpi_insn <= cfg_with_pcpi ? mem_rdata_q : 'bx;
 
 			instr_beq   <= is_beq_bne_blt_bge_bltu_bgeu && mem_rdata_q[14:12] == 3'b000;
 			instr_bne   <= is_beq_bne_blt_bge_bltu_bgeu && mem_rdata_q[14:12] == 3'b001;
@@ -1083,15 +1296,18 @@ module picorv32 #(
 			instr_or    <= is_alu_reg_reg && mem_rdata_q[14:12] == 3'b110 && mem_rdata_q[31:25] == 7'b0000000;
 			instr_and   <= is_alu_reg_reg && mem_rdata_q[14:12] == 3'b111 && mem_rdata_q[31:25] == 7'b0000000;
 
+			instr_czero_eqz <= is_alu_reg_reg && mem_rdata_q[14:12] == 3'b101 && mem_rdata_q[31:25] == 7'b0000111 && cfg_enable_zicond;
+			instr_czero_nez <= is_alu_reg_reg && mem_rdata_q[14:12] == 3'b111 && mem_rdata_q[31:25] == 7'b0000111 && cfg_enable_zicond;
+
 			instr_rdcycle  <= ((mem_rdata_q[6:0] == 7'b1110011 && mem_rdata_q[31:12] == 'b11000000000000000010) ||
-			                   (mem_rdata_q[6:0] == 7'b1110011 && mem_rdata_q[31:12] == 'b11000000000100000010)) && ENABLE_COUNTERS;
+			                   (mem_rdata_q[6:0] == 7'b1110011 && mem_rdata_q[31:12] == 'b11000000000100000010)) && cfg_enable_counters;
 			instr_rdcycleh <= ((mem_rdata_q[6:0] == 7'b1110011 && mem_rdata_q[31:12] == 'b11001000000000000010) ||
-			                   (mem_rdata_q[6:0] == 7'b1110011 && mem_rdata_q[31:12] == 'b11001000000100000010)) && ENABLE_COUNTERS && ENABLE_COUNTERS64;
-			instr_rdinstr  <=  (mem_rdata_q[6:0] == 7'b1110011 && mem_rdata_q[31:12] == 'b11000000001000000010) && ENABLE_COUNTERS;
-			instr_rdinstrh <=  (mem_rdata_q[6:0] == 7'b1110011 && mem_rdata_q[31:12] == 'b11001000001000000010) && ENABLE_COUNTERS && ENABLE_COUNTERS64;
+			                   (mem_rdata_q[6:0] == 7'b1110011 && mem_rdata_q[31:12] == 'b11001000000100000010)) && cfg_enable_counters && cfg_enable_counters64;
+			instr_rdinstr  <=  (mem_rdata_q[6:0] == 7'b1110011 && mem_rdata_q[31:12] == 'b11000000001000000010) && cfg_enable_counters;
+			instr_rdinstrh <=  (mem_rdata_q[6:0] == 7'b1110011 && mem_rdata_q[31:12] == 'b11001000001000000010) && cfg_enable_counters && cfg_enable_counters64;
 
 			instr_ecall_ebreak <= ((mem_rdata_q[6:0] == 7'b1110011 && !mem_rdata_q[31:21] && !mem_rdata_q[19:7]) ||
-					(COMPRESSED_ISA && mem_rdata_q[15:0] == 16'h9002));
+					(cfg_compressed_isa && mem_rdata_q[15:0] == 16'h9002));
 			instr_fence <= (mem_rdata_q[6:0] == 7'b0001111 && !mem_rdata_q[14:12]);
 
 			instr_getq    <= mem_rdata_q[6:0] == 7'b0001011 && mem_rdata_q[31:25] == 7'b0000000 && ENABLE_IRQ && ENABLE_IRQ_QREGS;
@@ -1169,6 +1385,9 @@ module picorv32 #(
 			instr_or    <= 0;
 			instr_and   <= 0;
 
+			instr_czero_eqz <= 0;
+			instr_czero_nez <= 0;
+
 			instr_fence <= 0;
 		end
 	end
@@ -1233,6 +1452,38 @@ module picorv32 #(
 	reg [31:0] alu_shl, alu_shr;
 	reg alu_eq, alu_ltu, alu_lts;
 
+`ifdef PICORV32_RUNTIME_CONFIG
+	reg [31:0] alu_add_sub_c, alu_add_sub_q;
+	reg [31:0] alu_shl_c, alu_shr_c, alu_shl_q, alu_shr_q;
+	reg alu_eq_c, alu_ltu_c, alu_lts_c, alu_eq_q, alu_ltu_q, alu_lts_q;
+
+	always @* begin
+		alu_add_sub_c = instr_sub ? reg_op1 - reg_op2 : reg_op1 + reg_op2;
+		alu_eq_c = reg_op1 == reg_op2;
+		alu_lts_c = $signed(reg_op1) < $signed(reg_op2);
+		alu_ltu_c = reg_op1 < reg_op2;
+		alu_shl_c = reg_op1 << reg_op2[4:0];
+		alu_shr_c = $signed({instr_sra || instr_srai ? reg_op1[31] : 1'b0, reg_op1}) >>> reg_op2[4:0];
+	end
+
+	always @(posedge clk) begin
+		alu_add_sub_q <= alu_add_sub_c;
+		alu_eq_q <= alu_eq_c;
+		alu_lts_q <= alu_lts_c;
+		alu_ltu_q <= alu_ltu_c;
+		alu_shl_q <= alu_shl_c;
+		alu_shr_q <= alu_shr_c;
+	end
+
+	always @* begin
+		alu_add_sub = cfg_two_cycle_alu ? alu_add_sub_q : alu_add_sub_c;
+		alu_eq = cfg_two_cycle_alu ? alu_eq_q : alu_eq_c;
+		alu_lts = cfg_two_cycle_alu ? alu_lts_q : alu_lts_c;
+		alu_ltu = cfg_two_cycle_alu ? alu_ltu_q : alu_ltu_c;
+		alu_shl = cfg_two_cycle_alu ? alu_shl_q : alu_shl_c;
+		alu_shr = cfg_two_cycle_alu ? alu_shr_q : alu_shr_c;
+	end
+`else
 	generate if (TWO_CYCLE_ALU) begin
 		always @(posedge clk) begin
 			alu_add_sub <= instr_sub ? reg_op1 - reg_op2 : reg_op1 + reg_op2;
@@ -1252,6 +1503,7 @@ module picorv32 #(
 			alu_shr = $signed({instr_sra || instr_srai ? reg_op1[31] : 1'b0, reg_op1}) >>> reg_op2[4:0];
 		end
 	end endgenerate
+`endif
 
 	always @* begin
 		alu_out_0 = 'bx;
@@ -1265,9 +1517,9 @@ module picorv32 #(
 				alu_out_0 = !alu_lts;
 			instr_bgeu:
 				alu_out_0 = !alu_ltu;
-			is_slti_blt_slt && (!TWO_CYCLE_COMPARE || !{instr_beq,instr_bne,instr_bge,instr_bgeu}):
+			is_slti_blt_slt && (!cfg_two_cycle_compare || !{instr_beq,instr_bne,instr_bge,instr_bgeu}):
 				alu_out_0 = alu_lts;
-			is_sltiu_bltu_sltu && (!TWO_CYCLE_COMPARE || !{instr_beq,instr_bne,instr_bge,instr_bgeu}):
+			is_sltiu_bltu_sltu && (!cfg_two_cycle_compare || !{instr_beq,instr_bne,instr_bge,instr_bgeu}):
 				alu_out_0 = alu_ltu;
 		endcase
 
@@ -1284,9 +1536,11 @@ module picorv32 #(
 				alu_out = reg_op1 | reg_op2;
 			instr_andi || instr_and:
 				alu_out = reg_op1 & reg_op2;
-			BARREL_SHIFTER && (instr_sll || instr_slli):
+			instr_czero_eqz || instr_czero_nez:
+				alu_out = (reg_op2 == 0) == instr_czero_nez ? reg_op1 : 0;
+			cfg_barrel_shifter && (instr_sll || instr_slli):
 				alu_out = alu_shl;
-			BARREL_SHIFTER && (instr_srl || instr_srli || instr_sra || instr_srai):
+			cfg_barrel_shifter && (instr_srl || instr_srli || instr_sra || instr_srai):
 				alu_out = alu_shr;
 		endcase
 
@@ -1304,10 +1558,20 @@ module picorv32 #(
 		if (!prefetched_high_word)
 			clear_prefetched_high_word = 0;
 		if (latched_branch || irq_state || !resetn)
-			clear_prefetched_high_word = COMPRESSED_ISA;
+			clear_prefetched_high_word = cfg_compressed_isa;
 	end
 
+	// DECOUPLED_PCPI: wait in ld_rs1 for the result of the instruction still
+	// on the co-processor before reading its rd or issuing the next PCPI
+	// instruction, write the result back in a state without a register write
+	wire pcpi_busy_stall = DECOUPLED_PCPI && pcpi_busy && (instr_trap ||
+			(pcpi_busy_rd && !is_lui_auipc_jal && decoded_rs1 == pcpi_busy_rd) ||
+			(pcpi_busy_rd && (is_beq_bne_blt_bge_bltu_bgeu || is_sb_sh_sw || is_alu_reg_reg) && decoded_rs2 == pcpi_busy_rd));
+	wire pcpi_busy_wb = DECOUPLED_PCPI && pcpi_busy_done &&
+			|(cpu_state & (cpu_state_ld_rs1 | cpu_state_ld_rs2 | cpu_state_exec | cpu_state_shift));
+
 	reg cpuregs_write;
+	reg [regindex_bits-1:0] cpuregs_waddr;
 	reg [31:0] cpuregs_wrdata;
 	reg [31:0] cpuregs_rs1;
 	reg [31:0] cpuregs_rs2;
@@ -1315,6 +1579,7 @@ module picorv32 #(
 
 	always @* begin
 		cpuregs_write = 0;
+		cpuregs_waddr = latched_rd;
 		cpuregs_wrdata = 'bx;
 
 		if (cpu_state == cpu_state_fetch) begin
@@ -1338,28 +1603,34 @@ module picorv32 #(
 				end
 			endcase
 		end
+
+		if (pcpi_busy_wb) begin
+			cpuregs_waddr = pcpi_busy_rd;
+			cpuregs_wrdata = pcpi_busy_result;
+			cpuregs_write = !pcpi_busy_kill;
+		end
 	end
 
 `ifndef PICORV32_REGS
 	always @(posedge clk) begin
-		if (resetn && cpuregs_write && latched_rd) begin
+		if (resetn && cpuregs_write && cpuregs_waddr) begin
 `ifdef VERBOSE_DEBUG
 			if (!(dbg_exception_latched || dbg_exception_event))
-				$display("REG_WRITE: x%-2d <= 0x%08x  (PC=0x%08x INSN=0x%08x)", latched_rd, cpuregs_wrdata, dbg_insn_addr, dbg_insn_opcode);
+				$display("REG_WRITE: x%-2d <= 0x%08x  (PC=0x%08x INSN=0x%08x)", cpuregs_waddr, cpuregs_wrdata, dbg_insn_addr, dbg_insn_opcode);
 `endif
 `ifdef PICORV32_TESTBUG_001
-			cpuregs[latched_rd ^ 1] <= cpuregs_wrdata;
+			cpuregs[cpuregs_waddr ^ 1] <= cpuregs_wrdata;
 `elsif PICORV32_TESTBUG_002
-			cpuregs[latched_rd] <= cpuregs_wrdata ^ 1;
+			cpuregs[cpuregs_waddr] <= cpuregs_wrdata ^ 1;
 `else
-			cpuregs[latched_rd] <= cpuregs_wrdata;
+			cpuregs[cpuregs_waddr] <= cpuregs_wrdata;
 `endif
 		end
 	end
 
 	always @* begin
 		decoded_rs = 'bx;
-		if (ENABLE_REGS_DUALPORT) begin
+		if (cfg_enable_regs_dualport) begin
 `ifndef RISCV_FORMAL_BLACKBOX_REGS
 			cpuregs_rs1 = decoded_rs1 ? cpuregs[decoded_rs1] : 0;
 			cpuregs_rs2 = decoded_rs2 ? cpuregs[decoded_rs2] : 0;
@@ -1381,13 +1652,12 @@ module picorv32 #(
 	wire[31:0] cpuregs_rdata1;
 	wire[31:0] cpuregs_rdata2;
 
-	wire [5:0] cpuregs_waddr = latched_rd;
-	wire [5:0] cpuregs_raddr1 = ENABLE_REGS_DUALPORT ? decoded_rs1 : decoded_rs;
-	wire [5:0] cpuregs_raddr2 = ENABLE_REGS_DUALPORT ? decoded_rs2 : 0;
+	wire [5:0] cpuregs_raddr1 = cfg_enable_regs_dualport ? decoded_rs1 : decoded_rs;
+	wire [5:0] cpuregs_raddr2 = cfg_enable_regs_dualport ? decoded_rs2 : 0;
 
 	`PICORV32_REGS cpuregs (
 		.clk(clk),
-		.wen(resetn && cpuregs_write && latched_rd),
+		.wen(resetn && cpuregs_write && cpuregs_waddr),
 		.waddr(cpuregs_waddr),
 		.raddr1(cpuregs_raddr1),
 		.raddr2(cpuregs_raddr2),
@@ -1398,7 +1668,7 @@ module picorv32 #(
 
 	always @* begin
 		decoded_rs = 'bx;
-		if (ENABLE_REGS_DUALPORT) begin
+		if (cfg_enable_regs_dualport) begin
 			cpuregs_rs1 = decoded_rs1 ? cpuregs_rdata1 : 0;
 			cpuregs_rs2 = decoded_rs2 ? cpuregs_rdata2 : 0;
 		end else begin
@@ -1412,23 +1682,23 @@ module picorv32 #(
 	assign launch_next_insn = cpu_state == cpu_state_fetch && decoder_trigger && (!ENABLE_IRQ || irq_delay || irq_active || !(irq_pending & ~irq_mask));
 
 	wire [31:0] mem_write_addr = reg_op1 + decoded_imm;
-	wire store_misaligned = CATCH_MISALIGN && resetn &&
+	wire store_misaligned = cfg_catch_misalign && resetn &&
 			((instr_sw && |mem_write_addr[1:0]) ||
 			 (instr_sh && mem_write_addr[0]));
 `ifdef VERBOSE_DEBUG
-	wire dbg_exception_misaligned_word = CATCH_MISALIGN && resetn &&
+	wire dbg_exception_misaligned_word = cfg_catch_misalign && resetn &&
 			(mem_do_rdata || mem_do_wdata) &&
 			(mem_wordsize == 0 && |reg_op1[1:0]);
-	wire dbg_exception_misaligned_half = CATCH_MISALIGN && resetn &&
+	wire dbg_exception_misaligned_half = cfg_catch_misalign && resetn &&
 			(mem_do_rdata || mem_do_wdata) &&
 			(mem_wordsize == 1 && reg_op1[0]);
-	wire dbg_exception_misaligned_instr = CATCH_MISALIGN && resetn && mem_do_rinst &&
-			(COMPRESSED_ISA ? reg_pc[0] : |reg_pc[1:0]);
-	wire dbg_exception_trap_no_pcpi = (cpu_state == cpu_state_ld_rs1) && !WITH_PCPI && instr_trap;
-	wire dbg_exception_pcpi_ld_rs1 = (cpu_state == cpu_state_ld_rs1) && WITH_PCPI && ENABLE_REGS_DUALPORT &&
-			!pcpi_int_ready && CATCH_ILLINSN && (pcpi_timeout || instr_ecall_ebreak);
-	wire dbg_exception_pcpi_exec = (cpu_state == cpu_state_exec) && WITH_PCPI &&
-			CATCH_ILLINSN && (pcpi_timeout || instr_ecall_ebreak);
+	wire dbg_exception_misaligned_instr = cfg_catch_misalign && resetn && mem_do_rinst &&
+			(cfg_compressed_isa ? reg_pc[0] : |reg_pc[1:0]);
+	wire dbg_exception_trap_no_pcpi = (cpu_state == cpu_state_ld_rs1) && !cfg_with_pcpi && instr_trap;
+	wire dbg_exception_pcpi_ld_rs1 = (cpu_state == cpu_state_ld_rs1) && cfg_with_pcpi && cfg_enable_regs_dualport &&
+			!pcpi_busy_stall && !pcpi_int_ready && cfg_catch_illinsn && (pcpi_timeout || instr_ecall_ebreak);
+	wire dbg_exception_pcpi_exec = (cpu_state == cpu_state_exec) && cfg_with_pcpi &&
+			cfg_catch_illinsn && (pcpi_timeout || instr_ecall_ebreak);
 	wire dbg_exception_event = dbg_exception_misaligned_word || dbg_exception_misaligned_half ||
 			dbg_exception_misaligned_instr || dbg_exception_trap_no_pcpi ||
 			dbg_exception_pcpi_ld_rs1 || dbg_exception_pcpi_exec;
@@ -1459,7 +1729,7 @@ module picorv32 #(
 			dbg_rs2val_valid <= 0;
 		end
 
-		if (WITH_PCPI && CATCH_ILLINSN) begin
+		if (cfg_with_pcpi && cfg_catch_illinsn) begin
 			if (resetn && pcpi_valid && !pcpi_int_wait) begin
 				if (pcpi_timeout_counter)
 					pcpi_timeout_counter <= pcpi_timeout_counter - 1;
@@ -1468,9 +1738,35 @@ module picorv32 #(
 			pcpi_timeout <= !pcpi_timeout_counter;
 		end
 
-		if (ENABLE_COUNTERS) begin
+		if (DECOUPLED_PCPI) begin
+			if (pcpi_int_decouple) begin
+				`debug($display("PCPI_BUSY: %2d", latched_rd);)
+				pcpi_busy <= 1;
+				pcpi_busy_kill <= 0;
+				pcpi_busy_rd <= latched_rd;
+				pcpi_busy_rs1 <= reg_op1;
+				pcpi_busy_rs2 <= reg_op2;
+			end
+			if (pcpi_busy && pcpi_valid && pcpi_int_ready) begin
+				pcpi_valid <= 0;
+				pcpi_busy_done <= 1;
+				pcpi_busy_result <= pcpi_int_rd;
+				if (!pcpi_int_wr)
+					pcpi_busy_kill <= 1;
+			end
+			// a younger instruction writing the same register wins
+			if (pcpi_busy && cpuregs_write && !pcpi_busy_wb && cpuregs_waddr == pcpi_busy_rd)
+				pcpi_busy_kill <= 1;
+			if (pcpi_busy_wb) begin
+				`debug($display("PCPI_WB: %2d 0x%08x%s", pcpi_busy_rd, pcpi_busy_result, pcpi_busy_kill ? " (dropped)" : "");)
+				pcpi_busy <= 0;
+				pcpi_busy_done <= 0;
+			end
+		end
+
+		if (cfg_enable_counters) begin
 			count_cycle <= resetn ? count_cycle + 1 : 0;
-			if (!ENABLE_COUNTERS64) count_cycle[63:32] <= 0;
+			if (!cfg_enable_counters64) count_cycle[63:32] <= 0;
 		end else begin
 			count_cycle <= 'bx;
 			count_instr <= 'bx;
@@ -1505,7 +1801,7 @@ module picorv32 #(
 		if (!resetn) begin
 			reg_pc <= PROGADDR_RESET;
 			reg_next_pc <= PROGADDR_RESET;
-			if (ENABLE_COUNTERS)
+			if (cfg_enable_counters)
 				count_instr <= 0;
 			latched_store <= 0;
 			latched_stalu <= 0;
@@ -1516,6 +1812,8 @@ module picorv32 #(
 			latched_is_lb <= 0;
 			pcpi_valid <= 0;
 			pcpi_timeout <= 0;
+			pcpi_busy <= 0;
+			pcpi_busy_done <= 0;
 			irq_active <= 0;
 			irq_delay <= 0;
 			irq_mask <= ~0;
@@ -1609,9 +1907,9 @@ module picorv32 #(
 					reg_next_pc <= current_pc + (compressed_instr ? 2 : 4);
 					if (ENABLE_TRACE)
 						latched_trace <= 1;
-					if (ENABLE_COUNTERS) begin
+					if (cfg_enable_counters) begin
 						count_instr <= count_instr + 1;
-						if (!ENABLE_COUNTERS64) count_instr[63:32] <= 0;
+						if (!cfg_enable_counters64) count_instr[63:32] <= 0;
 					end
 					if (instr_jal) begin
 						mem_do_rinst <= 1;
@@ -1629,15 +1927,18 @@ module picorv32 #(
 				reg_op1 <= 'bx;
 				reg_op2 <= 'bx;
 
+				if (pcpi_busy_stall) begin
+					// wait for the co-processor (DECOUPLED_PCPI)
+				end else
 				(* parallel_case *)
 				case (1'b1)
-					(CATCH_ILLINSN || WITH_PCPI) && instr_trap: begin
-						if (WITH_PCPI) begin
+					(cfg_catch_illinsn || cfg_with_pcpi) && instr_trap: begin
+						if (cfg_with_pcpi) begin
 							`debug($display("LD_RS1: %2d 0x%08x", decoded_rs1, cpuregs_rs1);)
 							reg_op1 <= cpuregs_rs1;
 							dbg_rs1val <= cpuregs_rs1;
 							dbg_rs1val_valid <= 1;
-							if (ENABLE_REGS_DUALPORT) begin
+							if (cfg_enable_regs_dualport) begin
 								pcpi_valid <= 1;
 								`debug($display("LD_RS2: %2d 0x%08x", decoded_rs2, cpuregs_rs2);)
 								reg_sh <= cpuregs_rs2;
@@ -1651,7 +1952,11 @@ module picorv32 #(
 									latched_store <= pcpi_int_wr;
 									cpu_state <= cpu_state_fetch;
 								end else
-								if (CATCH_ILLINSN && (pcpi_timeout || instr_ecall_ebreak)) begin
+								if (pcpi_int_decouple) begin
+									mem_do_rinst <= 1;
+									cpu_state <= cpu_state_fetch;
+								end else
+								if (cfg_catch_illinsn && (pcpi_timeout || instr_ecall_ebreak)) begin
 									pcpi_valid <= 0;
 									`debug($display("EBREAK OR UNSUPPORTED INSN AT 0x%08x", reg_pc);)
 									`verbose_debug($display("EXCEPTION: EBREAK/UNSUPPORTED (PC=0x%08x INSN=0x%08x)", reg_pc, dbg_insn_opcode);)
@@ -1674,16 +1979,16 @@ module picorv32 #(
 								cpu_state <= cpu_state_trap;
 						end
 					end
-					ENABLE_COUNTERS && is_rdcycle_rdcycleh_rdinstr_rdinstrh: begin
+					cfg_enable_counters && is_rdcycle_rdcycleh_rdinstr_rdinstrh: begin
 						(* parallel_case, full_case *)
 						case (1'b1)
 							instr_rdcycle:
 								reg_out <= count_cycle[31:0];
-							instr_rdcycleh && ENABLE_COUNTERS64:
+							instr_rdcycleh && cfg_enable_counters64:
 								reg_out <= count_cycle[63:32];
 							instr_rdinstr:
 								reg_out <= count_instr[31:0];
-							instr_rdinstrh && ENABLE_COUNTERS64:
+							instr_rdinstrh && cfg_enable_counters64:
 								reg_out <= count_instr[63:32];
 						endcase
 						latched_store <= 1;
@@ -1692,7 +1997,7 @@ module picorv32 #(
 					is_lui_auipc_jal: begin
 						reg_op1 <= instr_lui ? 0 : reg_pc;
 						reg_op2 <= decoded_imm;
-						if (TWO_CYCLE_ALU)
+						if (cfg_two_cycle_alu)
 							alu_wait <= 1;
 						else
 							mem_do_rinst <= mem_do_prefetch;
@@ -1721,7 +2026,7 @@ module picorv32 #(
 						latched_branch <= 1;
 						latched_store <= 1;
 						`debug($display("LD_RS1: %2d 0x%08x", decoded_rs1, cpuregs_rs1);)
-						reg_out <= CATCH_MISALIGN ? (cpuregs_rs1 & 32'h fffffffe) : cpuregs_rs1;
+						reg_out <= cfg_catch_misalign ? (cpuregs_rs1 & 32'h fffffffe) : cpuregs_rs1;
 						dbg_rs1val <= cpuregs_rs1;
 						dbg_rs1val_valid <= 1;
 						cpu_state <= cpu_state_fetch;
@@ -1752,7 +2057,7 @@ module picorv32 #(
 						cpu_state <= cpu_state_ldmem;
 						mem_do_rinst <= 1;
 					end
-					is_slli_srli_srai && !BARREL_SHIFTER: begin
+					is_slli_srli_srai && !cfg_barrel_shifter: begin
 						`debug($display("LD_RS1: %2d 0x%08x", decoded_rs1, cpuregs_rs1);)
 						reg_op1 <= cpuregs_rs1;
 						dbg_rs1val <= cpuregs_rs1;
@@ -1760,13 +2065,13 @@ module picorv32 #(
 						reg_sh <= decoded_rs2;
 						cpu_state <= cpu_state_shift;
 					end
-					is_jalr_addi_slti_sltiu_xori_ori_andi, is_slli_srli_srai && BARREL_SHIFTER: begin
+					is_jalr_addi_slti_sltiu_xori_ori_andi, is_slli_srli_srai && cfg_barrel_shifter: begin
 						`debug($display("LD_RS1: %2d 0x%08x", decoded_rs1, cpuregs_rs1);)
 						reg_op1 <= cpuregs_rs1;
 						dbg_rs1val <= cpuregs_rs1;
 						dbg_rs1val_valid <= 1;
-						reg_op2 <= is_slli_srli_srai && BARREL_SHIFTER ? decoded_rs2 : decoded_imm;
-						if (TWO_CYCLE_ALU)
+						reg_op2 <= is_slli_srli_srai && cfg_barrel_shifter ? decoded_rs2 : decoded_imm;
+						if (cfg_two_cycle_alu)
 							alu_wait <= 1;
 						else
 							mem_do_rinst <= mem_do_prefetch;
@@ -1777,7 +2082,7 @@ module picorv32 #(
 						reg_op1 <= cpuregs_rs1;
 						dbg_rs1val <= cpuregs_rs1;
 						dbg_rs1val_valid <= 1;
-						if (ENABLE_REGS_DUALPORT) begin
+						if (cfg_enable_regs_dualport) begin
 							`debug($display("LD_RS2: %2d 0x%08x", decoded_rs2, cpuregs_rs2);)
 							reg_sh <= cpuregs_rs2;
 							reg_op2 <= cpuregs_rs2;
@@ -1789,12 +2094,12 @@ module picorv32 #(
 									cpu_state <= cpu_state_stmem;
 									mem_do_rinst <= 1;
 								end
-								is_sll_srl_sra && !BARREL_SHIFTER: begin
+								is_sll_srl_sra && !cfg_barrel_shifter: begin
 									cpu_state <= cpu_state_shift;
 								end
 								default: begin
-									if (TWO_CYCLE_ALU || (TWO_CYCLE_COMPARE && is_beq_bne_blt_bge_bltu_bgeu)) begin
-										alu_wait_2 <= TWO_CYCLE_ALU && (TWO_CYCLE_COMPARE && is_beq_bne_blt_bge_bltu_bgeu);
+									if (cfg_two_cycle_alu || (cfg_two_cycle_compare && is_beq_bne_blt_bge_bltu_bgeu)) begin
+										alu_wait_2 <= cfg_two_cycle_alu && (cfg_two_cycle_compare && is_beq_bne_blt_bge_bltu_bgeu);
 										alu_wait <= 1;
 									end else
 										mem_do_rinst <= mem_do_prefetch;
@@ -1816,7 +2121,7 @@ module picorv32 #(
 
 				(* parallel_case *)
 				case (1'b1)
-					WITH_PCPI && instr_trap: begin
+					cfg_with_pcpi && instr_trap: begin
 						pcpi_valid <= 1;
 						if (pcpi_int_ready) begin
 							mem_do_rinst <= 1;
@@ -1825,7 +2130,11 @@ module picorv32 #(
 							latched_store <= pcpi_int_wr;
 							cpu_state <= cpu_state_fetch;
 						end else
-						if (CATCH_ILLINSN && (pcpi_timeout || instr_ecall_ebreak)) begin
+						if (pcpi_int_decouple) begin
+							mem_do_rinst <= 1;
+							cpu_state <= cpu_state_fetch;
+						end else
+						if (cfg_catch_illinsn && (pcpi_timeout || instr_ecall_ebreak)) begin
 							pcpi_valid <= 0;
 							`debug($display("EBREAK OR UNSUPPORTED INSN AT 0x%08x", reg_pc);)
 							if (ENABLE_IRQ && !irq_mask[irq_ebreak] && !irq_active) begin
@@ -1839,12 +2148,12 @@ module picorv32 #(
 						cpu_state <= cpu_state_stmem;
 						mem_do_rinst <= 1;
 					end
-					is_sll_srl_sra && !BARREL_SHIFTER: begin
+					is_sll_srl_sra && !cfg_barrel_shifter: begin
 						cpu_state <= cpu_state_shift;
 					end
 					default: begin
-						if (TWO_CYCLE_ALU || (TWO_CYCLE_COMPARE && is_beq_bne_blt_bge_bltu_bgeu)) begin
-							alu_wait_2 <= TWO_CYCLE_ALU && (TWO_CYCLE_COMPARE && is_beq_bne_blt_bge_bltu_bgeu);
+						if (cfg_two_cycle_alu || (cfg_two_cycle_compare && is_beq_bne_blt_bge_bltu_bgeu)) begin
+							alu_wait_2 <= cfg_two_cycle_alu && (cfg_two_cycle_compare && is_beq_bne_blt_bge_bltu_bgeu);
 							alu_wait <= 1;
 						end else
 							mem_do_rinst <= mem_do_prefetch;
@@ -1855,17 +2164,17 @@ module picorv32 #(
 
 			cpu_state_exec: begin
 				reg_out <= reg_pc + decoded_imm;
-				if ((TWO_CYCLE_ALU || TWO_CYCLE_COMPARE) && (alu_wait || alu_wait_2)) begin
+				if ((cfg_two_cycle_alu || cfg_two_cycle_compare) && (alu_wait || alu_wait_2)) begin
 					mem_do_rinst <= mem_do_prefetch && !alu_wait_2;
 					alu_wait <= alu_wait_2;
 				end else
 				if (is_beq_bne_blt_bge_bltu_bgeu) begin
 					latched_rd <= 0;
-					latched_store <= TWO_CYCLE_COMPARE ? alu_out_0_q : alu_out_0;
-					latched_branch <= TWO_CYCLE_COMPARE ? alu_out_0_q : alu_out_0;
+					latched_store <= cfg_two_cycle_compare ? alu_out_0_q : alu_out_0;
+					latched_branch <= cfg_two_cycle_compare ? alu_out_0_q : alu_out_0;
 					if (mem_done)
 						cpu_state <= cpu_state_fetch;
-					if (TWO_CYCLE_COMPARE ? alu_out_0_q : alu_out_0) begin
+					if (cfg_two_cycle_compare ? alu_out_0_q : alu_out_0) begin
 						decoder_trigger <= 0;
 						set_mem_do_rinst = 1;
 					end
@@ -1883,7 +2192,7 @@ module picorv32 #(
 					reg_out <= reg_op1;
 					mem_do_rinst <= mem_do_prefetch;
 					cpu_state <= cpu_state_fetch;
-				end else if (TWO_STAGE_SHIFT && reg_sh >= 4) begin
+				end else if (cfg_two_stage_shift && reg_sh >= 4) begin
 					(* parallel_case, full_case *)
 					case (1'b1)
 						instr_slli || instr_sll: reg_op1 <= reg_op1 << 4;
@@ -1980,7 +2289,7 @@ module picorv32 #(
 					next_irq_pending[irq_timer] = 1;
 		end
 
-		if (CATCH_MISALIGN && resetn && (mem_do_rdata || mem_do_wdata)) begin
+		if (cfg_catch_misalign && resetn && (mem_do_rdata || mem_do_wdata)) begin
 			if (mem_wordsize == 0 && reg_op1[1:0] != 0) begin
 				latched_store <= 0;
 				latched_stalu <= 0;
@@ -2010,7 +2319,7 @@ module picorv32 #(
 					cpu_state <= cpu_state_trap;
 			end
 		end
-		if (CATCH_MISALIGN && resetn && mem_do_rinst && (COMPRESSED_ISA ? reg_pc[0] : |reg_pc[1:0])) begin
+		if (cfg_catch_misalign && resetn && mem_do_rinst && (cfg_compressed_isa ? reg_pc[0] : |reg_pc[1:0])) begin
 			`debug($display("MISALIGNED INSTRUCTION: 0x%08x", reg_pc);)
 			`verbose_debug($display("EXCEPTION: MISALIGNED_INSTRUCTION (PC=0x%08x)", reg_pc);)
 			if (ENABLE_IRQ && !irq_mask[irq_buserror] && !irq_active) begin
@@ -2018,7 +2327,7 @@ module picorv32 #(
 			end else
 				cpu_state <= cpu_state_trap;
 		end
-		if (!CATCH_ILLINSN && decoder_trigger_q && !decoder_pseudo_trigger_q && instr_ecall_ebreak) begin
+		if (!cfg_catch_illinsn && decoder_trigger_q && !decoder_pseudo_trigger_q && instr_ecall_ebreak) begin
 			cpu_state <= cpu_state_trap;
 		end
 
@@ -2038,8 +2347,8 @@ module picorv32 #(
 
 		irq_pending <= next_irq_pending & ~MASKED_IRQ;
 
-		if (!CATCH_MISALIGN) begin
-			if (COMPRESSED_ISA) begin
+		if (!cfg_catch_misalign) begin
+			if (cfg_compressed_isa) begin
 				reg_pc[0] <= 0;
 				reg_next_pc[0] <= 0;
 			end else begin
@@ -2054,9 +2363,50 @@ module picorv32 #(
 	reg dbg_irq_call;
 	reg dbg_irq_enter;
 	reg [31:0] dbg_irq_ret;
+
+	// DECOUPLED_PCPI: an instruction left on the co-processor takes its
+	// place in rvfi_order when the next instruction is launched, but it is
+	// only reported once its result is written back. Later instructions may
+	// be reported before it, each with its own rvfi_order (testbench_cli and
+	// rvfi_reorder in testbench.v put them back in order).
+	wire dbg_retire = resetn && (launch_next_insn || trap) && dbg_valid_insn;
+	reg dbg_retired;
+	reg [63:0] dbg_order;
+	reg dbg_pcpi_defer;
+	reg dbg_pcpi_emit;
+	reg [63:0] dbg_pcpi_order;
+	reg [31:0] dbg_pcpi_insn;
+	reg [31:0] dbg_pcpi_pc_rdata;
+	reg [31:0] dbg_pcpi_pc_wdata;
+	reg [ 4:0] dbg_pcpi_rs1_addr;
+	reg [ 4:0] dbg_pcpi_rs2_addr;
+	reg [31:0] dbg_pcpi_rs1_rdata;
+	reg [31:0] dbg_pcpi_rs2_rdata;
+	reg dbg_pcpi_intr;
+
 	always @(posedge clk) begin
-		rvfi_valid <= resetn && (launch_next_insn || trap) && dbg_valid_insn;
-		rvfi_order <= resetn ? rvfi_order + rvfi_valid : 0;
+		rvfi_valid <= dbg_retire && !(DECOUPLED_PCPI && dbg_pcpi_defer);
+		rvfi_order <= dbg_order;
+		dbg_order <= resetn ? dbg_order + dbg_retire : 0;
+		dbg_retired <= dbg_retire;
+		dbg_pcpi_emit <= pcpi_busy_wb;
+
+		if (!resetn || dbg_retire)
+			dbg_pcpi_defer <= 0;
+		if (pcpi_int_decouple)
+			dbg_pcpi_defer <= 1;
+
+		if (dbg_retire && dbg_pcpi_defer) begin
+			dbg_pcpi_order <= dbg_order;
+			dbg_pcpi_insn <= dbg_insn_opcode;
+			dbg_pcpi_pc_rdata <= dbg_insn_addr;
+			dbg_pcpi_pc_wdata <= dbg_irq_call ? dbg_irq_ret : next_pc;
+			dbg_pcpi_rs1_addr <= dbg_rs1val_valid ? dbg_insn_rs1 : 0;
+			dbg_pcpi_rs2_addr <= dbg_rs2val_valid ? dbg_insn_rs2 : 0;
+			dbg_pcpi_rs1_rdata <= dbg_rs1val_valid ? dbg_rs1val : 0;
+			dbg_pcpi_rs2_rdata <= dbg_rs2val_valid ? dbg_rs2val : 0;
+			dbg_pcpi_intr <= dbg_irq_enter;
+		end
 
 		rvfi_insn <= dbg_insn_opcode;
 		rvfi_rs1_addr <= dbg_rs1val_valid ? dbg_insn_rs1 : 0;
@@ -2074,7 +2424,7 @@ module picorv32 #(
 			dbg_irq_call <= 0;
 			dbg_irq_enter <= 0;
 		end else
-		if (rvfi_valid) begin
+		if (dbg_retired) begin
 			dbg_irq_call <= 0;
 			dbg_irq_enter <= dbg_irq_call;
 		end else
@@ -2135,6 +2485,25 @@ module picorv32 #(
 				rvfi_mem_wdata <= dbg_mem_wdata;
 			end
 		end
+
+		if (pcpi_busy_wb) begin
+			rvfi_valid <= 1;
+			rvfi_order <= dbg_pcpi_order;
+			rvfi_insn <= dbg_pcpi_insn;
+			rvfi_pc_rdata <= dbg_pcpi_pc_rdata;
+			rvfi_rs1_addr <= dbg_pcpi_rs1_addr;
+			rvfi_rs2_addr <= dbg_pcpi_rs2_addr;
+			rvfi_rs1_rdata <= dbg_pcpi_rs1_rdata;
+			rvfi_rs2_rdata <= dbg_pcpi_rs2_rdata;
+			rvfi_intr <= dbg_pcpi_intr;
+			rvfi_rd_addr <= pcpi_busy_rd;
+			rvfi_rd_wdata <= pcpi_busy_rd ? pcpi_busy_result : 0;
+			rvfi_mem_addr <= 0;
+			rvfi_mem_rmask <= 0;
+			rvfi_mem_wmask <= 0;
+			rvfi_mem_rdata <= 0;
+			rvfi_mem_wdata <= 0;
+		end
 	end
 
 	always @* begin
@@ -2143,6 +2512,8 @@ module picorv32 #(
 `else
 		rvfi_pc_wdata = dbg_irq_call ? dbg_irq_ret : dbg_insn_addr;
 `endif
+		if (dbg_pcpi_emit)
+			rvfi_pc_wdata = dbg_pcpi_pc_wdata;
 
 		rvfi_csr_mcycle_rmask = 0;
 		rvfi_csr_mcycle_wmask = 0;
@@ -2202,7 +2573,7 @@ module picorv32 #(
 			if (cpu_state == cpu_state_trap)   ok = 1;
 			if (cpu_state == cpu_state_fetch)  ok = 1;
 			if (cpu_state == cpu_state_ld_rs1) ok = 1;
-			if (cpu_state == cpu_state_ld_rs2) ok = !ENABLE_REGS_DUALPORT;
+			if (cpu_state == cpu_state_ld_rs2) ok = !cfg_enable_regs_dualport;
 			if (cpu_state == cpu_state_exec)   ok = 1;
 			if (cpu_state == cpu_state_shift)  ok = 1;
 			if (cpu_state == cpu_state_stmem)  ok = 1;
@@ -2272,7 +2643,8 @@ endmodule
 
 module picorv32_pcpi_mul #(
 	parameter STEPS_AT_ONCE = 1,
-	parameter CARRY_CHAIN = 4
+	parameter CARRY_CHAIN = 4,
+	parameter REUSE_RESULT = 0
 ) (
 	input clk, resetn,
 
@@ -2321,6 +2693,23 @@ module picorv32_pcpi_mul #(
 	reg mul_finish;
 	integer i, j;
 
+	// REUSE_RESULT: keep the last 64-bit product with its operands, so that
+	// the second instruction of a MULH[[S]U]/MUL pair on the same operands
+	// finishes right away. After a MUL the accumulator keeps running in the
+	// background (mul_background) to complete the unsigned product for a
+	// following MULHU. A MUL with other operands aborts it.
+	reg [63:0] reuse_rd;
+	reg [31:0] reuse_rs1, reuse_rs2;
+	reg [1:0] reuse_signed;
+	reg reuse_valid;
+	reg mul_background;
+	reg mul_reuse_wait;
+	reg mul_reused;
+
+	wire reuse_match = REUSE_RESULT && pcpi_rs1 == reuse_rs1 && pcpi_rs2 == reuse_rs2 &&
+			(!instr_any_mulh || reuse_signed == {instr_rs1_signed, instr_rs2_signed});
+	wire reuse_hit = reuse_match && (reuse_valid || mul_background);
+
 	// carry save accumulator
 	always @* begin
 		next_rd = rd;
@@ -2350,8 +2739,11 @@ module picorv32_pcpi_mul #(
 		mul_finish <= 0;
 		if (!resetn) begin
 			mul_waiting <= 1;
+			mul_background <= 0;
+			mul_reuse_wait <= 0;
+			reuse_valid <= 0;
 		end else
-		if (mul_waiting) begin
+		if (mul_waiting || (mul_background && mul_start && !reuse_hit)) begin
 			if (instr_rs1_signed)
 				rs1 <= $signed(pcpi_rs1);
 			else
@@ -2365,7 +2757,12 @@ module picorv32_pcpi_mul #(
 			rd <= 0;
 			rdx <= 0;
 			mul_counter <= (instr_any_mulh ? 63 - STEPS_AT_ONCE : 31 - STEPS_AT_ONCE);
-			mul_waiting <= !mul_start;
+			mul_waiting <= !mul_start || reuse_hit;
+			mul_background <= 0;
+			if (mul_start && reuse_hit) begin
+				mul_finish <= 1;
+				mul_reused <= 1;
+			end
 		end else begin
 			rd <= next_rd;
 			rdx <= next_rdx;
@@ -2373,9 +2770,42 @@ module picorv32_pcpi_mul #(
 			rs2 <= next_rs2;
 
 			mul_counter <= mul_counter - STEPS_AT_ONCE;
+			if (mul_background && mul_start)
+				mul_reuse_wait <= 1;
 			if (mul_counter[6]) begin
-				mul_finish <= 1;
-				mul_waiting <= 1;
+				if (mul_background) begin
+					mul_waiting <= 1;
+					mul_background <= 0;
+					mul_reuse_wait <= 0;
+					reuse_rd <= next_rd;
+					reuse_valid <= 1;
+					if (mul_reuse_wait || mul_start) begin
+						mul_finish <= 1;
+						mul_reused <= 1;
+					end
+				end else
+				if (REUSE_RESULT && !instr_any_mulh) begin
+					// low half done, continue with the high half
+					mul_finish <= 1;
+					mul_reused <= 0;
+					mul_counter <= 31 - STEPS_AT_ONCE;
+					mul_background <= 1;
+					reuse_rs1 <= pcpi_rs1;
+					reuse_rs2 <= pcpi_rs2;
+					reuse_signed <= 0;
+					reuse_valid <= 0;
+				end else begin
+					mul_finish <= 1;
+					mul_waiting <= 1;
+					mul_reused <= 0;
+					if (REUSE_RESULT) begin
+						reuse_rd <= next_rd;
+						reuse_rs1 <= pcpi_rs1;
+						reuse_rs2 <= pcpi_rs2;
+						reuse_signed <= {instr_rs1_signed, instr_rs2_signed};
+						reuse_valid <= 1;
+					end
+				end
 			end
 		end
 	end
@@ -2386,7 +2816,8 @@ module picorv32_pcpi_mul #(
 		if (mul_finish && resetn) begin
 			pcpi_wr <= 1;
 			pcpi_ready <= 1;
-			pcpi_rd <= instr_any_mulh ? rd >> 32 : rd;
+			pcpi_rd <= instr_any_mulh ? (REUSE_RESULT && mul_reused ? reuse_rd : rd) >> 32 :
+					(REUSE_RESULT && mul_reused ? reuse_rd : rd);
 		end
 	end
 endmodule
@@ -2394,7 +2825,8 @@ endmodule
 module picorv32_pcpi_fast_mul #(
 	parameter EXTRA_MUL_FFS = 0,
 	parameter EXTRA_INSN_FFS = 0,
-	parameter MUL_CLKGATE = 0
+	parameter MUL_CLKGATE = 0,
+	parameter REUSE_RESULT = 0
 ) (
 	input clk, resetn,
 
@@ -2418,6 +2850,14 @@ module picorv32_pcpi_fast_mul #(
 	reg [32:0] rs1, rs2, rs1_q, rs2_q;
 	reg [63:0] rd, rd_q;
 
+	// REUSE_RESULT: rs1/rs2 and rd still hold the operands and the 64-bit
+	// product of the last multiplication. A MUL (any signedness) or MULH*
+	// (same sign extension) on the same operands returns it one cycle later.
+	reg reuse_valid, reuse_ready;
+	wire reuse_hit = REUSE_RESULT && reuse_valid && (instr_mul ?
+			rs1[31:0] == pcpi_rs1 && rs2[31:0] == pcpi_rs2 :
+			rs1 == {instr_rs1_signed && pcpi_rs1[31], pcpi_rs1} && rs2 == {instr_rs2_signed && pcpi_rs2[31], pcpi_rs2});
+
 	wire pcpi_insn_valid = pcpi_valid && pcpi_insn[6:0] == 7'b0110011 && pcpi_insn[31:25] == 7'b0000001;
 	reg pcpi_insn_valid_q;
 
@@ -2452,7 +2892,12 @@ module picorv32_pcpi_fast_mul #(
 	end
 
 	always @(posedge clk) begin
-		if (instr_any_mul && !(EXTRA_MUL_FFS ? active[3:0] : active[1:0])) begin
+		reuse_ready <= 0;
+		if (instr_any_mul && !(EXTRA_MUL_FFS ? active[3:0] : active[1:0]) && !reuse_ready && reuse_hit) begin
+			reuse_ready <= 1;
+			active[0] <= 0;
+		end else
+		if (instr_any_mul && !(EXTRA_MUL_FFS ? active[3:0] : active[1:0]) && !reuse_ready) begin
 			if (instr_rs1_signed)
 				rs1 <= $signed(pcpi_rs1);
 			else
@@ -2463,6 +2908,7 @@ module picorv32_pcpi_fast_mul #(
 			else
 				rs2 <= $unsigned(pcpi_rs2);
 			active[0] <= 1;
+			reuse_valid <= REUSE_RESULT;
 		end else begin
 			active[0] <= 0;
 		end
@@ -2470,13 +2916,16 @@ module picorv32_pcpi_fast_mul #(
 		active[3:1] <= active;
 		shift_out <= instr_any_mulh;
 
-		if (!resetn)
+		if (!resetn) begin
 			active <= 0;
+			reuse_valid <= 0;
+			reuse_ready <= 0;
+		end
 	end
 
-	assign pcpi_wr = active[EXTRA_MUL_FFS ? 3 : 1];
+	assign pcpi_wr = active[EXTRA_MUL_FFS ? 3 : 1] || reuse_ready;
 	assign pcpi_wait = 0;
-	assign pcpi_ready = active[EXTRA_MUL_FFS ? 3 : 1];
+	assign pcpi_ready = active[EXTRA_MUL_FFS ? 3 : 1] || reuse_ready;
 `ifdef RISCV_FORMAL_ALTOPS
 	assign pcpi_rd =
 			instr_mul    ? (pcpi_rs1 + pcpi_rs2) ^ 32'h5876063e :
@@ -2586,6 +3035,182 @@ module picorv32_pcpi_div (
 endmodule
 
 
+/***************************************************************
+ * picorv32_pcpi_bitmanip
+ ***************************************************************/
+
+// Zbc (clmul, clmulh, clmulr), Zbkb (andn, orn, xnor, rol, ror, rori, pack,
+// packh, brev8, rev8, zip, unzip) and Zbkx (xperm4, xperm8). Everything but
+// the carry-less multiplication answers one cycle after pcpi_valid. clmul*
+// shifts CLMUL_STEPS_AT_ONCE bits of rs2 per cycle (a power of two up to 32)
+// and always takes 32 / CLMUL_STEPS_AT_ONCE cycles, independent of the
+// operands.
+
+module picorv32_pcpi_bitmanip #(
+	parameter CLMUL_STEPS_AT_ONCE = 4
+) (
+	input clk, resetn,
+
+	input             pcpi_valid,
+	input      [31:0] pcpi_insn,
+	input      [31:0] pcpi_rs1,
+	input      [31:0] pcpi_rs2,
+	output reg        pcpi_wr,
+	output reg [31:0] pcpi_rd,
+	output reg        pcpi_wait,
+	output reg        pcpi_ready
+);
+	reg instr_clmul, instr_clmulr, instr_clmulh;
+	reg instr_andn, instr_orn, instr_xnor, instr_rol, instr_ror, instr_rori;
+	reg instr_pack, instr_packh, instr_brev8, instr_rev8, instr_zip, instr_unzip;
+	reg instr_xperm4, instr_xperm8;
+	wire instr_any_clmul = |{instr_clmul, instr_clmulr, instr_clmulh};
+	wire instr_any_single = |{instr_andn, instr_orn, instr_xnor, instr_rol, instr_ror, instr_rori,
+			instr_pack, instr_packh, instr_brev8, instr_rev8, instr_zip, instr_unzip, instr_xperm4, instr_xperm8};
+
+	reg running;
+
+	always @* begin
+		instr_clmul = 0;
+		instr_clmulr = 0;
+		instr_clmulh = 0;
+		instr_andn = 0;
+		instr_orn = 0;
+		instr_xnor = 0;
+		instr_rol = 0;
+		instr_ror = 0;
+		instr_rori = 0;
+		instr_pack = 0;
+		instr_packh = 0;
+		instr_brev8 = 0;
+		instr_rev8 = 0;
+		instr_zip = 0;
+		instr_unzip = 0;
+		instr_xperm4 = 0;
+		instr_xperm8 = 0;
+
+		if (resetn && pcpi_valid && !pcpi_ready && !running && pcpi_insn[6:0] == 7'b0110011) begin
+			case ({pcpi_insn[31:25], pcpi_insn[14:12]})
+				{7'b0000101, 3'b001}: instr_clmul = 1;
+				{7'b0000101, 3'b010}: instr_clmulr = 1;
+				{7'b0000101, 3'b011}: instr_clmulh = 1;
+				{7'b0100000, 3'b111}: instr_andn = 1;
+				{7'b0100000, 3'b110}: instr_orn = 1;
+				{7'b0100000, 3'b100}: instr_xnor = 1;
+				{7'b0110000, 3'b001}: instr_rol = 1;
+				{7'b0110000, 3'b101}: instr_ror = 1;
+				{7'b0000100, 3'b100}: instr_pack = 1;
+				{7'b0000100, 3'b111}: instr_packh = 1;
+				{7'b0010100, 3'b010}: instr_xperm4 = 1;
+				{7'b0010100, 3'b100}: instr_xperm8 = 1;
+			endcase
+		end
+
+		if (resetn && pcpi_valid && !pcpi_ready && !running && pcpi_insn[6:0] == 7'b0010011) begin
+			instr_rori = pcpi_insn[31:25] == 7'b0110000 && pcpi_insn[14:12] == 3'b101;
+			case ({pcpi_insn[31:20], pcpi_insn[14:12]})
+				{12'h687, 3'b101}: instr_brev8 = 1;
+				{12'h698, 3'b101}: instr_rev8 = 1;
+				{12'h08f, 3'b001}: instr_zip = 1;
+				{12'h08f, 3'b101}: instr_unzip = 1;
+			endcase
+		end
+	end
+
+	reg [31:0] result;
+	reg [4:0] rotate;
+	integer i;
+
+	always @* begin
+		rotate = instr_rori ? pcpi_insn[24:20] : instr_rol ? -pcpi_rs2[4:0] : pcpi_rs2[4:0];
+		result = 'bx;
+
+		(* parallel_case *)
+		case (1'b1)
+			instr_andn: result = pcpi_rs1 & ~pcpi_rs2;
+			instr_orn:  result = pcpi_rs1 | ~pcpi_rs2;
+			instr_xnor: result = pcpi_rs1 ^ ~pcpi_rs2;
+			instr_rol || instr_ror || instr_rori:
+				result = {pcpi_rs1, pcpi_rs1} >> rotate;
+			instr_pack:  result = {pcpi_rs2[15:0], pcpi_rs1[15:0]};
+			instr_packh: result = {16'b0, pcpi_rs2[7:0], pcpi_rs1[7:0]};
+			instr_brev8:
+				for (i = 0; i < 32; i=i+1)
+					result[i] = pcpi_rs1[i ^ 7];
+			instr_rev8:  result = {pcpi_rs1[7:0], pcpi_rs1[15:8], pcpi_rs1[23:16], pcpi_rs1[31:24]};
+			instr_zip:
+				for (i = 0; i < 16; i=i+1)
+					{result[2*i+1], result[2*i]} = {pcpi_rs1[i+16], pcpi_rs1[i]};
+			instr_unzip:
+				for (i = 0; i < 16; i=i+1)
+					{result[i+16], result[i]} = {pcpi_rs1[2*i+1], pcpi_rs1[2*i]};
+			instr_xperm4:
+				for (i = 0; i < 32; i=i+4)
+					result[i +: 4] = pcpi_rs2[i+3] ? 4'b0 : pcpi_rs1 >> {pcpi_rs2[i +: 3], 2'b00};
+			instr_xperm8:
+				for (i = 0; i < 32; i=i+8)
+					result[i +: 8] = |pcpi_rs2[i+2 +: 6] ? 8'b0 : pcpi_rs1 >> {pcpi_rs2[i +: 2], 3'b000};
+		endcase
+	end
+
+	// carry-less multiplication, MSB of rs2 first
+	reg [62:0] clmul_rd, next_rd;
+	reg [31:0] clmul_rs1, clmul_rs2, next_rs2;
+	reg [5:0] clmul_counter;
+	reg clmul_high, clmul_rev;
+
+	integer j;
+
+	always @* begin
+		next_rd = clmul_rd;
+		next_rs2 = clmul_rs2;
+
+		for (j = 0; j < CLMUL_STEPS_AT_ONCE; j=j+1) begin
+			next_rd = (next_rd << 1) ^ (next_rs2[31] ? clmul_rs1 : 0);
+			next_rs2 = next_rs2 << 1;
+		end
+	end
+
+	always @(posedge clk) begin
+		pcpi_wr <= 0;
+		pcpi_ready <= 0;
+		pcpi_rd <= 'bx;
+
+		if (!resetn) begin
+			running <= 0;
+			pcpi_wait <= 0;
+		end else
+		if (running) begin
+			clmul_rd <= next_rd;
+			clmul_rs2 <= next_rs2;
+			clmul_counter <= clmul_counter - CLMUL_STEPS_AT_ONCE;
+			if (clmul_counter == CLMUL_STEPS_AT_ONCE) begin
+				running <= 0;
+				pcpi_wait <= 0;
+				pcpi_wr <= 1;
+				pcpi_ready <= 1;
+				pcpi_rd <= clmul_high ? {1'b0, next_rd[62:32]} : clmul_rev ? next_rd[62:31] : next_rd[31:0];
+			end
+		end else
+		if (instr_any_clmul) begin
+			running <= 1;
+			pcpi_wait <= 1;
+			clmul_rd <= 0;
+			clmul_rs1 <= pcpi_rs1;
+			clmul_rs2 <= pcpi_rs2;
+			clmul_counter <= 32;
+			clmul_high <= instr_clmulh;
+			clmul_rev <= instr_clmulr;
+		end else
+		if (instr_any_single) begin
+			pcpi_wr <= 1;
+			pcpi_ready <= 1;
+			pcpi_rd <= result;
+		end
+	end
+endmodule
+
+
 /***************************************************************
  * picorv32_axi
  ***************************************************************/
@@ -2605,7 +3230,11 @@ module picorv32_axi #(
 	parameter [ 0:0] ENABLE_PCPI = 0,
 	parameter [ 0:0] ENABLE_MUL = 0,
 	parameter [ 0:0] ENABLE_FAST_MUL = 0,
+	parameter [ 0:0] ENABLE_MUL_REUSE = 0,
 	parameter [ 0:0] ENABLE_DIV = 0,
+	parameter [ 0:0] DECOUPLED_PCPI = 0,
+	parameter [ 0:0] ENABLE_ZICOND = 0,
+	parameter [ 0:0] ENABLE_BITMANIP = 0,
 	parameter [ 0:0] ENABLE_IRQ = 0,
 	parameter [ 0:0] ENABLE_IRQ_QREGS = 1,
 	parameter [ 0:0] ENABLE_IRQ_TIMER = 1,
@@ -2736,7 +3365,11 @@ module picorv32_axi #(
 		.ENABLE_PCPI         (ENABLE_PCPI         ),
 		.ENABLE_MUL          (ENABLE_MUL          ),
 		.ENABLE_FAST_MUL     (ENABLE_FAST_MUL     ),
+		.ENABLE_MUL_REUSE    (ENABLE_MUL_REUSE    ),
 		.ENABLE_DIV          (ENABLE_DIV          ),
+		.DECOUPLED_PCPI      (DECOUPLED_PCPI      ),
+		.ENABLE_ZICOND       (ENABLE_ZICOND       ),
+		.ENABLE_BITMANIP     (ENABLE_BITMANIP     ),
 		.ENABLE_IRQ          (ENABLE_IRQ          ),
 		.ENABLE_IRQ_QREGS    (ENABLE_IRQ_QREGS    ),
 		.ENABLE_IRQ_TIMER    (ENABLE_IRQ_TIMER    ),
@@ -2903,7 +3536,11 @@ module picorv32_wb #(
 	parameter [ 0:0] ENABLE_PCPI = 0,
 	parameter [ 0:0] ENABLE_MUL = 0,
 	parameter [ 0:0] ENABLE_FAST_MUL = 0,
+	parameter [ 0:0] ENABLE_MUL_REUSE = 0,
 	parameter [ 0:0] ENABLE_DIV = 0,
+	parameter [ 0:0] DECOUPLED_PCPI = 0,
+	parameter [ 0:0] ENABLE_ZICOND = 0,
+	parameter [ 0:0] ENABLE_BITMANIP = 0,
 	parameter [ 0:0] ENABLE_IRQ = 0,
 	parameter [ 0:0] ENABLE_IRQ_QREGS = 1,
 	parameter [ 0:0] ENABLE_IRQ_TIMER = 1,
@@ -3000,7 +3637,11 @@ module picorv32_wb #(
 		.ENABLE_PCPI         (ENABLE_PCPI         ),
 		.ENABLE_MUL          (ENABLE_MUL          ),
 		.ENABLE_FAST_MUL     (ENABLE_FAST_MUL     ),
+		.ENABLE_MUL_REUSE    (ENABLE_MUL_REUSE    ),
 		.ENABLE_DIV          (ENABLE_DIV          ),
+		.DECOUPLED_PCPI      (DECOUPLED_PCPI      ),
+		.ENABLE_ZICOND       (ENABLE_ZICOND       ),
+		.ENABLE_BITMANIP     (ENABLE_BITMANIP     ),
 		.ENABLE_IRQ          (ENABLE_IRQ          ),
 		.ENABLE_IRQ_QREGS    (ENABLE_IRQ_QREGS    ),
 		.ENABLE_IRQ_TIMER    (ENABLE_IRQ_TIMER    ),
@@ -99,14 +99,16 @@ module spiflash (
 	assign #1 io3_delayed = io3;
 
 	// 16 MB (128Mb) Flash
-	reg [7:0] memory [0:16*1024*1024-1];
+	reg [7:0] memory [0:16*1024*1024-1] /* verilator public */;
 
+`ifndef NO_READMEMH
 	reg [1023:0] firmware_file;
 	initial begin
 		if (!$value$plusargs("firmware=%s", firmware_file))
 			firmware_file = "firmware.hex";
 		$readmemh(firmware_file, memory);
 	end
+`endif
 
 	task spi_action;
 		begin
@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+#
+# Converts the commit stream of an RVFI log (testbench_cli --rvfi-log) into
+# the text sample profile of AutoFDO (create_gcov --profiler=text), the same
+# data that create_gcov otherwise derives from perf LBR samples:
+#
+#   <number of ranges>
+#   <begin>-<end>:<count>      straight-line code from a branch target to the
+#   ...                        next taken branch (both addresses inclusive)
+#   <number of addresses>      always 0, every instruction is in a range
+#   <number of branches>
+#   <from>-><to>:<count>       taken branches, jumps, calls and returns
+#   ...
+#
+# Addresses are hex without 0x. IRQ entry is not a branch, the range before
+# it simply ends at the interrupted instruction. retirq is recorded as a
+# branch to the return address.
+#
+# Usage: rvf2afdo.py FILE.rvf [-o OUT]
+#
+
+import argparse, collections, os, sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "rvfilog"))
+from rvfilog import RvfiLog, np
+
+COLUMNS = ["pc", "pc_step", "insn"]
+
+class Profile:
+    def __init__(self):
+        self.ranges = collections.Counter()
+        self.branches = collections.Counter()
+        self.records = 0
+        # range still open at the end of the previous chunk
+        self.begin = None
+        self.last_pc = None
+        self.last_next = None
+
+    def add_chunk(self, chunk):
+        if np is not None:
+            self._add_chunk_np(chunk)
+        else:
+            self._add_chunk_list(chunk)
+        self.records += chunk["records"]
+
+    def _add_chunk_list(self, chunk):
+        for pc, step, insn in zip(chunk["pc"], chunk["pc_step"], chunk["insn"]):
+            nxt = (pc + step) & 0xffffffff
+            if self.begin is not None and pc != self.last_next:
+                self.ranges[self.begin, self.last_pc] += 1
+                self.begin = None
+            if self.begin is None:
+                self.begin = pc
+            if nxt != pc + (4 if insn & 3 == 3 else 2):
+                self.ranges[self.begin, pc] += 1
+                self.branches[pc, nxt] += 1
+                self.begin = None
+            self.last_pc = pc
+            self.last_next = nxt
+
+    def _add_chunk_np(self, chunk):
+        pc = chunk["pc"].astype(np.int64)
+        nxt = (pc + chunk["pc_step"].astype(np.int64)) & 0xffffffff
+        taken = nxt != pc + np.where(chunk["insn"] & 3 == 3, 4, 2)
+        prev_next = np.empty_like(pc)
+        prev_next[1:] = nxt[:-1]
+        prev_next[0] = -1 if self.last_next is None else self.last_next
+        disc = pc != prev_next
+
+        # A range starts after a taken branch or a discontinuity, and ends
+        # at a taken branch or right before a discontinuity. A discontinuity
+        # after the last record only shows up in the next chunk.
+        start = disc.copy()
+        start[1:] |= taken[:-1]
+        if self.begin is None:
+            start[0] = True
+        end = taken.copy()
+        end[:-1] |= disc[1:]
+
+        if self.begin is not None and disc[0]:
+            self.ranges[self.begin, self.last_pc] += 1
+            self.begin = None
+        begins = pc[start]
+        ends = pc[end]
+        if self.begin is not None:
+            begins = np.concatenate(([self.begin], begins))
+        self.begin = int(begins[-1]) if len(begins) > len(ends) else None
+        self._count(self.ranges, begins[:len(ends)], ends)
+        self._count(self.branches, pc[taken], nxt[taken])
+        self.last_pc = int(pc[-1])
+        self.last_next = int(nxt[-1])
+
+    @staticmethod
+    def _count(counter, a, b):
+        keys, n = np.unique(a.astype(np.uint64) << np.uint64(32) | b.astype(np.uint64), return_counts=True)
+        for key, count in zip(keys.tolist(), n.tolist()):
+            counter[key >> 32, key & 0xffffffff] += count
+
+    def finish(self):
+        if self.begin is not None:
+            self.ranges[self.begin, self.last_pc] += 1
+            self.begin = None
+
+    def write(self, f):
+        f.write("%d\n" % len(self.ranges))
+        for (begin, end), count in sorted(self.ranges.items()):
+            f.write("%x-%x:%d\n" % (begin, end, count))
+        f.write("0\n")
+        f.write("%d\n" % len(self.branches))
+        for (src, dst), count in sorted(self.branches.items()):
+            f.write("%x->%x:%d\n" % (src, dst, count))
+
+def main():
+    parser = argparse.ArgumentParser(description="Convert an RVFI log to an AutoFDO text profile")
+    parser.add_argument("file", help="RVFI log written by testbench_cli --rvfi-log")
+    parser.add_argument("-o", "--output", help="output file (default: stdout)")
+    args = parser.parse_args()
+
+    profile = Profile()
+    for chunk in RvfiLog(args.file).chunks(COLUMNS):
+        profile.add_chunk(chunk)
+    profile.finish()
+
+    if args.output:
+        with open(args.output, "w") as f:
+            profile.write(f)
+    else:
+        profile.write(sys.stdout)
+    taken = sum(profile.branches.values())
+    sys.stderr.write("%d instructions, %d taken branches (%d sites), %d ranges\n" % (
+        profile.records, taken, len(profile.branches), len(profile.ranges)))
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,323 @@
+// Offline cache design-space sweep over a memory trace recorded with
+// testbench_cli --memtrace=FILE (see memtrace.h)
+//
+// Simulates every combination of cache size, associativity, line size and
+// next-line prefetch for the instruction stream (i), the data stream (d)
+// and/or both streams in one cache (u) and prints a CSV line per
+// configuration. All caches use LRU replacement and allocate on load and
+// store misses.
+//
+// Without prefetch, LRU caches with the same line size and number of sets
+// are simulated in one pass (Mattson stack distances): an access hits in an
+// A-way cache iff its LRU stack depth within the set is below A, so a single
+// depth histogram gives the misses of all associativities at once. Prefetch
+// breaks the inclusion property and those configurations are simulated one
+// by one. The passes run in parallel on all cores.
+//
+// Usage: cachesim [options] trace.bin
+//   --caches=LIST     any of i,d,u (default: i,d,u)
+//   --sizes=LIST      cache sizes in bytes, K suffix allowed (default: 512,1K,...,64K)
+//   --assocs=LIST     associativities (default: 1,2,4,8)
+//   --lines=LIST      line sizes in bytes (default: 16,32,64)
+//   --prefetch=LIST   0 and/or 1 (default: 0,1)
+//   --miss-penalty=N  cycles per miss for the AMAT column (default: 20)
+//   -j N              number of threads (default: all cores)
+
+#include "memtrace.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cinttypes>
+#include <string>
+#include <vector>
+#include <map>
+#include <tuple>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+struct CacheConfig {
+    char cache;
+    uint32_t size;
+    uint32_t assoc;
+    uint32_t line;
+    bool prefetch;
+};
+
+struct CacheResult {
+    uint64_t accesses[3];
+    uint64_t misses[3];
+    uint64_t prefetches;
+};
+
+// One trace stream: line-independent word address and access kind
+struct Access {
+    uint32_t addr;
+    uint8_t kind;
+};
+
+static int log2i(uint32_t x) {
+    int n = 0;
+    while ((1u << n) < x)
+        n++;
+    return n;
+}
+
+// One pass with LRU stack depths for all associativities up to max_assoc of
+// caches with the given line size and number of sets
+struct StackTask {
+    const std::vector<Access>* stream;
+    uint32_t line, sets, max_assoc;
+    std::vector<uint64_t> depth_hist[3];  // hits at depth 0..max_assoc-1
+    uint64_t accesses[3];
+
+    void run() {
+        int line_bits = log2i(line);
+        std::vector<uint32_t> stacks((size_t)sets * max_assoc, UINT32_MAX);
+        std::vector<uint32_t> fill(sets, 0);
+        for (int k = 0; k < 3; k++) {
+            depth_hist[k].assign(max_assoc, 0);
+            accesses[k] = 0;
+        }
+        for (const Access& a : *stream) {
+            uint32_t block = a.addr >> line_bits;
+            uint32_t* s = &stacks[(size_t)(block & (sets - 1)) * max_assoc];
+            uint32_t& n = fill[block & (sets - 1)];
+            accesses[a.kind]++;
+            uint32_t d = 0;
+            while (d < n && s[d] != block)
+                d++;
+            if (d < n)
+                depth_hist[a.kind][d]++;
+            else if (n < max_assoc)
+                n++;
+            else
+                d = max_assoc - 1;
+            memmove(s + 1, s, d * sizeof(uint32_t));
+            s[0] = block;
+        }
+    }
+
+    CacheResult result(uint32_t assoc) const {
+        CacheResult r;
+        for (int k = 0; k < 3; k++) {
+            uint64_t hits = 0;
+            for (uint32_t d = 0; d < assoc; d++)
+                hits += depth_hist[k][d];
+            r.accesses[k] = accesses[k];
+            r.misses[k] = accesses[k] - hits;
+        }
+        r.prefetches = 0;
+        return r;
+    }
+};
+
+// One pass for a single LRU cache with next-line prefetch: on a demand miss
+// the following line is brought in as well, unless it is already cached
+struct PrefetchTask {
+    const std::vector<Access>* stream;
+    CacheConfig config;
+    CacheResult res;
+
+    void run() {
+        int line_bits = log2i(config.line);
+        uint32_t sets = config.size / (config.line * config.assoc);
+        uint32_t ways = config.assoc;
+        std::vector<uint32_t> stacks((size_t)sets * ways, UINT32_MAX);
+        memset(&res, 0, sizeof(res));
+
+        // Returns true on a hit; the block ends up most recently used either way
+        auto touch = [&](uint32_t block) {
+            uint32_t* s = &stacks[(size_t)(block & (sets - 1)) * ways];
+            uint32_t d = 0;
+            while (d < ways - 1 && s[d] != block)
+                d++;
+            bool hit = s[d] == block;
+            memmove(s + 1, s, d * sizeof(uint32_t));
+            s[0] = block;
+            return hit;
+        };
+        auto present = [&](uint32_t block) {
+            uint32_t* s = &stacks[(size_t)(block & (sets - 1)) * ways];
+            return std::find(s, s + ways, block) != s + ways;
+        };
+
+        for (const Access& a : *stream) {
+            uint32_t block = a.addr >> line_bits;
+            res.accesses[a.kind]++;
+            if (!touch(block)) {
+                res.misses[a.kind]++;
+                if (!present(block + 1)) {
+                    touch(block + 1);
+                    res.prefetches++;
+                }
+            }
+        }
+    }
+};
+
+static bool parse_list(const char* s, std::vector<uint32_t>& list) {
+    list.clear();
+    while (*s) {
+        char* end;
+        unsigned long v = strtoul(s, &end, 0);
+        if (end == s)
+            return false;
+        if (*end == 'K' || *end == 'k')
+            v *= 1024, end++;
+        list.push_back(v);
+        s = *end == ',' ? end + 1 : end;
+    }
+    return !list.empty();
+}
+
+static bool is_pow2(uint32_t x) {
+    return x && !(x & (x - 1));
+}
+
+static void print_usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [options] trace.bin\n", prog);
+    fprintf(stderr, "  --caches=LIST     any of i,d,u (default: i,d,u)\n");
+    fprintf(stderr, "  --sizes=LIST      cache sizes in bytes, K suffix allowed (default: 512,1K,...,64K)\n");
+    fprintf(stderr, "  --assocs=LIST     associativities (default: 1,2,4,8)\n");
+    fprintf(stderr, "  --lines=LIST      line sizes in bytes (default: 16,32,64)\n");
+    fprintf(stderr, "  --prefetch=LIST   0 and/or 1 (default: 0,1)\n");
+    fprintf(stderr, "  --miss-penalty=N  cycles per miss for the AMAT column (default: 20)\n");
+    fprintf(stderr, "  -j N              number of threads (default: all cores)\n");
+}
+
+int main(int argc, char** argv) {
+    const char* trace_file = nullptr;
+    std::string caches = "i,d,u";
+    std::vector<uint32_t> sizes = {512, 1024, 2048, 4096, 8192, 16384, 32768, 65536};
+    std::vector<uint32_t> assocs = {1, 2, 4, 8};
+    std::vector<uint32_t> lines = {16, 32, 64};
+    std::vector<uint32_t> prefetch = {0, 1};
+    double miss_penalty = 20;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (int i = 1; i < argc; i++) {
+        bool ok = true;
+        if (strncmp(argv[i], "--caches=", 9) == 0)
+            caches = argv[i] + 9;
+        else if (strncmp(argv[i], "--sizes=", 8) == 0)
+            ok = parse_list(argv[i] + 8, sizes);
+        else if (strncmp(argv[i], "--assocs=", 9) == 0)
+            ok = parse_list(argv[i] + 9, assocs);
+        else if (strncmp(argv[i], "--lines=", 8) == 0)
+            ok = parse_list(argv[i] + 8, lines);
+        else if (strncmp(argv[i], "--prefetch=", 11) == 0)
+            ok = parse_list(argv[i] + 11, prefetch);
+        else if (strncmp(argv[i], "--miss-penalty=", 15) == 0)
+            miss_penalty = atof(argv[i] + 15);
+        else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+            threads = std::max(1, atoi(argv[++i]));
+        else if (argv[i][0] == '-') {
+            print_usage(argv[0]);
+            return strcmp(argv[i], "-h") && strcmp(argv[i], "--help") ? 1 : 0;
+        } else
+            trace_file = argv[i];
+        if (!ok) {
+            fprintf(stderr, "Error: Invalid list in %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (!trace_file) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    for (auto v : {&sizes, &assocs, &lines})
+        for (uint32_t x : *v)
+            if (!is_pow2(x)) {
+                fprintf(stderr, "Error: Sizes, associativities and line sizes must be powers of two\n");
+                return 1;
+            }
+
+    // Load the trace, split into the streams
+    MemTraceReader reader;
+    if (!reader.open(trace_file)) {
+        fprintf(stderr, "Error: Cannot read memory trace '%s'\n", trace_file);
+        return 1;
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::map<char, std::vector<Access>> streams;
+    MemTraceRecord r;
+    while (reader.next(&r)) {
+        Access a = {r.addr, r.kind};
+        if (caches.find('u') != std::string::npos)
+            streams['u'].push_back(a);
+        if (caches.find(r.kind == MEMTRACE_FETCH ? 'i' : 'd') != std::string::npos)
+            streams[r.kind == MEMTRACE_FETCH ? 'i' : 'd'].push_back(a);
+    }
+
+    // Enumerate the configurations and group them into passes
+    std::vector<CacheConfig> configs;
+    for (char cache : std::string("idu"))
+        if (caches.find(cache) != std::string::npos)
+            for (uint32_t size : sizes)
+                for (uint32_t assoc : assocs)
+                    for (uint32_t line : lines)
+                        for (uint32_t pf : prefetch)
+                            if (line * assoc <= size)
+                                configs.push_back({cache, size, assoc, line, pf != 0});
+
+    std::map<std::tuple<char, uint32_t, uint32_t>, size_t> stack_index;
+    std::vector<StackTask> stack_tasks;
+    std::vector<PrefetchTask> prefetch_tasks;
+    std::vector<size_t> config_task(configs.size());
+    for (size_t i = 0; i < configs.size(); i++) {
+        const CacheConfig& c = configs[i];
+        const std::vector<Access>* stream = &streams[c.cache];
+        if (c.prefetch) {
+            config_task[i] = prefetch_tasks.size();
+            prefetch_tasks.push_back({stream, c, {}});
+            continue;
+        }
+        uint32_t sets = c.size / (c.line * c.assoc);
+        auto key = std::make_tuple(c.cache, c.line, sets);
+        auto it = stack_index.find(key);
+        if (it == stack_index.end()) {
+            it = stack_index.insert({key, stack_tasks.size()}).first;
+            stack_tasks.push_back(StackTask());
+            stack_tasks.back().stream = stream;
+            stack_tasks.back().line = c.line;
+            stack_tasks.back().sets = sets;
+            stack_tasks.back().max_assoc = 0;
+        }
+        stack_tasks[it->second].max_assoc = std::max(stack_tasks[it->second].max_assoc, c.assoc);
+        config_task[i] = it->second;
+    }
+
+    // Run the passes on a pool of threads
+    size_t total_tasks = stack_tasks.size() + prefetch_tasks.size();
+    std::atomic<size_t> next_task(0);
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < threads; t++)
+        pool.emplace_back([&]() {
+            for (size_t i; (i = next_task++) < total_tasks;) {
+                if (i < stack_tasks.size())
+                    stack_tasks[i].run();
+                else
+                    prefetch_tasks[i - stack_tasks.size()].run();
+            }
+        });
+    for (auto& t : pool)
+        t.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("cache,size,assoc,line,prefetch,accesses,misses,fetch_misses,load_misses,store_misses,miss_rate,prefetches,amat\n");
+    for (size_t i = 0; i < configs.size(); i++) {
+        const CacheConfig& c = configs[i];
+        CacheResult res = c.prefetch ? prefetch_tasks[config_task[i]].res : stack_tasks[config_task[i]].result(c.assoc);
+        uint64_t accesses = res.accesses[0] + res.accesses[1] + res.accesses[2];
+        uint64_t misses = res.misses[0] + res.misses[1] + res.misses[2];
+        double miss_rate = accesses ? (double)misses / accesses : 0.0;
+        printf("%c,%u,%u,%u,%d,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%.5f,%" PRIu64 ",%.3f\n",
+               c.cache, c.size, c.assoc, c.line, c.prefetch, accesses, misses,
+               res.misses[0], res.misses[1], res.misses[2], miss_rate, res.prefetches, 1 + miss_rate * miss_penalty);
+    }
+    fprintf(stderr, "%zu configurations in %zu passes on %u threads, %.3f s\n",
+            configs.size(), total_tasks, threads, seconds);
+    return 0;
+}
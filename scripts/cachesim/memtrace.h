@@ -0,0 +1,132 @@
+// Compact binary memory trace, written by testbench_cli --memtrace and read
+// by scripts/cachesim. The file starts with the 8 byte magic "PRVMTR01",
+// followed by one record per transfer on the native memory interface:
+//
+//   u8      kind | wstrb << 2   (kind: 0 fetch, 1 load, 2 store)
+//   varint  cycle delta to the previous record
+//   varint  zigzag address delta to the previous record of the same kind
+//
+// Varints are LEB128. Sequential fetches and stack accesses encode in three
+// bytes per record.
+
+#ifndef MEMTRACE_H
+#define MEMTRACE_H
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+
+enum MemTraceKind { MEMTRACE_FETCH = 0, MEMTRACE_LOAD = 1, MEMTRACE_STORE = 2 };
+
+struct MemTraceRecord {
+    uint64_t cycle;
+    uint32_t addr;
+    uint8_t kind;
+    uint8_t wstrb;
+};
+
+static const char memtrace_magic[8] = {'P', 'R', 'V', 'M', 'T', 'R', '0', '1'};
+
+class MemTraceWriter {
+private:
+    FILE* f;
+    uint64_t last_cycle;
+    uint32_t last_addr[3];
+
+    void put_varint(uint64_t x) {
+        while (x >= 0x80) {
+            putc((int)(x & 0x7f) | 0x80, f);
+            x >>= 7;
+        }
+        putc((int)x, f);
+    }
+
+public:
+    uint64_t records;
+
+    MemTraceWriter() : f(NULL), last_cycle(0), records(0) {
+        memset(last_addr, 0, sizeof(last_addr));
+    }
+
+    ~MemTraceWriter() { close(); }
+
+    bool open(const char* filename) {
+        f = fopen(filename, "wb");
+        if (!f)
+            return false;
+        setvbuf(f, NULL, _IOFBF, 1 << 20);
+        fwrite(memtrace_magic, 1, sizeof(memtrace_magic), f);
+        return true;
+    }
+
+    void write(const MemTraceRecord& r) {
+        putc(r.kind | r.wstrb << 2, f);
+        put_varint(r.cycle - last_cycle);
+        int32_t delta = (int32_t)(r.addr - last_addr[r.kind]);
+        put_varint(((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31));
+        last_cycle = r.cycle;
+        last_addr[r.kind] = r.addr;
+        records++;
+    }
+
+    void close() {
+        if (f)
+            fclose(f);
+        f = NULL;
+    }
+};
+
+class MemTraceReader {
+private:
+    FILE* f;
+    uint64_t last_cycle;
+    uint32_t last_addr[3];
+
+    bool get_varint(uint64_t* x) {
+        *x = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            int c = getc(f);
+            if (c == EOF)
+                return false;
+            *x |= (uint64_t)(c & 0x7f) << shift;
+            if (!(c & 0x80))
+                return true;
+        }
+        return false;
+    }
+
+public:
+    MemTraceReader() : f(NULL), last_cycle(0) {
+        memset(last_addr, 0, sizeof(last_addr));
+    }
+
+    ~MemTraceReader() {
+        if (f)
+            fclose(f);
+    }
+
+    bool open(const char* filename) {
+        char magic[8];
+        f = fopen(filename, "rb");
+        if (!f)
+            return false;
+        setvbuf(f, NULL, _IOFBF, 1 << 20);
+        return fread(magic, 1, sizeof(magic), f) == sizeof(magic) && !memcmp(magic, memtrace_magic, sizeof(magic));
+    }
+
+    // Returns false at the end of the trace (or on a truncated record)
+    bool next(MemTraceRecord* r) {
+        int c = getc(f);
+        uint64_t dcycle, zaddr;
+        if (c == EOF || (c & 3) == 3 || !get_varint(&dcycle) || !get_varint(&zaddr))
+            return false;
+        r->kind = c & 3;
+        r->wstrb = (c >> 2) & 15;
+        r->cycle = last_cycle += dcycle;
+        int32_t delta = (int32_t)((uint32_t)(zaddr >> 1) ^ -(uint32_t)(zaddr & 1));
+        r->addr = last_addr[r->kind] += delta;
+        return true;
+    }
+};
+
+#endif
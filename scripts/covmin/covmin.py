@@ -0,0 +1,65 @@
+#!/usr/bin/env python3
+#
+# Pick a small subset of tests that reaches the same functional coverage as
+# the full set, from the files written by "testbench_cli --coverage=FILE".
+# Greedy set cover: repeatedly take the test that adds the most uncovered
+# bins (ties go to the test with fewer simulation cycles).
+#
+# Usage: covmin.py [-x REGEX] [-n N] [-o LIST] FILE.cov ...
+#
+
+import argparse, re, sys
+
+parser = argparse.ArgumentParser(description="Minimize a regression by functional coverage")
+parser.add_argument("files", nargs="+", help="coverage files written by testbench_cli --coverage")
+parser.add_argument("-x", "--exclude", action="append", default=[], metavar="REGEX",
+                    help="ignore bins matching REGEX (may be given more than once)")
+parser.add_argument("-n", "--min-count", type=int, default=1, metavar="N",
+                    help="only count bins that a test hits at least N times")
+parser.add_argument("-o", "--output", metavar="LIST", help="write the selected tests to LIST (default: stdout)")
+args = parser.parse_args()
+
+exclude = [re.compile(x) for x in args.exclude]
+
+tests = []
+for filename in args.files:
+    name = filename
+    cycles = 0
+    bins = set()
+    with open(filename, "r") as f:
+        for line in f:
+            line = line.rstrip("\n")
+            if line.startswith("# elf "):
+                name = line[6:]
+            elif line.startswith("# cycles "):
+                cycles = int(line.split()[2])
+            elif line and not line.startswith("#"):
+                count, bin = line.split(" ", 1)
+                if int(count) >= args.min_count and not any(x.search(bin) for x in exclude):
+                    bins.add(bin)
+    tests.append((name, cycles, bins))
+
+universe = set().union(*(t[2] for t in tests))
+uncovered = set(universe)
+remaining = list(tests)
+selected = []
+
+while uncovered and remaining:
+    best = max(remaining, key=lambda t: (len(t[2] & uncovered), -t[1]))
+    gain = best[2] & uncovered
+    if not gain:
+        break
+    selected.append((best, len(gain)))
+    uncovered -= gain
+    remaining.remove(best)
+
+total_cycles = sum(t[1] for t in tests)
+selected_cycles = sum(t[1] for t, _ in selected)
+print("%d of %d tests cover all %d bins (%d of %d cycles)" % (len(selected), len(tests),
+        len(universe), selected_cycles, total_cycles), file=sys.stderr)
+for (name, cycles, bins), gain in selected:
+    print("  %-40s +%d bins" % (name, gain), file=sys.stderr)
+
+with open(args.output, "w") if args.output else sys.stdout as f:
+    for (name, cycles, bins), gain in selected:
+        print(name, file=f)
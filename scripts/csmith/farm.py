@@ -0,0 +1,205 @@
+#!/usr/bin/env python3
+#
+# Parallel csmith fuzzing farm for picorv32.
+#
+# Every worker keeps one "obj_dir/Vtestbench --batch" process running (see
+# testbench.cc) and feeds it one program after the other. For every seed the
+# worker
+#   - generates test.c with csmith
+#   - builds and runs it on the host (gcc -m32); programs that do not build
+#     or run within 2 seconds are skipped
+#   - builds test.elf for picorv32 and passes its path to the resident model,
+#     which copies it into memory, runs it on the core and on the reference
+#     model and returns the hashes of both outputs
+# and compares the core and reference hashes with the hash of the host
+# output. Only failing seeds are kept, in OUTDIR/seed_<S>/ with the program,
+# the expected output and a repro.sh.
+#
+# Usage: farm.py [-j N] [-n N] [--seed S] [-o OUTDIR] [--max-cycles N]
+#
+
+import argparse, glob, os, random, shutil, subprocess, sys, threading, time
+
+srcdir = os.path.dirname(os.path.abspath(__file__))
+
+parser = argparse.ArgumentParser(description="picorv32 csmith fuzzing farm")
+parser.add_argument("-j", "--jobs", type=int, default=os.cpu_count(), metavar="N",
+                    help="number of workers (default: number of CPUs)")
+parser.add_argument("-n", "--count", type=int, default=0, metavar="N", help="number of seeds (default: run forever)")
+parser.add_argument("--seed", type=int, default=None, metavar="S", help="first seed (default: random)")
+parser.add_argument("-o", "--outdir", default="failures", metavar="DIR", help="failing seeds (default: failures)")
+parser.add_argument("-w", "--workdir", default="farm", metavar="DIR", help="work directory (default: farm)")
+parser.add_argument("--max-cycles", type=int, default=100000000, metavar="N", help="per-program cycle limit")
+parser.add_argument("--csmith", default=os.environ.get("CSMITH", "csmith"))
+parser.add_argument("--riscv-prefix", default=os.environ.get("RISCV_TOOLS_PREFIX",
+                    "/opt/riscv32imc/bin/riscv32-unknown-elf-"), metavar="PREFIX")
+args = parser.parse_args()
+
+model = os.path.join(srcdir, "obj_dir", "Vtestbench")
+ldscript = os.path.join(srcdir, "test.ld")
+for f in (model, ldscript):
+    if not os.path.exists(f):
+        print("Error: %s not found (run 'make obj_dir/Vtestbench test.ld')" % f, file=sys.stderr)
+        sys.exit(1)
+
+incdirs = sorted(glob.glob("/usr/local/include/csmith-*"))
+cflags = ["-w", "-Os"] + ["-I" + d for d in incdirs[:1]]
+
+def fnv1a(data):
+    h = 0xcbf29ce484222325
+    for c in data:
+        h = ((h ^ c) * 0x100000001b3) & 0xffffffffffffffff
+    return h
+
+class Stats:
+    def __init__(self, seed):
+        self.lock = threading.Lock()
+        self.next_seed = seed
+        self.issued = 0
+        self.passed = self.failed = self.skipped = 0
+        self.cycles = 0
+
+    def take_seed(self):
+        with self.lock:
+            if args.count and self.issued >= args.count:
+                return None
+            self.issued += 1
+            self.next_seed += 1
+            return self.next_seed - 1
+
+class Worker:
+    def __init__(self, index):
+        self.dir = os.path.abspath(os.path.join(args.workdir, "w%d" % index))
+        os.makedirs(self.dir, exist_ok=True)
+        with open(os.path.join(self.dir, "platform.info"), "w") as f:
+            f.write("integer size = 4\npointer size = 4\n")
+        self.proc = None
+
+    def start(self):
+        self.proc = subprocess.Popen([model, "--batch", "--max-cycles=%d" % args.max_cycles],
+                                     stdin=subprocess.PIPE, stdout=subprocess.PIPE, universal_newlines=True, bufsize=1)
+
+    def simulate(self, elf):
+        if self.proc is None or self.proc.poll() is not None:
+            self.start()
+        try:
+            self.proc.stdin.write(elf + "\n")
+            self.proc.stdin.flush()
+            line = self.proc.stdout.readline().split()
+        except BrokenPipeError:
+            line = []
+        if len(line) != 5 or line[0] != elf:
+            self.proc.kill()
+            self.proc.wait()
+            self.proc = None
+            return "crash", None, None, 0
+        return line[1], int(line[2], 16), int(line[3], 16), int(line[4])
+
+    def run(self, seed):
+        def path(name):
+            return os.path.join(self.dir, name)
+
+        for f in ("test.c", "test_ref", "test.elf"):
+            if os.path.exists(path(f)):
+                os.remove(path(f))
+
+        subprocess.run([args.csmith, "--no-packed-struct", "--seed", str(seed), "-o", "test.c"],
+                       cwd=self.dir, stdout=subprocess.DEVNULL, check=True)
+
+        if subprocess.run(["gcc", "-m32", "-o", path("test_ref")] + cflags + [path("test.c")]).returncode != 0:
+            return "skip", None
+        try:
+            ref = subprocess.run([path("test_ref")], stdout=subprocess.PIPE, timeout=2)
+        except subprocess.TimeoutExpired:
+            return "skip", None
+        if ref.returncode != 0:
+            return "skip", None
+
+        build = subprocess.run([args.riscv_prefix + "gcc", "-o", path("test.elf")] + cflags +
+                               ["-T", ldscript, path("test.c"), os.path.join(srcdir, "syscalls.c"),
+                                os.path.join(srcdir, "start.S")])
+        if build.returncode != 0:
+            return "skip", None
+
+        status, core_hash, iss_hash, cycles = self.simulate(path("test.elf"))
+        expected = fnv1a(ref.stdout)
+        with stats.lock:
+            stats.cycles += cycles
+        if status == "ok" and core_hash == expected:
+            return "pass", None
+        if status == "ok":
+            status = "mismatch"
+        reason = "%s: core %s, reference model %s, host %016x, %d cycles" % (status,
+                 "%016x" % core_hash if core_hash is not None else "-",
+                 "%016x" % iss_hash if iss_hash is not None else "-", expected, cycles)
+        self.save(seed, reason, ref.stdout)
+        return "fail", reason
+
+    def save(self, seed, reason, ref_output):
+        dest = os.path.abspath(os.path.join(args.outdir, "seed_%d" % seed))
+        os.makedirs(dest, exist_ok=True)
+        for f in ("test.c", "test.elf"):
+            shutil.copy(os.path.join(self.dir, f), dest)
+        with open(os.path.join(dest, "output_ref.txt"), "wb") as f:
+            f.write(ref_output)
+        with open(os.path.join(dest, "repro.sh"), "w") as f:
+            f.write("#!/bin/bash\n")
+            f.write("# csmith seed %d\n# %s\n" % (seed, reason))
+            f.write("# regenerate: csmith --no-packed-struct --seed %d -o test.c\n" % seed)
+            f.write("set -e\ncd \"$(dirname \"$0\")\"\n")
+            f.write("make -C %s obj_dir/Vtestbench\n" % srcdir)
+            f.write("%s test.elf > output_sim.txt || echo \"exit status $?\"\n" % model)
+            f.write("diff -u output_ref.txt output_sim.txt\n")
+        os.chmod(os.path.join(dest, "repro.sh"), 0o755)
+
+    def loop(self):
+        while not stop.is_set():
+            seed = stats.take_seed()
+            if seed is None:
+                break
+            try:
+                result, reason = self.run(seed)
+            except subprocess.CalledProcessError:
+                result, reason = "skip", None
+            with stats.lock:
+                if result == "pass":
+                    stats.passed += 1
+                elif result == "skip":
+                    stats.skipped += 1
+                else:
+                    stats.failed += 1
+                    print("FAILED seed %d: %s" % (seed, reason), flush=True)
+        if self.proc is not None:
+            self.proc.stdin.close()
+            self.proc.wait()
+
+stats = Stats(args.seed if args.seed is not None else random.randrange(1, 1 << 31))
+stop = threading.Event()
+print("Running %d workers from seed %d, failing seeds go to %s/" % (args.jobs, stats.next_seed, args.outdir), flush=True)
+
+workers = [Worker(i) for i in range(args.jobs)]
+threads = [threading.Thread(target=w.loop) for w in workers]
+for t in threads:
+    t.start()
+
+start = time.time()
+def report():
+    secs = time.time() - start
+    done = stats.passed + stats.failed
+    print("%d passed, %d failed, %d skipped, %.1f tests/s, %.0f Mcycles/s" % (stats.passed, stats.failed,
+          stats.skipped, done / secs if secs else 0, stats.cycles / secs / 1e6 if secs else 0), flush=True)
+
+try:
+    while any(t.is_alive() for t in threads):
+        deadline = time.time() + 10
+        for t in threads:
+            t.join(max(0, deadline - time.time()))
+        report()
+except KeyboardInterrupt:
+    stop.set()
+    print("Stopping...", flush=True)
+    for t in threads:
+        t.join()
+    report()
+
+sys.exit(1 if stats.failed else 0)
@@ -1,18 +1,131 @@
 #include "Vtestbench.h"
+#include "Vtestbench_testbench.h"
 #include "verilated.h"
+#include "../../testbench_loader.h"
+#include "../rigen/rigen.h"
+
+#include <cinttypes>
+#include <string>
+
+// Usage: Vtestbench [test.elf]
+//        Vtestbench --batch [--max-cycles=N]
+//
+// Without --batch, run one program (default test.elf) and print its output.
+//
+// With --batch, the model stays resident and runs the programs whose paths
+// are read from stdin, one per line. Each program is copied into the memory
+// array, the core is reset and run until it traps, and the same program
+// is run on the reference model from scripts/rigen/rigen.h. For every
+// program one line is written to stdout:
+//
+//   <elf> <status> <core-hash> <ref-hash> <cycles>
+//
+// status is "ok" (hashes match), "mismatch", "timeout" or "ref-error"
+// (the reference model stopped on an instruction it does not support). The
+// hashes are 64-bit FNV-1a over the console output (bytes written to
+// 0x10000000), as computed by farm.py for the host build of the program.
+
+#define MEM_SIZE (4*1024*1024)
+
+static uint64_t fnv1a(const std::string& s) {
+	uint64_t h = 0xcbf29ce484222325ull;
+	for (unsigned char c : s) {
+		h ^= c;
+		h *= 0x100000001b3ull;
+	}
+	return h;
+}
+
+static void tick(Vtestbench* top, std::string* console) {
+	top->clk = 1;
+	top->eval();
+	if (console && top->console_valid)
+		*console += (char)top->console_data;
+	top->clk = 0;
+	top->eval();
+}
+
+// Reset the core, run until trap or max_cycles; returns the cycle count
+static uint64_t run(Vtestbench* top, uint64_t max_cycles, std::string* console) {
+	top->resetn = 0;
+	for (int i = 0; i < 100; i++)
+		tick(top, nullptr);
+	top->resetn = 1;
+	uint64_t cycles = 0;
+	while (!top->trap && cycles < max_cycles) {
+		tick(top, console);
+		cycles++;
+	}
+	return cycles;
+}
 
 int main(int argc, char **argv, char **env)
 {
 	Verilated::commandArgs(argc, argv);
+
+	bool batch = false;
+	uint64_t max_cycles = 100000000;
+	const char* elf = "test.elf";
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--batch"))
+			batch = true;
+		else if (!strncmp(argv[i], "--max-cycles=", 13))
+			max_cycles = strtoull(argv[i] + 13, nullptr, 0);
+		else if (argv[i][0] != '+')
+			elf = argv[i];
+	}
+
 	Vtestbench* top = new Vtestbench;
+	uint8_t* memory = top->testbench->memory.data();
 
-	top->clk = 0;
-	while (!Verilated::gotFinish()) {
-		top->clk = !top->clk;
-		top->eval();
+	if (!batch) {
+		ElfLoader loader;
+		loader.quiet = true;
+		if (!loader.load(elf, memory, MEM_SIZE)) {
+			delete top;
+			exit(1);
+		}
+		std::string console;
+		run(top, max_cycles, &console);
+		fwrite(console.data(), 1, console.size(), stdout);
+		int rc = top->trap ? 0 : 2;
+		delete top;
+		exit(rc);
+	}
+
+	RigenConfig cfg;
+	cfg.set_isa("rv32imc");
+	cfg.custom = false;
+	Iss iss(cfg, MEM_SIZE);
+	iss.console_addr = 0x10000000;
+
+	char line[4096];
+	while (fgets(line, sizeof(line), stdin)) {
+		line[strcspn(line, "\r\n")] = 0;
+		if (!line[0])
+			continue;
+
+		ElfLoader loader;
+		loader.quiet = true;
+		if (!loader.load(line, memory, MEM_SIZE)) {
+			printf("%s load-error 0 0 0\n", line);
+			fflush(stdout);
+			continue;
+		}
+
+		iss.reset(memory);
+		Iss::Result ref = iss.run(max_cycles);
+
+		std::string console;
+		uint64_t cycles = run(top, max_cycles, &console);
+
+		const char* status = !top->trap ? "timeout" : ref != Iss::HALT ? "ref-error" :
+				console == iss.console ? "ok" : "mismatch";
+		printf("%s %s %016" PRIx64 " %016" PRIx64 " %" PRIu64 "\n", line, status,
+				fnv1a(console), fnv1a(iss.console), cycles);
+		fflush(stdout);
 	}
 
 	delete top;
 	exit(0);
 }
-
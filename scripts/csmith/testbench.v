@@ -2,13 +2,18 @@
 
 module testbench (
 `ifdef VERILATOR
-	input clk
+	// reset, trap and console are handled by testbench.cc, so one model
+	// can run many programs (see --batch)
+	input clk,
+	input resetn,
+	output trap,
+	output console_valid,
+	output [7:0] console_data
 `endif
 );
 `ifndef VERILATOR
 	reg clk = 1;
 	always #5 clk = ~clk;
-`endif
 
 	reg resetn = 0;
 	integer resetn_cnt = 0;
@@ -25,6 +30,7 @@ module testbench (
 		else
 			resetn <= 1;
 	end
+`endif
 
 	wire mem_valid;
 	wire mem_instr;
@@ -64,8 +70,10 @@ module testbench (
 		.mem_rdata   (mem_rdata  )
 	);
 
-	reg [7:0] memory [0:4*1024*1024-1];
+	reg [7:0] memory [0:4*1024*1024-1] /* verilator public */;
+`ifndef NO_READMEMH
 	initial $readmemh("test.hex", memory);
+`endif
 
 	assign mem_ready = x32[0] && mem_valid;
 
@@ -74,11 +82,16 @@ module testbench (
 	assign mem_rdata[23:16] = memory[mem_addr + 2];
 	assign mem_rdata[31:24] = memory[mem_addr + 3];
 
+`ifdef VERILATOR
+	assign console_valid = resetn && mem_valid && mem_ready && mem_wstrb && mem_addr == 'h10000000;
+	assign console_data = mem_wdata[7:0];
+`endif
+
 	always @(posedge clk) begin
 		if (mem_valid && mem_ready) begin
 			if (mem_wstrb && mem_addr == 'h10000000) begin
-				$write("%c", mem_wdata[ 7: 0]);
 `ifndef VERILATOR
+				$write("%c", mem_wdata[ 7: 0]);
 				$fflush;
 `endif
 			end else begin
@@ -90,6 +103,7 @@ module testbench (
 		end
 	end
 
+`ifndef VERILATOR
 	always @(posedge clk) begin
 		if (resetn && trap) begin
 			// repeat (10) @(posedge clk);
@@ -97,4 +111,5 @@ module testbench (
 			$finish;
 		end
 	end
+`endif
 endmodule
@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+#
+# Find the first instruction where two simulations of the same program
+# diverge, using the periodic state hashes written by testbench_cli.
+#
+# Usage: divergence.py [-k K] "<cmd a>" "<cmd b>"
+#
+# Each command is a complete testbench_cli command line, for example
+# "./testbench_cli firmware/firmware.elf". Both commands are first run with
+# --hash-interval=K. The first mismatching checkpoint brackets a window of at
+# most K instructions, which is then re-simulated on both sides with a hash
+# after every instruction and a commit log. The first differing instruction
+# is found by bisection and printed together with the commit records of both
+# runs.
+
+import argparse, os, shlex, subprocess, sys, tempfile
+
+def run(cmd, extra, outfile):
+    with open(outfile, "w") as f:
+        return subprocess.Popen(shlex.split(cmd) + extra, stdout=f, stderr=subprocess.STDOUT)
+
+def run_both(cmds, extra, workdir, tag):
+    procs = []
+    for i, cmd in enumerate(cmds):
+        name = os.path.join(workdir, "%s_%s" % (tag, "ab"[i]))
+        ex = [e.replace("@", name) for e in extra]
+        procs.append((run(cmd, ex, name + ".out"), name))
+    for proc, name in procs:
+        proc.wait()
+    return [name for proc, name in procs]
+
+def read_hashes(filename):
+    hashes = []
+    with open(filename, "r") as f:
+        for line in f:
+            line = line.split()
+            if len(line) >= 2:
+                hashes.append((int(line[0]), line[1], len(line) > 2))
+    return hashes
+
+def read_commits(filename):
+    commits = dict()
+    with open(filename, "r") as f:
+        for line in f:
+            if not line.startswith("#"):
+                commits[int(line.split()[0])] = line.rstrip()
+    return commits
+
+parser = argparse.ArgumentParser(description="find the first diverging instruction of two simulations")
+parser.add_argument("-k", "--interval", type=int, default=10000, help="instructions per checkpoint (default: 10000)")
+parser.add_argument("-c", "--context", type=int, default=4, help="commit records to show before the divergence")
+parser.add_argument("-w", "--workdir", help="keep hash files and logs in this directory")
+parser.add_argument("cmd_a")
+parser.add_argument("cmd_b")
+args = parser.parse_args()
+
+workdir = args.workdir or tempfile.mkdtemp(prefix="divergence_")
+os.makedirs(workdir, exist_ok=True)
+cmds = [args.cmd_a, args.cmd_b]
+
+# Pass 1: coarse checkpoints
+names = run_both(cmds, ["--hash-interval=%d" % args.interval, "--hash-file=@.hash"], workdir, "coarse")
+ha, hb = [read_hashes(n + ".hash") for n in names]
+if not ha or not hb:
+    print("no hashes written, see %s/coarse_*.out" % workdir)
+    sys.exit(1)
+
+first = None
+for i in range(min(len(ha), len(hb))):
+    if ha[i][:2] != hb[i][:2]:
+        first = i
+        break
+if first is None and len(ha) != len(hb):
+    first = min(len(ha), len(hb))
+if first is None:
+    print("no divergence: both runs committed %d instructions with hash %s" % (ha[-1][0], ha[-1][1]))
+    sys.exit(0)
+
+lo = ha[first - 1][0] if first > 0 else 0
+hi = max(h[first][0] for h in (ha, hb) if first < len(h))
+print("first mismatching checkpoint: %d, re-simulating instructions %d..%d" % (first, lo, hi - 1))
+
+# Pass 2: a hash after every instruction of the mismatching window
+names = run_both(cmds, ["--hash-interval=1", "--hash-window=%d:%d" % (lo, hi),
+        "--hash-file=@.hash", "--commit-log=@.log"], workdir, "window")
+ha, hb = [[h for h in read_hashes(n + ".hash") if not h[2]] for n in names]
+
+# Once the rolling hashes differ they stay different, so bisect
+left, right = 0, min(len(ha), len(hb))
+while left < right:
+    mid = (left + right) // 2
+    if ha[mid][:2] != hb[mid][:2]:
+        right = mid
+    else:
+        left = mid + 1
+
+if left < min(len(ha), len(hb)):
+    order = ha[left][0] - 1
+elif len(ha) != len(hb):
+    order = lo + left
+    print("runs only differ in length")
+else:
+    print("window did not reproduce the divergence, is the simulation deterministic?")
+    sys.exit(1)
+
+print("first divergence at instruction %d" % order)
+print()
+for name, label in zip(names, "AB"):
+    commits = read_commits(name + ".log")
+    print("run %s: %s" % (label, cmds["AB".index(label)]))
+    for k in range(max(lo, order - args.context), order + 1):
+        if k in commits:
+            print("%s %s" % ("*" if k == order else " ", commits[k]))
+        elif k == order:
+            print("* (no instruction, run ended)")
+    print()
+print("logs: %s" % workdir)
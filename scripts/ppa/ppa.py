@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+#
+# Performance-per-area report for a matrix of picorv32 configurations.
+#
+# For every configuration in configs.txt:
+#   - synthesize ppa_synth (ppa.v) with "yosys synth_ice40" and count LUTs
+#   - place and route with nextpnr-ice40 (HX8K) when it is installed and
+#     take the achieved fmax from its timing report
+#   - build ppa_tb (ppa.v + ppa_tb.cc) with Verilator using the same
+#     parameters and run every workload to get its cycle count
+#
+# and print DMIPS/MHz, DMIPS at fmax, DMIPS per LUT and the runtime of each
+# workload at fmax, as a markdown table (or CSV with --csv).
+#
+# Usage: ppa.py [-c CONFIGS] [-w NAME=ELF] [-j N] [--fmax MHZ] [--csv] [CONFIG ...]
+#
+
+import argparse, json, os, re, shutil, sys
+from concurrent.futures import ThreadPoolExecutor
+from ppalib import topdir, read_configs, run, build_ppa_tb, print_table
+
+srcdir = os.path.dirname(os.path.abspath(__file__))
+
+parser = argparse.ArgumentParser(description="picorv32 performance-per-area report")
+parser.add_argument("configs", nargs="*", help="only run these configurations (default: all)")
+parser.add_argument("-c", "--config-file", default=os.path.join(srcdir, "configs.txt"), metavar="FILE",
+                    help="configuration matrix (default: configs.txt)")
+parser.add_argument("-w", "--workload", action="append", default=[], metavar="NAME=ELF",
+                    help="additional workload; '{isa}' in ELF is replaced by the ISA of the configuration")
+parser.add_argument("-b", "--build-dir", default="build", metavar="DIR", help="work directory (default: build)")
+parser.add_argument("-j", "--jobs", type=int, default=1, metavar="N", help="configurations processed in parallel")
+parser.add_argument("--fmax", type=float, metavar="MHZ",
+                    help="clock frequency to use when nextpnr-ice40 is not available")
+parser.add_argument("--no-pnr", action="store_true", help="do not run nextpnr-ice40")
+parser.add_argument("--seed", type=int, default=1, help="nextpnr placer seed (default: 1)")
+parser.add_argument("--csv", action="store_true", help="print CSV instead of a markdown table")
+parser.add_argument("--yosys", default=os.environ.get("YOSYS", "yosys"))
+parser.add_argument("--nextpnr", default=os.environ.get("NEXTPNR", "nextpnr-ice40"))
+parser.add_argument("--verilator", default=os.environ.get("VERILATOR", "verilator"))
+args = parser.parse_args()
+
+configs = read_configs(args.config_file, args.configs)
+
+workloads = [("dhrystone", os.path.join(srcdir, "dhry_{isa}.elf"))]
+for w in args.workload:
+    name, elf = w.split("=", 1)
+    workloads.append((name, os.path.abspath(elf)))
+
+have_pnr = not args.no_pnr and shutil.which(args.nextpnr) is not None
+if not have_pnr and args.fmax is None:
+    print("Note: nextpnr-ice40 not used and no --fmax given, reporting per-MHz numbers only.", file=sys.stderr)
+
+def synth(name, params, wdir):
+    json_file = os.path.join(wdir, "synth.json")
+    stat_file = os.path.join(wdir, "stat.json")
+    chparam = " ".join("-set %s %s" % (k, v) for k, v in params)
+    script = "read_verilog %s %s; " % (os.path.join(topdir, "picorv32.v"), os.path.join(srcdir, "ppa.v"))
+    if chparam:
+        script += "chparam %s ppa_synth; " % chparam
+    script += "synth_ice40 -top ppa_synth -json %s; tee -q -o %s stat -json" % (json_file, stat_file)
+    run([args.yosys, "-q", "-p", script], os.path.join(wdir, "synth.log"))
+
+    with open(stat_file, "r") as f:
+        stat = json.load(f)
+    if "design" in stat:
+        cells = stat["design"]["num_cells_by_type"]
+    else:
+        cells = stat["modules"]["\\ppa_synth"]["num_cells_by_type"]
+    return cells.get("SB_LUT4", 0), json_file
+
+def pnr(name, json_file, wdir):
+    log = os.path.join(wdir, "pnr.log")
+    run([args.nextpnr, "--hx8k", "--package", "ct256", "--json", json_file,
+            "--seed", str(args.seed), "--freq", "100", "--asc", os.path.join(wdir, "pnr.asc")], log)
+    fmax = None
+    with open(log, "r") as f:
+        for line in f:
+            m = re.search(r"Max frequency for clock '[^']*': ([0-9.]+) MHz", line)
+            if m:
+                fmax = float(m.group(1))
+    return fmax
+
+def simulate(name, isa, params, wdir):
+    tb = build_ppa_tb(args.verilator, params, wdir)
+
+    results = {}
+    for wname, elf in workloads:
+        log = os.path.join(wdir, wname + ".log")
+        run([tb, elf.replace("{isa}", isa)], log)
+        cycles = runs = user_time = None
+        with open(log, "r") as f:
+            for line in f:
+                m = re.match(r"ppa: cycles (\d+)", line)
+                if m:
+                    cycles = int(m.group(1))
+                m = re.match(r"Number_Of_Runs: (\d+)", line)
+                if m:
+                    runs = int(m.group(1))
+                m = re.match(r"User_Time: (\d+) cycles", line)
+                if m:
+                    user_time = int(m.group(1))
+        results[wname] = (cycles, runs, user_time)
+    return results
+
+def evaluate(config):
+    name, isa, params = config
+    wdir = os.path.abspath(os.path.join(args.build_dir, name))
+    os.makedirs(wdir, exist_ok=True)
+    luts, json_file = synth(name, params, wdir)
+    fmax = pnr(name, json_file, wdir) if have_pnr else args.fmax
+    results = simulate(name, isa, params, wdir)
+    print("%s: %d LUTs, fmax %s" % (name, luts, "%.2f MHz" % fmax if fmax else "n/a"), file=sys.stderr)
+    return name, isa, luts, fmax, results
+
+try:
+    with ThreadPoolExecutor(max_workers=max(1, args.jobs)) as pool:
+        rows = list(pool.map(evaluate, configs))
+except RuntimeError as e:
+    print("Error: %s" % e, file=sys.stderr)
+    sys.exit(1)
+
+# Dhrystone 2.1: 1757 Dhrystones per second = 1 DMIPS (VAX 11/780)
+header = ["Config", "ISA", "LUTs", "fmax MHz", "DMIPS/MHz", "DMIPS", "DMIPS/kLUT"]
+header += ["%s us" % w[0] for w in workloads]
+table = []
+for name, isa, luts, fmax, results in rows:
+    _, runs, user_time = results["dhrystone"]
+    dmips_mhz = runs * 1e6 / user_time / 1757 if runs and user_time else None
+    dmips = dmips_mhz * fmax if dmips_mhz and fmax else None
+    # without fmax, rank by DMIPS/MHz per kLUT instead
+    per_klut = (dmips if fmax else dmips_mhz) * 1000 / luts if dmips_mhz and luts else None
+    row = [name, isa, str(luts), "%.2f" % fmax if fmax else "-",
+           "%.3f" % dmips_mhz if dmips_mhz else "-", "%.1f" % dmips if dmips else "-",
+           "%.3f" % per_klut if per_klut else "-"]
+    for wname, _ in workloads:
+        cycles = results[wname][0]
+        row.append("%.1f" % (cycles / fmax) if cycles and fmax else "-")
+    table.append(row)
+
+if not have_pnr and args.fmax is None:
+    header[6] = "DMIPS/MHz/kLUT"
+
+print_table(header, table, args.csv, 2)
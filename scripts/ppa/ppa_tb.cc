@@ -0,0 +1,61 @@
+// Verilator driver for the ppa_tb module in ppa.v. Loads one program,
+// runs it until the core traps and reports the number of clock cycles
+// from the release of reset, so ppa.py can turn it into runtime at fmax.
+//
+// Usage: Vppa_tb <program.elf|program.bin> [max_cycles]
+
+#include "Vppa_tb.h"
+#include "Vppa_tb_ppa_tb.h"
+#include "verilated.h"
+#include "../../testbench_loader.h"
+
+#include <cstdlib>
+
+int main(int argc, char **argv)
+{
+	Verilated::commandArgs(argc, argv);
+
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s <program.elf|program.bin> [max_cycles]\n", argv[0]);
+		return 1;
+	}
+	uint64_t max_cycles = argc > 2 ? strtoull(argv[2], NULL, 0) : 100000000;
+
+	Vppa_tb* top = new Vppa_tb;
+
+	ElfLoader loader;
+	if (!loader.load_image(argv[1], top->ppa_tb->memory.data(), 256*1024)) {
+		delete top;
+		return 1;
+	}
+
+	top->clk = 0;
+	top->resetn = 0;
+	for (int i = 0; i < 20; i++) {
+		top->clk = !top->clk;
+		top->eval();
+	}
+	top->resetn = 1;
+
+	uint64_t cycles = 0;
+	while (!top->trap && cycles < max_cycles && !Verilated::gotFinish()) {
+		top->clk = 1;
+		top->eval();
+		top->clk = 0;
+		top->eval();
+		cycles++;
+	}
+	fflush(stdout);
+
+	int rc = 0;
+	if (!top->trap) {
+		printf("\nppa: timeout after %lu cycles\n", (unsigned long)cycles);
+		rc = 2;
+	} else {
+		printf("\nppa: cycles %lu\n", (unsigned long)cycles);
+	}
+
+	top->final();
+	delete top;
+	return rc;
+}
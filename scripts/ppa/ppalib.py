@@ -0,0 +1,62 @@
+#!/usr/bin/env python3
+#
+# Shared by ppa.py and microbench/run.py: the configs.txt parser, the
+# Verilator build of ppa_tb for one configuration and the table printer.
+#
+
+import os, subprocess, sys
+
+ppadir = os.path.dirname(os.path.abspath(__file__))
+topdir = os.path.normpath(os.path.join(ppadir, "..", ".."))
+
+def read_configs(filename, selected=None):
+    """Return (name, isa, [[param, value], ...]) for every line of a
+    configuration matrix, or only for the names in selected. Exits when
+    nothing is selected."""
+    configs = []
+    with open(filename, "r") as f:
+        for line in f:
+            line = line.split("#", 1)[0].split()
+            if not line:
+                continue
+            name, isa = line[0], line[1]
+            params = [p.split("=", 1) for p in line[2:]]
+            if not selected or name in selected:
+                configs.append((name, isa, params))
+    if not configs:
+        print("No configurations selected.", file=sys.stderr)
+        sys.exit(1)
+    return configs
+
+def run(cmd, log, cwd=None):
+    with open(log, "w") as f:
+        p = subprocess.run(cmd, cwd=cwd, stdout=f, stderr=subprocess.STDOUT)
+    if p.returncode != 0:
+        raise RuntimeError("'%s' failed, see %s" % (cmd[0], log))
+
+def build_ppa_tb(verilator, params, wdir):
+    """Build ppa_tb (ppa.v + ppa_tb.cc) with the parameters of one
+    configuration in wdir/obj_dir and return the path of the binary."""
+    mdir = os.path.join(wdir, "obj_dir")
+    gparams = ["-G%s=%s" % (k, v) for k, v in params]
+    run([verilator, "--cc", "--exe", "-Wno-lint", "-O3", "--x-assign", "fast", "--top-module", "ppa_tb",
+            "--Mdir", mdir] + gparams + [os.path.join(topdir, "picorv32.v"), os.path.join(ppadir, "ppa.v"),
+            os.path.join(ppadir, "ppa_tb.cc")], os.path.join(wdir, "verilator.log"))
+    run(["make", "-C", mdir, "-f", "Vppa_tb.mk"], os.path.join(wdir, "make.log"))
+    return os.path.join(mdir, "Vppa_tb")
+
+def print_table(header, table, csv=False, text_columns=1):
+    """Print rows of strings as CSV or as a markdown table. The first
+    text_columns columns are left aligned, the others right aligned."""
+    if csv:
+        print(",".join(header))
+        for row in table:
+            print(",".join(row))
+        return
+    widths = [max(len(header[i]), max(len(r[i]) for r in table)) for i in range(len(header))]
+    print("| " + " | ".join(h.ljust(w) for h, w in zip(header, widths)) + " |")
+    print("|" + "|".join((":" + "-" * (w + 1)) if i < text_columns else ("-" * (w + 1) + ":")
+                         for i, w in enumerate(widths)) + "|")
+    for row in table:
+        print("| " + " | ".join((c.ljust(w) if i < text_columns else c.rjust(w))
+                                for i, (c, w) in enumerate(zip(row, widths))) + " |")
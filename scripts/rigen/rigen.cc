@@ -0,0 +1,81 @@
+// Generate random self-checking tests for picorv32 (see rigen.h)
+//
+// Every test is generated from a seed, run on the built-in reference model
+// and written as test_<seed>.elf plus the expected final memory in
+// test_<seed>.ref. The files can be run with the torture testbench
+// (scripts/torture: obj_dir/Vtestbench +bin=test_N.elf +ref=test_N.ref,
+// generate with --no-custom there). Without -o only the generator and the
+// reference model run, which measures their throughput.
+//
+// Usage: rigen [options]
+//   -n N              Number of tests (default: 1000)
+//   --seed=S          Seed of the first test (default: 1)
+//   -o DIR            Write test_<seed>.elf and test_<seed>.ref to DIR
+//   (see RigenConfig::usage for the generator options)
+
+#include "rigen.h"
+
+#include <cinttypes>
+#include <chrono>
+
+static void usage(const char* argv0) {
+    fprintf(stderr, "Usage: %s [options]\n", argv0);
+    fprintf(stderr, "  -n N              Number of tests (default: 1000)\n");
+    fprintf(stderr, "  --seed=S          Seed of the first test (default: 1)\n");
+    fprintf(stderr, "  -o DIR            Write test_<seed>.elf and test_<seed>.ref to DIR\n");
+    RigenConfig::usage(stderr);
+}
+
+int main(int argc, char** argv) {
+    RigenConfig cfg;
+    uint64_t count = 1000, seed = 1;
+    const char* outdir = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        bool ok;
+        if (cfg.parse_option(argv[i], &ok)) {
+            if (!ok) {
+                fprintf(stderr, "Error: Invalid option '%s'\n", argv[i]);
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            count = strtoull(argv[++i], nullptr, 0);
+        } else if (!strncmp(argv[i], "--seed=", 7)) {
+            seed = strtoull(argv[i] + 7, nullptr, 0);
+        } else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+            outdir = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    Generator gen(cfg);
+    Iss iss(cfg);
+    uint64_t steps = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint64_t n = 0; n < count; n++, seed++) {
+        if (!gen.generate(seed)) {
+            fprintf(stderr, "Error: seed %" PRIu64 ": %s\n", seed, gen.error.c_str());
+            return 1;
+        }
+        iss.reset(gen.image);
+        if (iss.run(1000000) != Iss::HALT) {
+            fprintf(stderr, "Error: seed %" PRIu64 ": reference model: %s at pc 0x%04x\n", seed, iss.error, iss.pc);
+            return 1;
+        }
+        steps += iss.steps;
+        if (outdir) {
+            std::string base = std::string(outdir) + "/test_" + std::to_string(seed);
+            if (!rigen_write_elf((base + ".elf").c_str(), gen.image, gen.code_size) ||
+                    !rigen_write_ref((base + ".ref").c_str(), iss.mem.data()))
+                return 1;
+        }
+    }
+
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    fprintf(stderr, "%" PRIu64 " tests, %.1f instructions per test, %.0f tests/s\n", count,
+            count ? (double)steps / count : 0.0, secs > 0 ? count / secs : 0.0);
+    return 0;
+}
@@ -0,0 +1,999 @@
+// Random instruction stream generator for picorv32 (RV32I[M][C] plus the
+// picorv32 custom IRQ instructions) with a built-in reference model.
+//
+// A test is a 16 kB memory image in the layout of scripts/torture:
+//
+//   0x0000 .. 0x2eff   code: prologue, random items, epilogue + ebreak
+//   0x2f00 .. 0x2fff   signature: x1..x31 and q0..q3 stored by the epilogue
+//   0x3000 .. 0x3fff   data: random initial contents, target of all loads
+//                      and stores (s0 = 0x3800 and sp = 0x3c00 are bases)
+//
+// The program is straight-line code made of "items" (an ALU op, a load or
+// store, a forward branch or jump, a bounded loop, a custom instruction).
+// Control flow only ever targets the start of a later item, and loops use a
+// reserved counter register (tp), so every test terminates. Iss runs the
+// image and gives the expected final memory; the core under test must
+// produce exactly the same 16 kB when it traps on the final ebreak.
+
+#ifndef RIGEN_H
+#define RIGEN_H
+
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <elf.h>
+
+#define RIGEN_MEM_SIZE   0x4000
+#define RIGEN_CODE_LIMIT 0x2f00
+#define RIGEN_SIG_ADDR   0x2f00
+#define RIGEN_DATA_ADDR  0x3000
+#define RIGEN_S0_BASE    0x3800
+#define RIGEN_SP_BASE    0x3c00
+
+struct RigenConfig {
+    bool mul = true;
+    bool compressed = true;
+    bool custom = true;
+    int length = 200;           // items per test
+    int max_skip = 6;           // forward branch/jump distance in items
+    double hazard = 0.3;        // probability that a load/store reuses a recent address
+    double dep = 0.3;           // probability that a source register is the last destination
+    double rvc = 0.5;           // probability of using a compressed encoding where one exists
+    // item mix (relative weights)
+    int w_alu = 40, w_muldiv = 8, w_mem = 25, w_branch = 10, w_jump = 5, w_loop = 5, w_custom = 5;
+
+    bool set_isa(const char* isa) {
+        if (strncmp(isa, "rv32i", 5))
+            return false;
+        mul = strchr(isa + 5, 'm') != nullptr;
+        compressed = strchr(isa + 5, 'c') != nullptr;
+        return true;
+    }
+
+    bool set_mix(const char* spec) {
+        std::string s = spec;
+        size_t pos = 0;
+        while (pos < s.size()) {
+            size_t end = s.find(',', pos);
+            if (end == std::string::npos)
+                end = s.size();
+            std::string item = s.substr(pos, end - pos);
+            pos = end + 1;
+            size_t colon = item.find(':');
+            if (colon == std::string::npos)
+                return false;
+            std::string name = item.substr(0, colon);
+            int w = atoi(item.c_str() + colon + 1);
+            if (name == "alu") w_alu = w;
+            else if (name == "muldiv") w_muldiv = w;
+            else if (name == "mem") w_mem = w;
+            else if (name == "branch") w_branch = w;
+            else if (name == "jump") w_jump = w;
+            else if (name == "loop") w_loop = w;
+            else if (name == "custom") w_custom = w;
+            else return false;
+        }
+        return true;
+    }
+
+    // Parse one generator option, returns false if arg is not one
+    bool parse_option(const char* arg, bool* ok) {
+        *ok = true;
+        if (!strncmp(arg, "--isa=", 6)) *ok = set_isa(arg + 6);
+        else if (!strcmp(arg, "--no-custom")) custom = false;
+        else if (!strncmp(arg, "--length=", 9)) length = atoi(arg + 9);
+        else if (!strncmp(arg, "--max-skip=", 11)) max_skip = atoi(arg + 11);
+        else if (!strncmp(arg, "--hazard=", 9)) hazard = atof(arg + 9);
+        else if (!strncmp(arg, "--dep=", 6)) dep = atof(arg + 6);
+        else if (!strncmp(arg, "--rvc=", 6)) rvc = atof(arg + 6);
+        else if (!strncmp(arg, "--mix=", 6)) *ok = set_mix(arg + 6);
+        else return false;
+        if (max_skip < 1 || max_skip > 8) *ok = false;
+        return true;
+    }
+
+    static void usage(FILE* f) {
+        fprintf(f, "  --isa=ISA         rv32i, rv32im, rv32ic or rv32imc (default: rv32imc)\n");
+        fprintf(f, "  --no-custom       Do not generate getq/setq/maskirq/timer\n");
+        fprintf(f, "  --length=N        Items per test (default: 200)\n");
+        fprintf(f, "  --max-skip=N      Forward branch/jump distance in items, 1..8 (default: 6)\n");
+        fprintf(f, "  --hazard=P        Probability of reusing a recent load/store address (default: 0.3)\n");
+        fprintf(f, "  --dep=P           Probability of reading the last written register (default: 0.3)\n");
+        fprintf(f, "  --rvc=P           Probability of a compressed encoding (default: 0.5)\n");
+        fprintf(f, "  --mix=K:W,...     Item weights, K = alu muldiv mem branch jump loop custom\n");
+        fprintf(f, "                    (default: alu:40,muldiv:8,mem:25,branch:10,jump:5,loop:5,custom:5)\n");
+    }
+};
+
+// ---------------------------------------------------------------------------
+// Reference model
+
+class Iss {
+public:
+    uint32_t x[32];
+    uint32_t q[4];
+    uint32_t irq_mask, timer, pc;
+    std::vector<uint8_t> mem;
+    uint64_t steps;
+    const char* error;
+
+    // Stores to console_addr (if non-zero) append their low byte to console
+    // instead of going to memory
+    uint32_t console_addr = 0;
+    std::string console;
+
+    enum Result { RUNNING, HALT, ERROR };
+
+    Iss(const RigenConfig& cfg, uint32_t mem_size = RIGEN_MEM_SIZE) : mem(mem_size), cfg(cfg) {}
+
+    void reset(const uint8_t* image) {
+        memcpy(mem.data(), image, mem.size());
+        console.clear();
+        memset(x, 0, sizeof(x));
+        memset(q, 0, sizeof(q));
+        irq_mask = ~0;
+        timer = 0;
+        pc = 0;
+        steps = 0;
+        error = nullptr;
+    }
+
+    Result run(uint64_t max_steps) {
+        Result r = RUNNING;
+        while (r == RUNNING && steps < max_steps)
+            r = step();
+        if (r == RUNNING)
+            return fail("step limit exceeded");
+        return r;
+    }
+
+    Result step() {
+        if (pc + 2 > mem.size() || (pc & 1))
+            return fail("bad pc");
+        steps++;
+        uint32_t insn = mem[pc] | mem[pc + 1] << 8;
+        if ((insn & 3) != 3) {
+            if (!cfg.compressed)
+                return fail("compressed instruction");
+            return exec_rvc(insn);
+        }
+        if (pc + 4 > mem.size())
+            return fail("bad pc");
+        insn |= (mem[pc + 2] | mem[pc + 3] << 8) << 16;
+        return exec(insn);
+    }
+
+private:
+    const RigenConfig& cfg;
+
+    Result fail(const char* msg) { error = msg; return ERROR; }
+
+    void wr(int rd, uint32_t v) { if (rd) x[rd] = v; }
+
+    bool jump(uint32_t target) {
+        if (target & (cfg.compressed ? 1 : 3)) {
+            error = "misaligned jump";
+            return false;
+        }
+        pc = target;
+        return true;
+    }
+
+    bool load(uint32_t addr, int f3, uint32_t* v) {
+        int size = 1 << (f3 & 3);
+        if ((addr & (size - 1)) || addr + size > mem.size()) {
+            error = "bad load address";
+            return false;
+        }
+        uint32_t d = 0;
+        for (int i = 0; i < size; i++)
+            d |= (uint32_t)mem[addr + i] << (8 * i);
+        if (f3 == 0) d = (int32_t)(int8_t)d;
+        if (f3 == 1) d = (int32_t)(int16_t)d;
+        *v = d;
+        return true;
+    }
+
+    bool store(uint32_t addr, int f3, uint32_t v) {
+        int size = 1 << (f3 & 3);
+        if (console_addr && addr == console_addr) {
+            console += (char)v;
+            return true;
+        }
+        if ((addr & (size - 1)) || addr + size > mem.size()) {
+            error = "bad store address";
+            return false;
+        }
+        for (int i = 0; i < size; i++)
+            mem[addr + i] = v >> (8 * i);
+        return true;
+    }
+
+    static uint32_t muldiv(int f3, uint32_t a, uint32_t b) {
+        int64_t sa = (int32_t)a, sb = (int32_t)b;
+        switch (f3) {
+        case 0: return a * b;
+        case 1: return (uint64_t)(sa * sb) >> 32;
+        case 2: return (uint64_t)(sa * (int64_t)(uint64_t)b) >> 32;
+        case 3: return ((uint64_t)a * b) >> 32;
+        case 4: return b == 0 ? ~0u : (a == 0x80000000 && b == ~0u) ? a : (uint32_t)((int32_t)a / (int32_t)b);
+        case 5: return b == 0 ? ~0u : a / b;
+        case 6: return b == 0 ? a : (a == 0x80000000 && b == ~0u) ? 0 : (uint32_t)((int32_t)a % (int32_t)b);
+        default: return b == 0 ? a : a % b;
+        }
+    }
+
+    static uint32_t alu(int f3, bool alt, uint32_t a, uint32_t b) {
+        switch (f3) {
+        case 0: return alt ? a - b : a + b;
+        case 1: return a << (b & 31);
+        case 2: return (int32_t)a < (int32_t)b;
+        case 3: return a < b;
+        case 4: return a ^ b;
+        case 5: return alt ? (uint32_t)((int32_t)a >> (b & 31)) : a >> (b & 31);
+        case 6: return a | b;
+        default: return a & b;
+        }
+    }
+
+    static bool taken(int f3, uint32_t a, uint32_t b) {
+        switch (f3) {
+        case 0: return a == b;
+        case 1: return a != b;
+        case 4: return (int32_t)a < (int32_t)b;
+        case 5: return (int32_t)a >= (int32_t)b;
+        case 6: return a < b;
+        default: return a >= b;
+        }
+    }
+
+    Result exec(uint32_t insn) {
+        int rd = (insn >> 7) & 31, f3 = (insn >> 12) & 7;
+        int rs1 = (insn >> 15) & 31, rs2 = (insn >> 20) & 31, f7 = insn >> 25;
+        int32_t imm_i = (int32_t)insn >> 20;
+        int32_t imm_s = ((int32_t)insn >> 25 << 5) | rd;
+        int32_t imm_b = ((int32_t)(insn & 0x80000000) >> 19) | ((insn & 0x80) << 4) |
+                ((insn >> 20) & 0x7e0) | ((insn >> 7) & 0x1e);
+        int32_t imm_j = ((int32_t)(insn & 0x80000000) >> 11) | (insn & 0xff000) |
+                ((insn >> 9) & 0x800) | ((insn >> 20) & 0x7fe);
+        uint32_t a = x[rs1], b = x[rs2], next = pc + 4, v;
+
+        switch (insn & 0x7f) {
+        case 0x37: wr(rd, insn & 0xfffff000); break;
+        case 0x17: wr(rd, pc + (insn & 0xfffff000)); break;
+        case 0x6f:
+            if (!jump(pc + imm_j)) return ERROR;
+            wr(rd, next);
+            return RUNNING;
+        case 0x67:
+            if (f3 != 0) return fail("illegal instruction");
+            if (!jump((a + imm_i) & ~1u)) return ERROR;
+            wr(rd, next);
+            return RUNNING;
+        case 0x63:
+            if (f3 == 2 || f3 == 3) return fail("illegal instruction");
+            if (taken(f3, a, b)) {
+                if (!jump(pc + imm_b)) return ERROR;
+                return RUNNING;
+            }
+            break;
+        case 0x03:
+            if (f3 == 3 || f3 > 5) return fail("illegal instruction");
+            if (!load(a + imm_i, f3, &v)) return ERROR;
+            wr(rd, v);
+            break;
+        case 0x23:
+            if (f3 > 2) return fail("illegal instruction");
+            if (!store(a + imm_s, f3, b)) return ERROR;
+            break;
+        case 0x13:
+            if (f3 == 1 && f7 != 0) return fail("illegal instruction");
+            if (f3 == 5 && (f7 & ~0x20)) return fail("illegal instruction");
+            wr(rd, alu(f3, f3 == 5 && f7 == 0x20, a, (f3 == 1 || f3 == 5) ? rs2 : (uint32_t)imm_i));
+            break;
+        case 0x33:
+            if (f7 == 1) {
+                if (!cfg.mul) return fail("illegal instruction");
+                wr(rd, muldiv(f3, a, b));
+            } else {
+                if (f7 != 0 && !(f7 == 0x20 && (f3 == 0 || f3 == 5))) return fail("illegal instruction");
+                wr(rd, alu(f3, f7 == 0x20, a, b));
+            }
+            break;
+        case 0x0f:
+            break;
+        case 0x73:
+            if (insn == 0x00100073) return HALT;
+            return fail("illegal instruction");
+        case 0x0b:
+            if (!cfg.custom) return fail("illegal instruction");
+            switch (f7) {
+            case 0: wr(rd, q[rs1 & 3]); break;
+            case 1: q[rd & 3] = a; break;
+            case 3: v = irq_mask; irq_mask = a; wr(rd, v); break;
+            case 5: v = timer; timer = a; wr(rd, v); break;
+            default: return fail("unsupported custom instruction");
+            }
+            break;
+        default:
+            return fail("illegal instruction");
+        }
+        pc = next;
+        return RUNNING;
+    }
+
+    Result exec_rvc(uint32_t c) {
+        int f3 = (c >> 13) & 7, op = c & 3;
+        int rd = (c >> 7) & 31, rs2 = (c >> 2) & 31;
+        int rdp = 8 + ((c >> 2) & 7), rs1p = 8 + ((c >> 7) & 7);
+        int32_t imm6 = (int32_t)(((c >> 7) & 0x20) | ((c >> 2) & 0x1f)) << 26 >> 26;
+        uint32_t next = pc + 2, v;
+
+        if (op == 0) {
+            uint32_t off = ((c >> 7) & 0x38) | ((c << 1) & 0x40) | ((c >> 4) & 4);
+            if (f3 == 0) {
+                uint32_t imm = ((c >> 7) & 0x30) | ((c >> 1) & 0x3c0) | ((c >> 4) & 4) | ((c >> 2) & 8);
+                if (imm == 0) return fail("illegal instruction");
+                x[rdp] = x[2] + imm;
+            } else if (f3 == 2) {
+                if (!load(x[rs1p] + off, 2, &v)) return ERROR;
+                x[rdp] = v;
+            } else if (f3 == 6) {
+                if (!store(x[rs1p] + off, 2, x[rdp])) return ERROR;
+            } else
+                return fail("illegal instruction");
+        } else if (op == 1) {
+            int32_t imm_j = (int32_t)(((c >> 1) & 0x800) | ((c << 2) & 0x400) | ((c >> 1) & 0x300) |
+                    ((c << 1) & 0x80) | ((c >> 1) & 0x40) | ((c << 3) & 0x20) | ((c >> 7) & 0x10) |
+                    ((c >> 2) & 0xe)) << 20 >> 20;
+            int32_t imm_b = (int32_t)(((c >> 4) & 0x100) | ((c << 1) & 0xc0) | ((c << 3) & 0x20) |
+                    ((c >> 7) & 0x18) | ((c >> 2) & 6)) << 23 >> 23;
+            switch (f3) {
+            case 0: wr(rd, x[rd] + imm6); break;
+            case 1:
+                if (!jump(pc + imm_j)) return ERROR;
+                x[1] = next;
+                return RUNNING;
+            case 2: wr(rd, imm6); break;
+            case 3:
+                if (rd == 2) {
+                    int32_t imm = (int32_t)(((c >> 3) & 0x200) | ((c >> 2) & 0x10) | ((c << 1) & 0x40) |
+                            ((c << 4) & 0x180) | ((c << 3) & 0x20)) << 22 >> 22;
+                    if (imm == 0) return fail("illegal instruction");
+                    x[2] += imm;
+                } else {
+                    if (imm6 == 0) return fail("illegal instruction");
+                    wr(rd, (uint32_t)imm6 << 12);
+                }
+                break;
+            case 4: {
+                int sel = (c >> 10) & 3;
+                rd = rs1p;
+                if (sel == 0 || sel == 1) {
+                    if (c & 0x1000) return fail("illegal instruction");
+                    x[rd] = alu(5, sel == 1, x[rd], imm6 & 31);
+                } else if (sel == 2) {
+                    x[rd] &= imm6;
+                } else {
+                    static const int f3s[4] = { 0, 4, 6, 7 };
+                    int fn = (c >> 5) & 3;
+                    if (c & 0x1000) return fail("illegal instruction");
+                    x[rd] = alu(f3s[fn], fn == 0, x[rd], x[rdp]);
+                }
+                break;
+            }
+            case 5:
+                if (!jump(pc + imm_j)) return ERROR;
+                return RUNNING;
+            default:
+                if ((x[rs1p] == 0) == (f3 == 6)) {
+                    if (!jump(pc + imm_b)) return ERROR;
+                    return RUNNING;
+                }
+                break;
+            }
+        } else if (op == 2) {
+            switch (f3) {
+            case 0:
+                if (c & 0x1000) return fail("illegal instruction");
+                wr(rd, x[rd] << (imm6 & 31));
+                break;
+            case 2: {
+                uint32_t off = ((c >> 7) & 0x20) | ((c >> 2) & 0x1c) | ((c << 4) & 0xc0);
+                if (rd == 0) return fail("illegal instruction");
+                if (!load(x[2] + off, 2, &v)) return ERROR;
+                x[rd] = v;
+                break;
+            }
+            case 4:
+                if (!(c & 0x1000)) {
+                    if (rs2 == 0) {
+                        if (rd == 0) return fail("illegal instruction");
+                        return jump(x[rd] & ~1u) ? RUNNING : ERROR;
+                    }
+                    wr(rd, x[rs2]);
+                } else {
+                    if (rs2 == 0) {
+                        if (rd == 0) return HALT;
+                        v = x[rd];
+                        if (!jump(v & ~1u)) return ERROR;
+                        x[1] = next;
+                        return RUNNING;
+                    }
+                    wr(rd, x[rd] + x[rs2]);
+                }
+                break;
+            case 6: {
+                uint32_t off = ((c >> 7) & 0x3c) | ((c >> 1) & 0xc0);
+                if (!store(x[2] + off, 2, x[rs2])) return ERROR;
+                break;
+            }
+            default:
+                return fail("illegal instruction");
+            }
+        } else
+            return fail("illegal instruction");
+        pc = next;
+        return RUNNING;
+    }
+};
+
+// ---------------------------------------------------------------------------
+// Generator
+
+class Generator {
+public:
+    uint8_t image[RIGEN_MEM_SIZE];
+    uint32_t code_size;
+    std::string error;
+
+    Generator(const RigenConfig& cfg) : cfg(cfg) {}
+
+    bool generate(uint64_t seed) {
+        rng = seed * 0x9e3779b97f4a7c15ull + 0x2545f4914f6cdd1dull;
+        if (!rng) rng = 1;
+        insns.clear();
+        item_start.clear();
+        recent.clear();
+        last_rd = 0;
+        memset(image, 0, sizeof(image));
+        for (int i = RIGEN_DATA_ADDR; i < RIGEN_MEM_SIZE; i++)
+            image[i] = next();
+
+        new_item();
+        prologue();
+        int total = cfg.w_alu + (cfg.mul ? cfg.w_muldiv : 0) + cfg.w_mem + cfg.w_branch + cfg.w_jump +
+                cfg.w_loop + (cfg.custom ? cfg.w_custom : 0);
+        for (int i = 0; i < cfg.length; i++) {
+            new_item();
+            int w = total > 0 ? below(total) : 0;
+            if ((w -= cfg.w_alu) < 0) gen_alu();
+            else if (cfg.mul && (w -= cfg.w_muldiv) < 0) gen_muldiv();
+            else if ((w -= cfg.w_mem) < 0) gen_mem();
+            else if ((w -= cfg.w_branch) < 0) gen_branch();
+            else if ((w -= cfg.w_jump) < 0) gen_jump();
+            else if ((w -= cfg.w_loop) < 0) gen_loop();
+            else if (cfg.custom) gen_custom();
+            else gen_alu();
+        }
+        // trailing items so that forward targets of the last items exist
+        for (int i = 0; i < cfg.max_skip; i++) {
+            new_item();
+            gen_alu();
+        }
+        new_item();
+        epilogue();
+        return assemble();
+    }
+
+private:
+    enum Kind { PLAIN, BRANCH, JAL, CJ, CJAL, CBZ, ADDR };
+
+    struct Insn {
+        Kind kind;
+        uint32_t bits;
+        int size;
+        int a, b, c;            // kind specific operands
+        int t_item, t_off;      // control flow target: instruction t_off of item t_item
+        int ref;                // ADDR: index of the auipc the offset is relative to
+    };
+
+    const RigenConfig& cfg;
+    uint64_t rng;
+    std::vector<Insn> insns;
+    std::vector<int> item_start;
+    std::vector<uint32_t> addr;
+    std::vector<std::pair<uint32_t, int>> recent;
+    int last_rd;
+
+    uint32_t next() {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        return rng >> 32;
+    }
+    int below(int n) { return next() % n; }
+    bool chance(double p) { return next() < p * 4294967296.0; }
+
+    uint32_t random_value() {
+        static const uint32_t special[] = { 0, 1, 2, ~0u, 0x80000000, 0x7fffffff, 0xffff, 0x8000, 0x80, 0xff, 31, 32 };
+        switch (below(4)) {
+        case 0: return special[below(sizeof(special) / sizeof(*special))];
+        case 1: return (int32_t)(next() << 20) >> 20;
+        default: return next();
+        }
+    }
+
+    int32_t random_imm12() {
+        switch (below(4)) {
+        case 0: return below(2) ? 2047 : -2048;
+        case 1: return below(33) - 16;
+        default: return (int32_t)(next() << 20) >> 20;
+        }
+    }
+
+    // x2 (sp) and x8 (s0) are data base pointers, x4 (tp) is the loop counter
+    static bool reserved(int r) { return r == 2 || r == 4 || r == 8; }
+
+    int pick_rd(bool allow_zero = false) {
+        if (allow_zero && !below(32))
+            return 0;
+        int r;
+        do r = 1 + below(31); while (reserved(r));
+        return r;
+    }
+
+    int pick_rs() {
+        if (last_rd && chance(cfg.dep))
+            return last_rd;
+        return below(32);
+    }
+
+    int pick_rdp() { return 9 + below(7); }   // x9..x15 (x8 is reserved)
+
+    int pick_rsp() {
+        if (last_rd >= 8 && last_rd < 16 && chance(cfg.dep))
+            return last_rd;
+        return 8 + below(8);
+    }
+
+    bool use_rvc() { return cfg.compressed && chance(cfg.rvc); }
+
+    void new_item() { item_start.push_back(insns.size()); }
+    int cur_item() { return item_start.size() - 1; }
+
+    void emit(uint32_t bits, int rd = -1) {
+        Insn i = {};
+        i.kind = PLAIN;
+        i.bits = bits;
+        i.size = (bits & 3) == 3 ? 4 : 2;
+        insns.push_back(i);
+        if (rd > 0)
+            last_rd = rd;
+    }
+
+    void emit_ctrl(Kind kind, int a, int b, int c, int t_item, int t_off) {
+        Insn i = {};
+        i.kind = kind;
+        i.size = (kind == BRANCH || kind == JAL || kind == ADDR) ? 4 : 2;
+        i.a = a; i.b = b; i.c = c;
+        i.t_item = t_item;
+        i.t_off = t_off;
+        insns.push_back(i);
+    }
+
+    // --- encoders
+
+    static uint32_t r_type(int f7, int rs2, int rs1, int f3, int rd, int op) {
+        return f7 << 25 | rs2 << 20 | rs1 << 15 | f3 << 12 | rd << 7 | op;
+    }
+    static uint32_t i_type(int32_t imm, int rs1, int f3, int rd, int op) {
+        return (uint32_t)imm << 20 | rs1 << 15 | f3 << 12 | rd << 7 | op;
+    }
+    static uint32_t s_type(int32_t imm, int rs2, int rs1, int f3) {
+        return ((uint32_t)imm >> 5) << 25 | rs2 << 20 | rs1 << 15 | f3 << 12 | (imm & 31) << 7 | 0x23;
+    }
+    static uint32_t b_type(int32_t imm, int rs2, int rs1, int f3) {
+        uint32_t u = imm;
+        return ((u >> 12) & 1) << 31 | ((u >> 5) & 0x3f) << 25 | rs2 << 20 | rs1 << 15 | f3 << 12 |
+                ((u >> 1) & 0xf) << 8 | ((u >> 11) & 1) << 7 | 0x63;
+    }
+    static uint32_t j_type(int32_t imm, int rd) {
+        uint32_t u = imm;
+        return ((u >> 20) & 1) << 31 | ((u >> 1) & 0x3ff) << 21 | ((u >> 11) & 1) << 20 |
+                ((u >> 12) & 0xff) << 12 | rd << 7 | 0x6f;
+    }
+    static uint32_t ci(int f3, int32_t imm6, int rd, int op) {
+        return f3 << 13 | ((imm6 >> 5) & 1) << 12 | rd << 7 | (imm6 & 31) << 2 | op;
+    }
+    static uint32_t cj(int f3, int32_t imm) {
+        uint32_t u = imm;
+        return f3 << 13 | ((u >> 11) & 1) << 12 | ((u >> 4) & 1) << 11 | ((u >> 8) & 3) << 9 |
+                ((u >> 10) & 1) << 8 | ((u >> 6) & 1) << 7 | ((u >> 7) & 1) << 6 | ((u >> 1) & 7) << 3 |
+                ((u >> 5) & 1) << 2 | 1;
+    }
+    static uint32_t cb(int f3, int rs1p, int32_t imm) {
+        uint32_t u = imm;
+        return f3 << 13 | ((u >> 8) & 1) << 12 | ((u >> 3) & 3) << 10 | (rs1p - 8) << 7 |
+                ((u >> 6) & 3) << 5 | ((u >> 1) & 3) << 3 | ((u >> 5) & 1) << 2 | 1;
+    }
+    static uint32_t cl(int f3, int rdp, int rs1p, uint32_t off) {
+        return f3 << 13 | ((off >> 3) & 7) << 10 | (rs1p - 8) << 7 | ((off >> 2) & 1) << 6 |
+                ((off >> 6) & 1) << 5 | (rdp - 8) << 2;
+    }
+
+    void emit_li(int rd, uint32_t v) {
+        uint32_t lo = (int32_t)(v << 20) >> 20;
+        uint32_t hi = v - lo;
+        if (hi) {
+            emit(hi | rd << 7 | 0x37);
+            if (lo) emit(i_type(lo, rd, 0, rd, 0x13));
+        } else
+            emit(i_type(lo, 0, 0, rd, 0x13));
+    }
+
+    // --- items
+
+    void prologue() {
+        for (int r = 1; r < 32; r++) {
+            if (r == 2) emit_li(r, RIGEN_SP_BASE);
+            else if (r == 8) emit_li(r, RIGEN_S0_BASE);
+            else emit_li(r, random_value());
+        }
+        if (cfg.custom)
+            for (int i = 0; i < 4; i++)
+                emit(r_type(1, 0, 1 + below(31), 2, i, 0x0b));
+        last_rd = 0;
+    }
+
+    void epilogue() {
+        emit_li(8, RIGEN_SIG_ADDR);
+        for (int r = 1; r < 32; r++)
+            emit(s_type(4 * r, r, 8, 2));
+        if (cfg.custom)
+            for (int i = 0; i < 4; i++) {
+                emit(r_type(0, 0, i, 4, 1, 0x0b));
+                emit(s_type(0x80 + 4 * i, 1, 8, 2));
+            }
+        emit(0x00100073);
+    }
+
+    void gen_alu() {
+        int rd = pick_rd(true);
+        if (use_rvc() && rd) {
+            int rdp = pick_rdp();
+            int32_t imm6 = (int32_t)(next() << 26) >> 26;
+            switch (below(10)) {
+            case 0: emit(ci(0, imm6 ? imm6 : 1, rd, 1), rd); return;                           // c.addi
+            case 1: emit(ci(2, imm6, rd, 1), rd); return;                                       // c.li
+            case 2: if (rd == 2) break;
+                    emit(ci(3, imm6 ? imm6 : 1, rd, 1), rd); return;                            // c.lui
+            case 3: { int rs = pick_rs(); if (!rs) break;
+                    emit(0x8002 | rd << 7 | rs << 2, rd); return; }                             // c.mv
+            case 4: { int rs = pick_rs(); if (!rs) break;
+                    emit(0x9002 | rd << 7 | rs << 2, rd); return; }                             // c.add
+            case 5: emit(ci(0, 1 + below(31), rd, 2), rd); return;                              // c.slli
+            case 6: emit(ci(4, 1 + below(31), 8 * below(2) + rdp - 8, 1), rdp); return;          // c.srli/c.srai
+            case 7: emit(ci(4, imm6, 16 + rdp - 8, 1), rdp); return;                            // c.andi
+            case 8: emit(0x8c01 | (rdp - 8) << 7 | below(4) << 5 | (pick_rsp() - 8) << 2, rdp); return;  // c.sub/xor/or/and
+            default: {                                                                          // c.addi4spn
+                uint32_t imm = 4 * (1 + below(255));
+                emit((((imm >> 4) & 3) << 11 | ((imm >> 6) & 15) << 7 | ((imm >> 2) & 1) << 6 |
+                        ((imm >> 3) & 1) << 5 | (rdp - 8) << 2), rdp);
+                return;
+            }
+            }
+        }
+        static const int f3s_imm[6] = { 0, 2, 3, 4, 6, 7 };
+        switch (below(16)) {
+        case 0: emit((next() & 0xfffff000) | rd << 7 | 0x37, rd); break;                         // lui
+        case 1: emit((next() & 0xfffff000) | rd << 7 | 0x17, rd); break;                         // auipc
+        case 2: case 3: {
+            int f3 = below(3) ? 1 : 5;
+            emit(r_type(f3 == 5 && below(2) ? 0x20 : 0, below(32), pick_rs(), f3, rd, 0x13), rd);
+            break;
+        }
+        case 4: case 5: case 6: case 7: case 8:
+            emit(i_type(random_imm12(), pick_rs(), f3s_imm[below(6)], rd, 0x13), rd);
+            break;
+        case 9:
+            if (!below(4)) {                                                                     // fence
+                emit(0x0ff0000f);
+                break;
+            }
+            // fall through
+        default: {
+            int f3 = below(8);
+            bool alt = (f3 == 0 || f3 == 5) && below(2);
+            emit(r_type(alt ? 0x20 : 0, pick_rs(), pick_rs(), f3, rd, 0x33), rd);
+            break;
+        }
+        }
+    }
+
+    void gen_muldiv() {
+        int rd = pick_rd(true);
+        emit(r_type(1, pick_rs(), pick_rs(), below(8), rd, 0x33), rd);
+    }
+
+    void gen_mem() {
+        // choose size and address in the data region; with probability
+        // "hazard" overlap one of the last eight accesses
+        int size = 1 << below(3);
+        uint32_t a;
+        if (!recent.empty() && chance(cfg.hazard)) {
+            auto& r = recent[below(recent.size())];
+            a = r.first + (size < r.second ? below(r.second / size) * size : 0);
+            a &= ~(uint32_t)(size - 1);
+        } else if (below(2)) {
+            a = (below(2) ? RIGEN_S0_BASE : RIGEN_SP_BASE) + below(256);
+        } else {
+            a = RIGEN_DATA_ADDR + below(RIGEN_MEM_SIZE - RIGEN_DATA_ADDR);
+        }
+        a &= ~(uint32_t)(size - 1);
+        if (recent.size() == 8)
+            recent.erase(recent.begin());
+        recent.push_back(std::make_pair(a, size));
+
+        bool is_load = below(2);
+        if (size == 4 && use_rvc()) {
+            uint32_t s0_off = a - RIGEN_S0_BASE, sp_off = a - RIGEN_SP_BASE;
+            if (s0_off < 128) {
+                int r = pick_rdp();
+                if (is_load) emit(cl(2, r, 8, s0_off), r);
+                else emit(cl(6, pick_rsp(), 8, s0_off));
+                return;
+            }
+            if (sp_off < 256) {
+                if (is_load) {
+                    int rd = pick_rd();
+                    emit(0x4002 | ((sp_off >> 5) & 1) << 12 | rd << 7 | ((sp_off >> 2) & 7) << 4 |
+                            ((sp_off >> 6) & 3) << 2, rd);
+                } else {
+                    emit(0xc002 | ((sp_off >> 2) & 15) << 9 | ((sp_off >> 6) & 3) << 7 | pick_rs() << 2);
+                }
+                return;
+            }
+        }
+        int32_t off = a - RIGEN_S0_BASE;
+        int f3 = size == 1 ? 0 : size == 2 ? 1 : 2;
+        if (is_load) {
+            int rd = pick_rd(true);
+            if (size < 4 && below(2))
+                f3 |= 4;
+            emit(i_type(off, 8, f3, rd, 0x03), rd);
+        } else
+            emit(s_type(off, pick_rs(), 8, f3));
+    }
+
+    int forward_target() { return cur_item() + 1 + below(cfg.max_skip); }
+
+    void gen_branch() {
+        static const int f3s[6] = { 0, 1, 4, 5, 6, 7 };
+        if (use_rvc())
+            emit_ctrl(CBZ, below(2), pick_rsp(), 0, forward_target(), 0);
+        else
+            emit_ctrl(BRANCH, f3s[below(6)], pick_rs(), pick_rs(), forward_target(), 0);
+    }
+
+    void gen_jump() {
+        int t = forward_target();
+        int kind = below(cfg.compressed ? 4 : 2);
+        if (kind == 0) {
+            if (use_rvc())
+                emit_ctrl(below(2) ? CJ : CJAL, 0, 0, 0, t, 0);
+            else
+                emit_ctrl(JAL, pick_rd(true), 0, 0, t, 0);
+            last_rd = 0;
+            return;
+        }
+        // auipc rX, 0; jalr rd, off(rX)  or  auipc rX, 0; addi rX, rX, off; c.jr/c.jalr rX
+        int rx = pick_rd();
+        int ref = insns.size();
+        emit(rx << 7 | 0x17);
+        if (kind == 1) {
+            emit_ctrl(ADDR, pick_rd(true), rx, 0x67, t, 0);
+            insns.back().ref = ref;
+        } else {
+            emit_ctrl(ADDR, rx, rx, 0x13, t, 0);
+            insns.back().ref = ref;
+            emit(below(2) ? (0x8002 | rx << 7) : (0x9002 | rx << 7));
+        }
+        last_rd = 0;
+    }
+
+    void gen_loop() {
+        // addi tp, x0, N; body; addi tp, tp, -1; bne tp, x0, body
+        int n = 1 + below(8);
+        if (use_rvc()) emit(ci(2, n, 4, 1));
+        else emit(i_type(n, 0, 0, 4, 0x13));
+        int body = insns.size() - item_start.back();
+        int len = 1 + below(8);
+        for (int i = 0; i < len; i++) {
+            switch (below(3)) {
+            case 0: gen_mem(); break;
+            case 1: if (cfg.mul) { gen_muldiv(); break; }
+                    // fall through
+            default: gen_alu(); break;
+            }
+        }
+        if (use_rvc()) emit(ci(0, -1, 4, 1));
+        else emit(i_type(-1, 4, 0, 4, 0x13));
+        emit_ctrl(BRANCH, 1, 4, 0, cur_item(), body);
+    }
+
+    void gen_custom() {
+        switch (below(4)) {
+        case 0: { int rd = pick_rd(true); emit(r_type(0, 0, below(4), 4, rd, 0x0b), rd); break; }   // getq
+        case 1: emit(r_type(1, 0, pick_rs(), 2, below(4), 0x0b)); break;                            // setq
+        case 2: {
+            // maskirq: keep the timer, ebreak/illegal and bus error IRQs masked
+            int rs = pick_rd(), rd = pick_rd(true);
+            emit(i_type(7, rs, 6, rs, 0x13), rs);
+            emit(r_type(3, 0, rs, 6, rd, 0x0b), rd);
+            break;
+        }
+        default: { int rd = pick_rd(true); emit(r_type(5, 0, 0, 6, rd, 0x0b), rd); break; }        // timer rd, x0
+        }
+    }
+
+    // --- layout
+
+    int target_index(const Insn& i) { return item_start[i.t_item] + i.t_off; }
+
+    bool assemble() {
+        int n = insns.size();
+        addr.resize(n + 1);
+        for (bool changed = true; changed; ) {
+            changed = false;
+            addr[0] = 0;
+            for (int i = 0; i < n; i++)
+                addr[i + 1] = addr[i] + insns[i].size;
+            for (int i = 0; i < n; i++) {
+                Insn& in = insns[i];
+                if (in.kind != CJ && in.kind != CJAL && in.kind != CBZ)
+                    continue;
+                int32_t off = addr[target_index(in)] - addr[i];
+                int32_t range = in.kind == CBZ ? 256 : 2048;
+                if (off >= -range && off < range)
+                    continue;
+                // out of range for the compressed form: fall back to 32 bits
+                if (in.kind == CBZ) {
+                    // beq/bne rs1', x0 (a is already funct3, b is rs1)
+                    in.kind = BRANCH;
+                    in.c = 0;
+                } else {
+                    in.a = in.kind == CJAL ? 1 : 0;
+                    in.kind = JAL;
+                }
+                in.size = 4;
+                changed = true;
+            }
+        }
+        code_size = addr[n];
+        if (code_size > RIGEN_CODE_LIMIT) {
+            error = "program does not fit below the signature area (reduce --length)";
+            return false;
+        }
+        for (int i = 0; i < n; i++) {
+            Insn& in = insns[i];
+            uint32_t bits = in.bits;
+            int32_t off = in.kind == PLAIN ? 0 : addr[target_index(in)] - addr[in.kind == ADDR ? in.ref : i];
+            switch (in.kind) {
+            case PLAIN: break;
+            case BRANCH:
+                if (off < -4096 || off >= 4096) {
+                    error = "branch target out of range";
+                    return false;
+                }
+                bits = b_type(off, in.c, in.b, in.a);
+                break;
+            case JAL: bits = j_type(off, in.a); break;
+            case CJ: bits = cj(5, off); break;
+            case CJAL: bits = cj(1, off); break;
+            case CBZ: bits = cb(in.a ? 7 : 6, in.b, off); break;
+            case ADDR:
+                if (off < -2048 || off >= 2048) {
+                    error = "jump target out of range";
+                    return false;
+                }
+                bits = i_type(off, in.b, 0, in.a, in.c);
+                break;
+            }
+            for (int k = 0; k < in.size; k++)
+                image[addr[i] + k] = bits >> (8 * k);
+        }
+        return true;
+    }
+};
+
+// ---------------------------------------------------------------------------
+// Output files
+
+// ELF with one loadable segment covering the whole 16 kB image and .text /
+// .data sections, so objdump -d works on it
+inline bool rigen_write_elf(const char* filename, const uint8_t* image, uint32_t code_size) {
+    static const char shstrtab[] = "\0.text\0.data\0.shstrtab";
+    uint32_t data_off = sizeof(Elf32_Ehdr) + sizeof(Elf32_Phdr);
+    data_off = (data_off + 15) & ~15u;
+    uint32_t str_off = data_off + RIGEN_MEM_SIZE;
+    uint32_t sh_off = (str_off + sizeof(shstrtab) + 3) & ~3u;
+
+    Elf32_Ehdr eh = {};
+    memcpy(eh.e_ident, ELFMAG, SELFMAG);
+    eh.e_ident[EI_CLASS] = ELFCLASS32;
+    eh.e_ident[EI_DATA] = ELFDATA2LSB;
+    eh.e_ident[EI_VERSION] = EV_CURRENT;
+    eh.e_type = ET_EXEC;
+    eh.e_machine = EM_RISCV;
+    eh.e_version = EV_CURRENT;
+    eh.e_entry = 0;
+    eh.e_phoff = sizeof(Elf32_Ehdr);
+    eh.e_shoff = sh_off;
+    eh.e_ehsize = sizeof(Elf32_Ehdr);
+    eh.e_phentsize = sizeof(Elf32_Phdr);
+    eh.e_phnum = 1;
+    eh.e_shentsize = sizeof(Elf32_Shdr);
+    eh.e_shnum = 4;
+    eh.e_shstrndx = 3;
+
+    Elf32_Phdr ph = {};
+    ph.p_type = PT_LOAD;
+    ph.p_offset = data_off;
+    ph.p_filesz = ph.p_memsz = RIGEN_MEM_SIZE;
+    ph.p_flags = PF_R | PF_W | PF_X;
+    ph.p_align = 4;
+
+    Elf32_Shdr sh[4] = {};
+    sh[1].sh_name = 1;
+    sh[1].sh_type = SHT_PROGBITS;
+    sh[1].sh_flags = SHF_ALLOC | SHF_EXECINSTR;
+    sh[1].sh_offset = data_off;
+    sh[1].sh_size = code_size;
+    sh[1].sh_addralign = 2;
+    sh[2].sh_name = 7;
+    sh[2].sh_type = SHT_PROGBITS;
+    sh[2].sh_flags = SHF_ALLOC | SHF_WRITE;
+    sh[2].sh_addr = RIGEN_SIG_ADDR;
+    sh[2].sh_offset = data_off + RIGEN_SIG_ADDR;
+    sh[2].sh_size = RIGEN_MEM_SIZE - RIGEN_SIG_ADDR;
+    sh[2].sh_addralign = 4;
+    sh[3].sh_name = 13;
+    sh[3].sh_type = SHT_STRTAB;
+    sh[3].sh_offset = str_off;
+    sh[3].sh_size = sizeof(shstrtab);
+    sh[3].sh_addralign = 1;
+
+    FILE* f = fopen(filename, "wb");
+    if (!f) {
+        fprintf(stderr, "Error: Cannot create '%s'\n", filename);
+        return false;
+    }
+    static const uint8_t zero[16] = {};
+    fwrite(&eh, sizeof(eh), 1, f);
+    fwrite(&ph, sizeof(ph), 1, f);
+    fwrite(zero, data_off - sizeof(eh) - sizeof(ph), 1, f);
+    fwrite(image, RIGEN_MEM_SIZE, 1, f);
+    fwrite(shstrtab, sizeof(shstrtab), 1, f);
+    fwrite(zero, sh_off - str_off - sizeof(shstrtab), 1, f);
+    fwrite(sh, sizeof(sh), 1, f);
+    return fclose(f) == 0;
+}
+
+// Expected final memory, one 32-bit word per line ($readmemh format, as the
+// +ref= file of scripts/torture/testbench.v)
+inline bool rigen_write_ref(const char* filename, const uint8_t* mem) {
+    FILE* f = fopen(filename, "w");
+    if (!f) {
+        fprintf(stderr, "Error: Cannot create '%s'\n", filename);
+        return false;
+    }
+    for (int i = 0; i < RIGEN_MEM_SIZE; i += 4)
+        fprintf(f, "%08x\n", mem[i] | mem[i + 1] << 8 | mem[i + 2] << 16 | (uint32_t)mem[i + 3] << 24);
+    return fclose(f) == 0;
+}
+
+#endif
@@ -0,0 +1,136 @@
+// In-process random regression for picorv32: generates tests with rigen.h,
+// runs them on the reference model and on the Verilated core (testbench.v)
+// and compares the final 16 kB memory image. The model is only reset between
+// tests, so there are no files, no recompilation and no process start-up per
+// test.
+//
+// Usage: rigen_tb [options]
+//   -n N              Number of tests (default: 1000)
+//   --seed=S          Seed of the first test (default: 1)
+//   -o DIR            Write failing tests (test_<seed>.elf/.ref) to DIR
+//   --max-cycles=N    Per-test cycle limit (default: 1000000)
+//   --keep-going      Do not stop at the first failing test
+//   (see RigenConfig::usage for the generator options; they must match the
+//   parameters the model was built with, see Makefile)
+
+#include "Vtestbench.h"
+#include "Vtestbench_testbench.h"
+#include "verilated.h"
+#include "rigen.h"
+
+#include <cinttypes>
+#include <chrono>
+
+static void usage(const char* argv0) {
+    fprintf(stderr, "Usage: %s [options]\n", argv0);
+    fprintf(stderr, "  -n N              Number of tests (default: 1000)\n");
+    fprintf(stderr, "  --seed=S          Seed of the first test (default: 1)\n");
+    fprintf(stderr, "  -o DIR            Write failing tests to DIR\n");
+    fprintf(stderr, "  --max-cycles=N    Per-test cycle limit (default: 1000000)\n");
+    fprintf(stderr, "  --keep-going      Do not stop at the first failing test\n");
+    RigenConfig::usage(stderr);
+}
+
+int main(int argc, char** argv) {
+    RigenConfig cfg;
+    uint64_t count = 1000, seed = 1, max_cycles = 1000000;
+    const char* outdir = nullptr;
+    bool keep_going = false;
+
+    Verilated::commandArgs(argc, argv);
+    for (int i = 1; i < argc; i++) {
+        bool ok;
+        if (cfg.parse_option(argv[i], &ok)) {
+            if (!ok) {
+                fprintf(stderr, "Error: Invalid option '%s'\n", argv[i]);
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            count = strtoull(argv[++i], nullptr, 0);
+        } else if (!strncmp(argv[i], "--seed=", 7)) {
+            seed = strtoull(argv[i] + 7, nullptr, 0);
+        } else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+            outdir = argv[++i];
+        } else if (!strncmp(argv[i], "--max-cycles=", 13)) {
+            max_cycles = strtoull(argv[i] + 13, nullptr, 0);
+        } else if (!strcmp(argv[i], "--keep-going")) {
+            keep_going = true;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    Vtestbench* top = new Vtestbench;
+    uint32_t* memory = top->testbench->memory.data();
+    Generator gen(cfg);
+    Iss iss(cfg);
+    uint64_t passed = 0, failed = 0, total_cycles = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint64_t n = 0; n < count && (keep_going || !failed); n++, seed++) {
+        if (!gen.generate(seed)) {
+            fprintf(stderr, "Error: seed %" PRIu64 ": %s\n", seed, gen.error.c_str());
+            return 1;
+        }
+        iss.reset(gen.image);
+        if (iss.run(1000000) != Iss::HALT) {
+            fprintf(stderr, "Error: seed %" PRIu64 ": reference model: %s at pc 0x%04x\n", seed, iss.error, iss.pc);
+            return 1;
+        }
+
+        memcpy(memory, gen.image, RIGEN_MEM_SIZE);
+        top->resetn = 0;
+        for (int i = 0; i < 4; i++) {
+            top->clk = 1;
+            top->eval();
+            top->clk = 0;
+            top->eval();
+        }
+        top->resetn = 1;
+        uint64_t cycles = 0;
+        while (!top->trap && cycles < max_cycles) {
+            top->clk = 1;
+            top->eval();
+            top->clk = 0;
+            top->eval();
+            cycles++;
+        }
+        total_cycles += cycles;
+
+        int errors = 0;
+        if (!top->trap) {
+            printf("FAILED seed %" PRIu64 ": timeout after %" PRIu64 " cycles\n", seed, cycles);
+            errors++;
+        } else {
+            for (int i = 0; i < RIGEN_MEM_SIZE / 4; i++) {
+                uint32_t expected;
+                memcpy(&expected, iss.mem.data() + 4 * i, 4);
+                if (memory[i] != expected) {
+                    if (errors++ < 8)
+                        printf("FAILED seed %" PRIu64 ": %04x: core=%08x ref=%08x\n", seed, 4 * i, memory[i], expected);
+                }
+            }
+        }
+        if (errors) {
+            failed++;
+            if (outdir) {
+                std::string base = std::string(outdir) + "/test_" + std::to_string(seed);
+                rigen_write_elf((base + ".elf").c_str(), gen.image, gen.code_size);
+                rigen_write_ref((base + ".ref").c_str(), iss.mem.data());
+                printf("Wrote %s.elf and %s.ref\n", base.c_str(), base.c_str());
+            }
+        } else
+            passed++;
+    }
+
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%s: %" PRIu64 " passed, %" PRIu64 " failed, %.0f cycles per test, %.0f tests/s\n",
+            failed ? "FAILED" : "PASSED", passed, failed,
+            passed + failed ? (double)total_cycles / (passed + failed) : 0.0,
+            secs > 0 ? (passed + failed) / secs : 0.0);
+
+    top->final();
+    delete top;
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,115 @@
+// Core under test for rigen_tb (testbench.cc). Same memory model as
+// scripts/torture/testbench.v (16 kB, random wait states from an xorshift
+// generator), but reset is driven from C++ so one model runs many tests,
+// and the core parameters are module parameters (set with verilator -G).
+
+module testbench #(
+	parameter [0:0] COMPRESSED_ISA = 1,
+	parameter [0:0] ENABLE_MUL = 1,
+	parameter [0:0] ENABLE_FAST_MUL = 0,
+	parameter [0:0] ENABLE_DIV = 1,
+	parameter [0:0] ENABLE_IRQ = 1,
+	parameter [0:0] ENABLE_REGS_DUALPORT = 1,
+	parameter [0:0] TWO_STAGE_SHIFT = 1,
+	parameter [0:0] BARREL_SHIFTER = 0,
+	parameter [0:0] TWO_CYCLE_COMPARE = 0,
+	parameter [0:0] TWO_CYCLE_ALU = 0
+) (
+	input clk,
+	input resetn,
+	output trap
+);
+	wire        mem_valid;
+	wire        mem_instr;
+	reg         mem_ready;
+	wire [31:0] mem_addr;
+	wire [31:0] mem_wdata;
+	wire [3:0]  mem_wstrb;
+	reg  [31:0] mem_rdata;
+
+	wire        mem_la_read;
+	wire        mem_la_write;
+	wire [31:0] mem_la_addr;
+	wire [31:0] mem_la_wdata;
+	wire [3:0]  mem_la_wstrb;
+
+	reg [31:0] x32 = 314159265;
+	reg [31:0] next_x32;
+
+	always @(posedge clk) begin
+		if (resetn) begin
+			next_x32 = x32;
+			next_x32 = next_x32 ^ (next_x32 << 13);
+			next_x32 = next_x32 ^ (next_x32 >> 17);
+			next_x32 = next_x32 ^ (next_x32 << 5);
+			x32 <= next_x32;
+		end
+	end
+
+	picorv32 #(
+		.COMPRESSED_ISA      (COMPRESSED_ISA      ),
+		.ENABLE_MUL          (ENABLE_MUL          ),
+		.ENABLE_FAST_MUL     (ENABLE_FAST_MUL     ),
+		.ENABLE_DIV          (ENABLE_DIV          ),
+		.ENABLE_IRQ          (ENABLE_IRQ          ),
+		.ENABLE_IRQ_QREGS    (ENABLE_IRQ          ),
+		.ENABLE_IRQ_TIMER    (ENABLE_IRQ          ),
+		.ENABLE_REGS_DUALPORT(ENABLE_REGS_DUALPORT),
+		.TWO_STAGE_SHIFT     (TWO_STAGE_SHIFT     ),
+		.BARREL_SHIFTER      (BARREL_SHIFTER      ),
+		.TWO_CYCLE_COMPARE   (TWO_CYCLE_COMPARE   ),
+		.TWO_CYCLE_ALU       (TWO_CYCLE_ALU       ),
+		.CATCH_MISALIGN      (1                   ),
+		.CATCH_ILLINSN       (1                   )
+	) uut (
+		.clk         (clk         ),
+		.resetn      (resetn      ),
+		.trap        (trap        ),
+
+		.mem_valid   (mem_valid   ),
+		.mem_instr   (mem_instr   ),
+		.mem_ready   (mem_ready   ),
+		.mem_addr    (mem_addr    ),
+		.mem_wdata   (mem_wdata   ),
+		.mem_wstrb   (mem_wstrb   ),
+		.mem_rdata   (mem_rdata   ),
+
+		.mem_la_read (mem_la_read ),
+		.mem_la_write(mem_la_write),
+		.mem_la_addr (mem_la_addr ),
+		.mem_la_wdata(mem_la_wdata),
+		.mem_la_wstrb(mem_la_wstrb)
+	);
+
+	reg [31:0] memory [0:4095] /* verilator public */;
+
+	always @(posedge clk) begin
+		mem_ready <= 0;
+		mem_rdata <= 'bx;
+
+		if (!trap && resetn && x32[0]) begin
+			if (mem_la_read) begin
+				mem_ready <= 1;
+				mem_rdata <= memory[mem_la_addr[13:2]];
+			end else
+			if (mem_la_write) begin
+				mem_ready <= 1;
+				if (mem_la_wstrb[0]) memory[mem_la_addr[13:2]][ 7: 0] <= mem_la_wdata[ 7: 0];
+				if (mem_la_wstrb[1]) memory[mem_la_addr[13:2]][15: 8] <= mem_la_wdata[15: 8];
+				if (mem_la_wstrb[2]) memory[mem_la_addr[13:2]][23:16] <= mem_la_wdata[23:16];
+				if (mem_la_wstrb[3]) memory[mem_la_addr[13:2]][31:24] <= mem_la_wdata[31:24];
+			end else
+			if (mem_valid && !mem_ready) begin
+				mem_ready <= 1;
+				if (mem_wstrb) begin
+					if (mem_wstrb[0]) memory[mem_addr[13:2]][ 7: 0] <= mem_wdata[ 7: 0];
+					if (mem_wstrb[1]) memory[mem_addr[13:2]][15: 8] <= mem_wdata[15: 8];
+					if (mem_wstrb[2]) memory[mem_addr[13:2]][23:16] <= mem_wdata[23:16];
+					if (mem_wstrb[3]) memory[mem_addr[13:2]][31:24] <= mem_wdata[31:24];
+				end else begin
+					mem_rdata <= memory[mem_addr[13:2]];
+				end
+			end
+		end
+	end
+endmodule
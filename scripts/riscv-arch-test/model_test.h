@@ -0,0 +1,37 @@
+// riscv-arch-test target definitions for testbench_cli (testbench.v)
+
+#ifndef _COMPLIANCE_MODEL_H
+#define _COMPLIANCE_MODEL_H
+
+#define RVMODEL_DATA_SECTION
+
+// Write the tests_passed marker of testbench.v, then ebreak to stop the core
+#define RVMODEL_HALT \
+  li t0, 0x20000000; \
+  li t1, 123456789; \
+  sw t1, 0(t0); \
+  ebreak;
+
+#define RVMODEL_BOOT
+
+// testbench_cli --signature dumps the memory between these two symbols
+#define RVMODEL_DATA_BEGIN \
+  RVMODEL_DATA_SECTION \
+  .align 4; .global begin_signature; begin_signature:
+
+#define RVMODEL_DATA_END \
+  .align 4; .global end_signature; end_signature:
+
+#define RVMODEL_IO_INIT
+#define RVMODEL_IO_WRITE_STR(_R, _STR)
+#define RVMODEL_IO_CHECK()
+#define RVMODEL_IO_ASSERT_GPR_EQ(_S, _R, _I)
+#define RVMODEL_IO_ASSERT_SFPR_EQ(_F, _R, _I)
+#define RVMODEL_IO_ASSERT_DFPR_EQ(_D, _R, _I)
+
+#define RVMODEL_SET_MSW_INT
+#define RVMODEL_CLEAR_MSW_INT
+#define RVMODEL_CLEAR_MTIMER_INT
+#define RVMODEL_CLEAR_MEXT_INT
+
+#endif
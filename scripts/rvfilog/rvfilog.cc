@@ -0,0 +1,219 @@
+// Queries on RVFI logs written by testbench_cli --rvfi-log (see rvfilog.h)
+//
+// Usage: rvfilog dump FILE      one line per record, same format as --commit-log
+//        rvfilog mix FILE       instruction mix (mnemonic, count, percent)
+//        rvfilog info FILE      records, chunks and compressed size per column
+
+#include "rvfilog.h"
+
+#include <cinttypes>
+#include <cstdlib>
+#include <string>
+#include <map>
+#include <algorithm>
+
+// RV32IMC and picorv32 custom mnemonics; the instruction mix only needs the
+// opcode, so operands are not decoded
+static const char* mnemonic(uint32_t insn) {
+    if ((insn & 3) != 3) {
+        static const char* const q0[8] = {"c.addi4spn", "?", "c.lw", "?", "?", "?", "c.sw", "?"};
+        static const char* const q2[8] = {"c.slli", "?", "c.lwsp", "?", "?", "?", "c.swsp", "?"};
+        uint32_t f3 = (insn >> 13) & 7;
+        switch (insn & 3) {
+        case 0:
+            return q0[f3];
+        case 1:
+            switch (f3) {
+            case 0: return "c.addi";
+            case 1: return "c.jal";
+            case 2: return "c.li";
+            case 3: return ((insn >> 7) & 31) == 2 ? "c.addi16sp" : "c.lui";
+            case 4:
+                switch ((insn >> 10) & 3) {
+                case 0: return "c.srli";
+                case 1: return "c.srai";
+                case 2: return "c.andi";
+                default: {
+                    static const char* const ops[4] = {"c.sub", "c.xor", "c.or", "c.and"};
+                    return (insn & 0x1000) ? "?" : ops[(insn >> 5) & 3];
+                }
+                }
+            case 5: return "c.j";
+            case 6: return "c.beqz";
+            default: return "c.bnez";
+            }
+        default:
+            if (f3 == 4) {
+                bool rs2 = (insn >> 2) & 31;
+                if (insn & 0x1000)
+                    return rs2 ? "c.add" : ((insn >> 7) & 31) ? "c.jalr" : "c.ebreak";
+                return rs2 ? "c.mv" : "c.jr";
+            }
+            return q2[f3];
+        }
+    }
+
+    uint32_t f3 = (insn >> 12) & 7, f7 = insn >> 25;
+    switch (insn & 0x7f) {
+    case 0x37: return "lui";
+    case 0x17: return "auipc";
+    case 0x6f: return "jal";
+    case 0x67: return "jalr";
+    case 0x63: {
+        static const char* const ops[8] = {"beq", "bne", "?", "?", "blt", "bge", "bltu", "bgeu"};
+        return ops[f3];
+    }
+    case 0x03: {
+        static const char* const ops[8] = {"lb", "lh", "lw", "?", "lbu", "lhu", "?", "?"};
+        return ops[f3];
+    }
+    case 0x23: {
+        static const char* const ops[8] = {"sb", "sh", "sw", "?", "?", "?", "?", "?"};
+        return ops[f3];
+    }
+    case 0x13: {
+        static const char* const ops[8] = {"addi", "slli", "slti", "sltiu", "xori", "srli", "ori", "andi"};
+        uint32_t imm = insn >> 20;
+        if (f3 == 5 && f7 == 0x30)
+            return "rori";
+        if (f3 == 5 && (imm == 0x687 || imm == 0x698))
+            return imm == 0x687 ? "brev8" : "rev8";
+        if ((f3 == 1 || f3 == 5) && imm == 0x08f)
+            return f3 == 1 ? "zip" : "unzip";
+        return f3 == 5 && (f7 & 0x20) ? "srai" : ops[f3];
+    }
+    case 0x33: {
+        static const char* const ops[8] = {"add", "sll", "slt", "sltu", "xor", "srl", "or", "and"};
+        static const char* const mops[8] = {"mul", "mulh", "mulhsu", "mulhu", "div", "divu", "rem", "remu"};
+        if (f7 == 1)
+            return mops[f3];
+        static const char* const bops[8] = {"sub", "?", "?", "?", "xnor", "sra", "orn", "andn"};
+        if (f7 == 0x20)
+            return bops[f3];
+        if (f7 == 7)
+            return f3 == 5 ? "czero.eqz" : f3 == 7 ? "czero.nez" : "?";
+        if (f7 == 0x05)
+            return f3 == 1 ? "clmul" : f3 == 2 ? "clmulr" : f3 == 3 ? "clmulh" : "?";
+        if (f7 == 0x30)
+            return f3 == 1 ? "rol" : f3 == 5 ? "ror" : "?";
+        if (f7 == 0x04)
+            return f3 == 4 ? "pack" : f3 == 7 ? "packh" : "?";
+        if (f7 == 0x14)
+            return f3 == 2 ? "xperm4" : f3 == 4 ? "xperm8" : "?";
+        return ops[f3];
+    }
+    case 0x0f: return "fence";
+    case 0x73:
+        if (f3 == 0)
+            return insn == 0x00100073 ? "ebreak" : insn == 0x00000073 ? "ecall" : "?";
+        return f3 == 2 ? "rdcsr" : "?";
+    case 0x0b: {
+        static const char* const ops[6] = {"getq", "setq", "retirq", "maskirq", "waitirq", "timer"};
+        return f7 < 6 ? ops[f7] : "?";
+    }
+    default: return "?";
+    }
+}
+
+static int dump(const char* filename) {
+    RvfiLogReader reader;
+    if (!reader.open(filename)) {
+        fprintf(stderr, "Error: Cannot open RVFI log '%s'\n", filename);
+        return 1;
+    }
+    RvfiLogRecord r;
+    while (reader.next(&r)) {
+        printf("%" PRIu64 " %" PRIu64 " %08x %08x x%u:%08x x%u:%08x x%u:%08x %08x %x %x %08x %08x %08x %s%s\n",
+               r.order, r.cycle, r.pc_rdata, r.insn, r.rs1_addr, r.rs1_rdata, r.rs2_addr, r.rs2_rdata,
+               r.rd_addr, r.rd_wdata, r.mem_addr, r.mem_rmask, r.mem_wmask, r.mem_rdata, r.mem_wdata,
+               r.pc_wdata, r.intr ? "I" : "-", r.trap ? "T" : "-");
+    }
+    if (reader.error) {
+        fprintf(stderr, "Error: %s: %s\n", filename, reader.error);
+        return 1;
+    }
+    return 0;
+}
+
+static int mix(const char* filename) {
+    RvfiLogReader reader;
+    if (!reader.open(filename, 1u << RVFILOG_INSN)) {
+        fprintf(stderr, "Error: Cannot open RVFI log '%s'\n", filename);
+        return 1;
+    }
+    std::map<std::string, uint64_t> counts;
+    std::vector<RvfiLogRecord> chunk;
+    uint64_t total = 0;
+    while (reader.next_chunk(&chunk)) {
+        for (const RvfiLogRecord& r : chunk)
+            counts[mnemonic(r.insn)]++;
+        total += chunk.size();
+    }
+    if (reader.error) {
+        fprintf(stderr, "Error: %s: %s\n", filename, reader.error);
+        return 1;
+    }
+    std::vector<std::pair<uint64_t, std::string>> sorted;
+    for (const auto& c : counts)
+        sorted.push_back(std::make_pair(c.second, c.first));
+    std::sort(sorted.rbegin(), sorted.rend());
+    for (const auto& s : sorted)
+        printf("%-12s %12" PRIu64 " %6.2f%%\n", s.second.c_str(), s.first, 100.0 * s.first / total);
+    printf("%-12s %12" PRIu64 "\n", "total", total);
+    return 0;
+}
+
+static int info(const char* filename) {
+    FILE* f = fopen(filename, "rb");
+    char magic[8];
+    if (!f || fread(magic, 1, sizeof(magic), f) != sizeof(magic) || memcmp(magic, rvfilog_magic, sizeof(magic))) {
+        fprintf(stderr, "Error: Cannot open RVFI log '%s'\n", filename);
+        return 1;
+    }
+    uint64_t records = 0, chunks = 0, raw[RVFILOG_NUM_COLUMNS] = {}, zsize[RVFILOG_NUM_COLUMNS] = {};
+    uint32_t hdr[2];
+    while (fread(hdr, 4, 2, f) == 2) {
+        uint64_t skip = 0;
+        for (uint32_t i = 0; i < hdr[1]; i++) {
+            uint8_t desc[4];
+            uint32_t sizes[4];
+            if (fread(desc, 1, 4, f) != 4 || fread(sizes, 4, 4, f) != 4 || desc[0] >= RVFILOG_NUM_COLUMNS) {
+                fprintf(stderr, "Error: %s: truncated chunk header\n", filename);
+                return 1;
+            }
+            raw[desc[0]] += sizes[2];
+            zsize[desc[0]] += sizes[3];
+            skip += sizes[3];
+        }
+        fseek(f, skip, SEEK_CUR);
+        records += hdr[0];
+        chunks++;
+    }
+    fclose(f);
+
+    uint64_t total = 0;
+    for (int i = 0; i < RVFILOG_NUM_COLUMNS; i++)
+        total += zsize[i];
+    printf("%" PRIu64 " records in %" PRIu64 " chunks, %.2f bytes per record\n", records, chunks,
+           records ? (double)total / records : 0.0);
+    printf("%-10s %14s %14s %8s\n", "column", "raw bytes", "compressed", "ratio");
+    for (int i = 0; i < RVFILOG_NUM_COLUMNS; i++)
+        printf("%-10s %14" PRIu64 " %14" PRIu64 " %7.1fx\n", rvfilog_column_names[i], raw[i], zsize[i],
+               zsize[i] ? (double)raw[i] / zsize[i] : 0.0);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s { dump | mix | info } FILE\n", argv[0]);
+        return 1;
+    }
+    if (!strcmp(argv[1], "dump"))
+        return dump(argv[2]);
+    if (!strcmp(argv[1], "mix"))
+        return mix(argv[2]);
+    if (!strcmp(argv[1], "info"))
+        return info(argv[2]);
+    fprintf(stderr, "Error: Unknown command '%s'\n", argv[1]);
+    return 1;
+}
@@ -0,0 +1,366 @@
+// Columnar, compressed RVFI commit log, written by testbench_cli --rvfi-log
+// and read by rvfilog.cc and rvfilog.py.
+//
+// The file starts with the 8 byte magic "PRVRVF01", followed by chunks of up
+// to RVFILOG_CHUNK records. Every chunk can be decoded on its own:
+//
+//   u32     number of records
+//   u32     number of columns
+//   per column:
+//     u8    column id (RvfiLogColumn)
+//     u8    value width in bytes (1, 2, 4 or 8)
+//     u8    encoding (RvfiLogEncoding)
+//     u8    0
+//     u32   number of values
+//     u32   number of dictionary entries
+//     u32   uncompressed size
+//     u32   compressed size
+//   per column, in the same order: the zlib compressed column data
+//
+// The column data is the dictionary (u32 entries) followed by the values.
+// Values wider than one byte are stored byte-plane by byte-plane (all lowest
+// bytes first), which lets zlib find the runs in small deltas and in the
+// upper bytes of addresses. All integers are little endian.
+//
+// Encodings: RAW stores the value, DELTA the difference to the previous value
+// of the column in the same chunk (the first value is stored as is), DICT a
+// u16 index into the dictionary of the chunk. The mem_addr, mem_rdata and
+// mem_wdata columns are sparse: they only have a value for the records whose
+// mem_mask has a read or write (mem_addr), read (mem_rdata) or write
+// (mem_wdata) bit set. Readers get 0 for the other records (RVFI leaves the
+// fields of an access that did not happen undefined).
+//
+// A query only decompresses the columns it needs (see the columns argument
+// of RvfiLogReader::open), so an instruction mix never touches the register
+// and memory data.
+
+#ifndef RVFILOG_H
+#define RVFILOG_H
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <unordered_map>
+#include <zlib.h>
+
+enum RvfiLogColumn {
+    RVFILOG_ORDER,      // u64, DELTA
+    RVFILOG_CYCLE,      // u64, DELTA
+    RVFILOG_PC,         // u32, DELTA   pc_rdata
+    RVFILOG_PC_STEP,    // u32, RAW     pc_wdata - pc_rdata
+    RVFILOG_INSN,       // u32, DICT
+    RVFILOG_RS1_ADDR,   // u8,  RAW
+    RVFILOG_RS2_ADDR,   // u8,  RAW
+    RVFILOG_RD_ADDR,    // u8,  RAW
+    RVFILOG_RS1_RDATA,  // u32, RAW
+    RVFILOG_RS2_RDATA,  // u32, RAW
+    RVFILOG_RD_WDATA,   // u32, RAW
+    RVFILOG_MEM_MASK,   // u8,  RAW     rmask | wmask << 4
+    RVFILOG_MEM_ADDR,   // u32, DELTA   sparse
+    RVFILOG_MEM_RDATA,  // u32, RAW     sparse
+    RVFILOG_MEM_WDATA,  // u32, RAW     sparse
+    RVFILOG_FLAGS,      // u8,  RAW     trap | intr << 1
+    RVFILOG_NUM_COLUMNS
+};
+
+enum RvfiLogEncoding { RVFILOG_RAW = 0, RVFILOG_DELTA = 1, RVFILOG_DICT = 2 };
+
+static const char rvfilog_magic[8] = {'P', 'R', 'V', 'R', 'V', 'F', '0', '1'};
+static const uint32_t RVFILOG_CHUNK = 65536;
+static const uint32_t RVFILOG_ALL = (1u << RVFILOG_NUM_COLUMNS) - 1;
+
+static const char* const rvfilog_column_names[RVFILOG_NUM_COLUMNS] = {
+    "order", "cycle", "pc", "pc_step", "insn", "rs1_addr", "rs2_addr", "rd_addr",
+    "rs1_rdata", "rs2_rdata", "rd_wdata", "mem_mask", "mem_addr", "mem_rdata", "mem_wdata", "flags"
+};
+
+struct RvfiLogRecord {
+    uint64_t order;
+    uint64_t cycle;
+    uint32_t insn;
+    uint32_t pc_rdata, pc_wdata;
+    uint32_t rs1_rdata, rs2_rdata, rd_wdata;
+    uint32_t mem_addr, mem_rdata, mem_wdata;
+    uint8_t rs1_addr, rs2_addr, rd_addr;
+    uint8_t mem_rmask, mem_wmask;
+    bool trap, intr;
+};
+
+class RvfiLogWriter {
+private:
+    struct Column {
+        uint8_t width, encoding;
+        std::vector<uint64_t> values;
+        std::vector<uint32_t> dict;
+    };
+
+    FILE* f;
+    int level;
+    uint32_t count;
+    Column cols[RVFILOG_NUM_COLUMNS];
+    std::unordered_map<uint32_t, uint16_t> dict_index;
+    std::vector<uint8_t> raw;
+
+    void flush() {
+        if (!count)
+            return;
+        uint32_t hdr[2] = {count, RVFILOG_NUM_COLUMNS};
+        fwrite(hdr, 4, 2, f);
+
+        std::vector<std::vector<uint8_t>> data(RVFILOG_NUM_COLUMNS);
+        for (int id = 0; id < RVFILOG_NUM_COLUMNS; id++) {
+            Column& c = cols[id];
+            size_t n = c.values.size();
+            raw.resize(4 * c.dict.size() + n * c.width);
+            if (!c.dict.empty())
+                memcpy(raw.data(), c.dict.data(), 4 * c.dict.size());
+            uint8_t* p = raw.data() + 4 * c.dict.size();
+            uint64_t prev = 0;
+            for (size_t i = 0; i < n; i++) {
+                uint64_t v = c.values[i];
+                if (c.encoding == RVFILOG_DELTA) {
+                    v -= prev;
+                    prev = c.values[i];
+                }
+                for (int b = 0; b < c.width; b++)
+                    p[b * n + i] = v >> (8 * b);
+            }
+
+            uLongf zsize = compressBound(raw.size());
+            data[id].resize(zsize);
+            compress2(data[id].data(), &zsize, raw.data(), raw.size(), level);
+            data[id].resize(zsize);
+
+            uint8_t desc[4] = {(uint8_t)id, c.width, c.encoding, 0};
+            uint32_t sizes[4] = {(uint32_t)n, (uint32_t)c.dict.size(), (uint32_t)raw.size(), (uint32_t)zsize};
+            fwrite(desc, 1, 4, f);
+            fwrite(sizes, 4, 4, f);
+            bytes_raw += raw.size();
+        }
+        for (int id = 0; id < RVFILOG_NUM_COLUMNS; id++) {
+            fwrite(data[id].data(), 1, data[id].size(), f);
+            cols[id].values.clear();
+            cols[id].dict.clear();
+        }
+        dict_index.clear();
+        count = 0;
+        chunks++;
+    }
+
+    void put(int id, uint64_t v) {
+        cols[id].values.push_back(v);
+    }
+
+public:
+    uint64_t records, chunks, bytes_raw;
+
+    RvfiLogWriter() : f(NULL), level(Z_DEFAULT_COMPRESSION), count(0), records(0), chunks(0), bytes_raw(0) {
+        static const uint8_t layout[RVFILOG_NUM_COLUMNS][2] = {
+            {8, RVFILOG_DELTA}, {8, RVFILOG_DELTA}, {4, RVFILOG_DELTA}, {4, RVFILOG_RAW},
+            {2, RVFILOG_DICT}, {1, RVFILOG_RAW}, {1, RVFILOG_RAW}, {1, RVFILOG_RAW},
+            {4, RVFILOG_RAW}, {4, RVFILOG_RAW}, {4, RVFILOG_RAW}, {1, RVFILOG_RAW},
+            {4, RVFILOG_DELTA}, {4, RVFILOG_RAW}, {4, RVFILOG_RAW}, {1, RVFILOG_RAW}
+        };
+        for (int id = 0; id < RVFILOG_NUM_COLUMNS; id++) {
+            cols[id].width = layout[id][0];
+            cols[id].encoding = layout[id][1];
+            cols[id].values.reserve(RVFILOG_CHUNK);
+        }
+    }
+
+    ~RvfiLogWriter() { close(); }
+
+    // level: zlib compression level (1 fastest .. 9 smallest)
+    bool open(const char* filename, int level = Z_DEFAULT_COMPRESSION) {
+        this->level = level;
+        f = fopen(filename, "wb");
+        if (!f)
+            return false;
+        setvbuf(f, NULL, _IOFBF, 1 << 20);
+        fwrite(rvfilog_magic, 1, sizeof(rvfilog_magic), f);
+        return true;
+    }
+
+    void write(const RvfiLogRecord& r) {
+        put(RVFILOG_ORDER, r.order);
+        put(RVFILOG_CYCLE, r.cycle);
+        put(RVFILOG_PC, r.pc_rdata);
+        put(RVFILOG_PC_STEP, (uint32_t)(r.pc_wdata - r.pc_rdata));
+        auto it = dict_index.find(r.insn);
+        if (it == dict_index.end()) {
+            it = dict_index.emplace(r.insn, (uint16_t)cols[RVFILOG_INSN].dict.size()).first;
+            cols[RVFILOG_INSN].dict.push_back(r.insn);
+        }
+        put(RVFILOG_INSN, it->second);
+        put(RVFILOG_RS1_ADDR, r.rs1_addr);
+        put(RVFILOG_RS2_ADDR, r.rs2_addr);
+        put(RVFILOG_RD_ADDR, r.rd_addr);
+        put(RVFILOG_RS1_RDATA, r.rs1_rdata);
+        put(RVFILOG_RS2_RDATA, r.rs2_rdata);
+        put(RVFILOG_RD_WDATA, r.rd_wdata);
+        put(RVFILOG_MEM_MASK, (r.mem_rmask & 15) | (r.mem_wmask & 15) << 4);
+        if (r.mem_rmask || r.mem_wmask)
+            put(RVFILOG_MEM_ADDR, r.mem_addr);
+        if (r.mem_rmask)
+            put(RVFILOG_MEM_RDATA, r.mem_rdata);
+        if (r.mem_wmask)
+            put(RVFILOG_MEM_WDATA, r.mem_wdata);
+        put(RVFILOG_FLAGS, r.trap | r.intr << 1);
+        records++;
+        if (++count == RVFILOG_CHUNK)
+            flush();
+    }
+
+    void close() {
+        if (f) {
+            flush();
+            fclose(f);
+        }
+        f = NULL;
+    }
+};
+
+class RvfiLogReader {
+private:
+    FILE* f;
+    uint32_t columns;
+    std::vector<uint8_t> zbuf, raw;
+    std::vector<RvfiLogRecord> chunk;
+    size_t pos;
+
+    // Undo the byte planes and the delta encoding of one column
+    static void decode(const uint8_t* p, size_t n, int width, int encoding, std::vector<uint64_t>* out) {
+        out->resize(n);
+        uint64_t prev = 0;
+        for (size_t i = 0; i < n; i++) {
+            uint64_t v = 0;
+            for (int b = 0; b < width; b++)
+                v |= (uint64_t)p[b * n + i] << (8 * b);
+            if (encoding == RVFILOG_DELTA) {
+                v += prev;
+                if (width < 8)
+                    v &= (1ull << (8 * width)) - 1;
+                prev = v;
+            }
+            (*out)[i] = v;
+        }
+    }
+
+public:
+    const char* error;
+
+    RvfiLogReader() : f(NULL), columns(RVFILOG_ALL), pos(0), error(NULL) {}
+
+    ~RvfiLogReader() {
+        if (f)
+            fclose(f);
+    }
+
+    // columns: bit mask of the RvfiLogColumn values to decode, the fields
+    // of all other columns are left 0
+    bool open(const char* filename, uint32_t columns = RVFILOG_ALL) {
+        char magic[8];
+        this->columns = columns;
+        if (columns & (1u << RVFILOG_PC_STEP))
+            this->columns |= 1u << RVFILOG_PC;
+        if (columns & (7u << RVFILOG_MEM_ADDR))
+            this->columns |= 1u << RVFILOG_MEM_MASK;
+        f = fopen(filename, "rb");
+        if (!f)
+            return false;
+        setvbuf(f, NULL, _IOFBF, 1 << 20);
+        return fread(magic, 1, sizeof(magic), f) == sizeof(magic) && !memcmp(magic, rvfilog_magic, sizeof(magic));
+    }
+
+    // Decode the next chunk; returns false at the end of the file or on a
+    // corrupt chunk (error is set then)
+    bool next_chunk(std::vector<RvfiLogRecord>* out) {
+        uint32_t hdr[2];
+        if (fread(hdr, 4, 2, f) != 2)
+            return false;
+        uint32_t n = hdr[0], ncols = hdr[1];
+        struct Desc { uint8_t id, width, encoding, pad; uint32_t count, dict, raw, zsize; };
+        std::vector<Desc> descs(ncols);
+        for (auto& d : descs)
+            if (fread(&d.id, 1, 4, f) != 4 || fread(&d.count, 4, 4, f) != 4) {
+                error = "truncated chunk header";
+                return false;
+            }
+
+        out->assign(n, RvfiLogRecord());
+        std::vector<uint64_t> values[RVFILOG_NUM_COLUMNS];
+        std::vector<uint32_t> dict;
+        for (auto& d : descs) {
+            if (d.id >= RVFILOG_NUM_COLUMNS || !(columns & (1u << d.id))) {
+                fseek(f, d.zsize, SEEK_CUR);
+                continue;
+            }
+            zbuf.resize(d.zsize);
+            raw.resize(d.raw);
+            uLongf size = d.raw;
+            if (fread(zbuf.data(), 1, d.zsize, f) != d.zsize ||
+                    uncompress(raw.data(), &size, zbuf.data(), d.zsize) != Z_OK || size != d.raw ||
+                    d.raw != 4ull * d.dict + (uint64_t)d.count * d.width) {
+                error = "corrupt column";
+                return false;
+            }
+            if (d.id == RVFILOG_INSN) {
+                dict.resize(d.dict);
+                memcpy(dict.data(), raw.data(), 4 * d.dict);
+            }
+            decode(raw.data() + 4 * d.dict, d.count, d.width, d.encoding, &values[d.id]);
+        }
+
+        size_t mem_i = 0, rd_i = 0, wr_i = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            RvfiLogRecord& r = (*out)[i];
+            #define RVFILOG_GET(id, dflt) (i < values[id].size() ? values[id][i] : (dflt))
+            r.order = RVFILOG_GET(RVFILOG_ORDER, 0);
+            r.cycle = RVFILOG_GET(RVFILOG_CYCLE, 0);
+            r.pc_rdata = RVFILOG_GET(RVFILOG_PC, 0);
+            r.pc_wdata = r.pc_rdata + (uint32_t)RVFILOG_GET(RVFILOG_PC_STEP, 0);
+            uint64_t index = RVFILOG_GET(RVFILOG_INSN, 0);
+            r.insn = index < dict.size() ? dict[index] : 0;
+            r.rs1_addr = RVFILOG_GET(RVFILOG_RS1_ADDR, 0);
+            r.rs2_addr = RVFILOG_GET(RVFILOG_RS2_ADDR, 0);
+            r.rd_addr = RVFILOG_GET(RVFILOG_RD_ADDR, 0);
+            r.rs1_rdata = RVFILOG_GET(RVFILOG_RS1_RDATA, 0);
+            r.rs2_rdata = RVFILOG_GET(RVFILOG_RS2_RDATA, 0);
+            r.rd_wdata = RVFILOG_GET(RVFILOG_RD_WDATA, 0);
+            uint8_t mask = RVFILOG_GET(RVFILOG_MEM_MASK, 0);
+            r.mem_rmask = mask & 15;
+            r.mem_wmask = mask >> 4;
+            if (mask) {
+                r.mem_addr = mem_i < values[RVFILOG_MEM_ADDR].size() ? values[RVFILOG_MEM_ADDR][mem_i] : 0;
+                mem_i++;
+            }
+            if (r.mem_rmask) {
+                r.mem_rdata = rd_i < values[RVFILOG_MEM_RDATA].size() ? values[RVFILOG_MEM_RDATA][rd_i] : 0;
+                rd_i++;
+            }
+            if (r.mem_wmask) {
+                r.mem_wdata = wr_i < values[RVFILOG_MEM_WDATA].size() ? values[RVFILOG_MEM_WDATA][wr_i] : 0;
+                wr_i++;
+            }
+            uint8_t flags = RVFILOG_GET(RVFILOG_FLAGS, 0);
+            r.trap = flags & 1;
+            r.intr = flags & 2;
+            #undef RVFILOG_GET
+        }
+        return true;
+    }
+
+    // Record at a time; returns false at the end of the file
+    bool next(RvfiLogRecord* r) {
+        while (pos == chunk.size()) {
+            pos = 0;
+            if (!next_chunk(&chunk))
+                return false;
+        }
+        *r = chunk[pos++];
+        return true;
+    }
+};
+
+#endif
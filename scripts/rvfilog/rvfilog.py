@@ -0,0 +1,147 @@
+#!/usr/bin/env python3
+#
+# Reader for RVFI logs written by testbench_cli --rvfi-log. The file format
+# is described in rvfilog.h. Columns are returned as numpy arrays when numpy
+# is installed, and as lists otherwise.
+#
+#   from rvfilog import RvfiLog
+#   for chunk in RvfiLog("firmware.rvf").chunks(["insn", "rd_wdata"]):
+#       ...  # chunk["insn"], chunk["rd_wdata"]: one value per record
+#
+# Usage: rvfilog.py dump FILE
+#        rvfilog.py hist COLUMN FILE [-n N]
+#
+
+import argparse, collections, struct, sys, zlib
+
+try:
+    import numpy as np
+except ImportError:
+    np = None
+
+MAGIC = b"PRVRVF01"
+COLUMNS = ["order", "cycle", "pc", "pc_step", "insn", "rs1_addr", "rs2_addr", "rd_addr",
+           "rs1_rdata", "rs2_rdata", "rd_wdata", "mem_mask", "mem_addr", "mem_rdata", "mem_wdata", "flags"]
+SPARSE = {"mem_addr": 0xff, "mem_rdata": 0x0f, "mem_wdata": 0xf0}
+RAW, DELTA, DICT = 0, 1, 2
+
+def _decode(raw, ndict, count, width, encoding):
+    dictionary = struct.unpack_from("<%dI" % ndict, raw) if ndict else ()
+    off = 4 * ndict
+    if np is not None:
+        planes = np.frombuffer(raw, np.uint8, count * width, off).reshape(width, count)
+        values = planes.T.copy().view("<u%d" % width).ravel()
+        if encoding == DELTA:
+            values = np.cumsum(values, dtype=values.dtype)
+        if encoding == DICT:
+            values = np.asarray(dictionary, np.uint32)[values]
+        return values
+    values = [0] * count
+    for b in range(width):
+        plane = raw[off + b * count:off + (b + 1) * count]
+        for i in range(count):
+            values[i] |= plane[i] << (8 * b)
+    if encoding == DELTA:
+        mask, acc = (1 << (8 * width)) - 1, 0
+        for i in range(count):
+            acc = (acc + values[i]) & mask
+            values[i] = acc
+    if encoding == DICT:
+        values = [dictionary[v] for v in values]
+    return values
+
+class RvfiLog:
+    def __init__(self, filename):
+        self.filename = filename
+
+    def chunks(self, columns=None):
+        """Yield one dict per chunk that maps every requested column name to
+        its values. The sparse columns (mem_addr, mem_rdata, mem_wdata) only
+        have values for the records that access memory (see mem_mask)."""
+        wanted = set(COLUMNS if columns is None else columns)
+        for c in wanted:
+            if c not in COLUMNS:
+                raise ValueError("unknown column '%s'" % c)
+        with open(self.filename, "rb") as f:
+            if f.read(8) != MAGIC:
+                raise ValueError("%s: not an RVFI log" % self.filename)
+            while True:
+                hdr = f.read(8)
+                if len(hdr) < 8:
+                    return
+                nrec, ncols = struct.unpack("<II", hdr)
+                descs = [struct.unpack("<BBBxIIII", f.read(20)) for _ in range(ncols)]
+                chunk = {"records": nrec}
+                for cid, width, encoding, count, ndict, rawsize, zsize in descs:
+                    name = COLUMNS[cid] if cid < len(COLUMNS) else None
+                    if name not in wanted:
+                        f.seek(zsize, 1)
+                        continue
+                    raw = zlib.decompress(f.read(zsize))
+                    if len(raw) != rawsize or rawsize != 4 * ndict + count * width:
+                        raise ValueError("%s: corrupt column %s" % (self.filename, name))
+                    chunk[name] = _decode(raw, ndict, count, width, encoding)
+                yield chunk
+
+    def records(self):
+        """Yield one dict per record with the fields of the C++ RvfiLogRecord.
+        This is the slow path; use chunks() for queries over large logs."""
+        for chunk in self.chunks():
+            mem = {name: iter(chunk[name]) for name in SPARSE}
+            for i in range(chunk["records"]):
+                mask = int(chunk["mem_mask"][i])
+                pc = int(chunk["pc"][i])
+                r = {"order": int(chunk["order"][i]), "cycle": int(chunk["cycle"][i]),
+                     "pc_rdata": pc, "pc_wdata": (pc + int(chunk["pc_step"][i])) & 0xffffffff,
+                     "insn": int(chunk["insn"][i])}
+                for name in ("rs1_addr", "rs2_addr", "rd_addr", "rs1_rdata", "rs2_rdata", "rd_wdata"):
+                    r[name] = int(chunk[name][i])
+                r["mem_rmask"] = mask & 15
+                r["mem_wmask"] = mask >> 4
+                for name, bits in SPARSE.items():
+                    r[name] = int(next(mem[name])) if mask & bits else 0
+                flags = int(chunk["flags"][i])
+                r["trap"] = bool(flags & 1)
+                r["intr"] = bool(flags & 2)
+                yield r
+
+def main():
+    parser = argparse.ArgumentParser(description="Read RVFI logs written by testbench_cli --rvfi-log")
+    sub = parser.add_subparsers(dest="cmd")
+    p = sub.add_parser("dump", help="one line per record, same format as --commit-log")
+    p.add_argument("file")
+    p = sub.add_parser("hist", help="most frequent values of a column")
+    p.add_argument("column", choices=COLUMNS)
+    p.add_argument("file")
+    p.add_argument("-n", type=int, default=20, help="number of values (default: 20)")
+    args = parser.parse_args()
+
+    log = RvfiLog(args.file) if args.cmd else None
+    if args.cmd == "dump":
+        out = sys.stdout
+        for r in log.records():
+            out.write("%d %d %08x %08x x%d:%08x x%d:%08x x%d:%08x %08x %x %x %08x %08x %08x %s%s\n" % (
+                r["order"], r["cycle"], r["pc_rdata"], r["insn"], r["rs1_addr"], r["rs1_rdata"],
+                r["rs2_addr"], r["rs2_rdata"], r["rd_addr"], r["rd_wdata"], r["mem_addr"],
+                r["mem_rmask"], r["mem_wmask"], r["mem_rdata"], r["mem_wdata"], r["pc_wdata"],
+                "I" if r["intr"] else "-", "T" if r["trap"] else "-"))
+    elif args.cmd == "hist":
+        counts = collections.Counter()
+        total = 0
+        for chunk in log.chunks([args.column]):
+            values = chunk[args.column]
+            if np is not None:
+                keys, n = np.unique(values, return_counts=True)
+                counts.update(dict(zip(keys.tolist(), n.tolist())))
+            else:
+                counts.update(values)
+            total += len(values)
+        for value, n in counts.most_common(args.n):
+            print("%016x %12d %6.2f%%" % (value, n, 100.0 * n / total))
+        print("%-16s %12d" % ("total", total))
+    else:
+        parser.print_help()
+        sys.exit(1)
+
+if __name__ == "__main__":
+    main()
@@ -11,21 +11,23 @@ fi
 rm -rf tests testgen/
 tar xvzf testgen.tgz
 
-iverilog -o testbench_a -s testbench testbench.v ../../picorv32.v -DTWO_STAGE_SHIFT=0 -DBARREL_SHIFTER=0 -DTWO_CYCLE_COMPARE=0 -DTWO_CYCLE_ALU=0
-iverilog -o testbench_b -s testbench testbench.v ../../picorv32.v -DTWO_STAGE_SHIFT=1 -DBARREL_SHIFTER=0 -DTWO_CYCLE_COMPARE=0 -DTWO_CYCLE_ALU=0
-iverilog -o testbench_c -s testbench testbench.v ../../picorv32.v -DTWO_STAGE_SHIFT=0 -DBARREL_SHIFTER=1 -DTWO_CYCLE_COMPARE=0 -DTWO_CYCLE_ALU=0
-
-iverilog -o testbench_d -s testbench testbench.v ../../picorv32.v -DTWO_STAGE_SHIFT=0 -DBARREL_SHIFTER=0 -DTWO_CYCLE_COMPARE=1 -DTWO_CYCLE_ALU=0
-iverilog -o testbench_e -s testbench testbench.v ../../picorv32.v -DTWO_STAGE_SHIFT=1 -DBARREL_SHIFTER=0 -DTWO_CYCLE_COMPARE=1 -DTWO_CYCLE_ALU=0
-iverilog -o testbench_f -s testbench testbench.v ../../picorv32.v -DTWO_STAGE_SHIFT=0 -DBARREL_SHIFTER=1 -DTWO_CYCLE_COMPARE=1 -DTWO_CYCLE_ALU=0
-
-iverilog -o testbench_g -s testbench testbench.v ../../picorv32.v -DTWO_STAGE_SHIFT=0 -DBARREL_SHIFTER=0 -DTWO_CYCLE_COMPARE=0 -DTWO_CYCLE_ALU=1
-iverilog -o testbench_h -s testbench testbench.v ../../picorv32.v -DTWO_STAGE_SHIFT=1 -DBARREL_SHIFTER=0 -DTWO_CYCLE_COMPARE=0 -DTWO_CYCLE_ALU=1
-iverilog -o testbench_i -s testbench testbench.v ../../picorv32.v -DTWO_STAGE_SHIFT=0 -DBARREL_SHIFTER=1 -DTWO_CYCLE_COMPARE=0 -DTWO_CYCLE_ALU=1
-
-iverilog -o testbench_j -s testbench testbench.v ../../picorv32.v -DTWO_STAGE_SHIFT=0 -DBARREL_SHIFTER=0 -DTWO_CYCLE_COMPARE=1 -DTWO_CYCLE_ALU=1
-iverilog -o testbench_k -s testbench testbench.v ../../picorv32.v -DTWO_STAGE_SHIFT=1 -DBARREL_SHIFTER=0 -DTWO_CYCLE_COMPARE=1 -DTWO_CYCLE_ALU=1
-iverilog -o testbench_l -s testbench testbench.v ../../picorv32.v -DTWO_STAGE_SHIFT=0 -DBARREL_SHIFTER=1 -DTWO_CYCLE_COMPARE=1 -DTWO_CYCLE_ALU=1
+# One testbench for all configurations, the core parameters are plusargs
+iverilog -o testbench -s testbench -DPICORV32_RUNTIME_CONFIG testbench.v ../../picorv32.v
+
+configs=(
+	"+TWO_STAGE_SHIFT=0 +BARREL_SHIFTER=0 +TWO_CYCLE_COMPARE=0 +TWO_CYCLE_ALU=0"
+	"+TWO_STAGE_SHIFT=1 +BARREL_SHIFTER=0 +TWO_CYCLE_COMPARE=0 +TWO_CYCLE_ALU=0"
+	"+TWO_STAGE_SHIFT=0 +BARREL_SHIFTER=1 +TWO_CYCLE_COMPARE=0 +TWO_CYCLE_ALU=0"
+	"+TWO_STAGE_SHIFT=0 +BARREL_SHIFTER=0 +TWO_CYCLE_COMPARE=1 +TWO_CYCLE_ALU=0"
+	"+TWO_STAGE_SHIFT=1 +BARREL_SHIFTER=0 +TWO_CYCLE_COMPARE=1 +TWO_CYCLE_ALU=0"
+	"+TWO_STAGE_SHIFT=0 +BARREL_SHIFTER=1 +TWO_CYCLE_COMPARE=1 +TWO_CYCLE_ALU=0"
+	"+TWO_STAGE_SHIFT=0 +BARREL_SHIFTER=0 +TWO_CYCLE_COMPARE=0 +TWO_CYCLE_ALU=1"
+	"+TWO_STAGE_SHIFT=1 +BARREL_SHIFTER=0 +TWO_CYCLE_COMPARE=0 +TWO_CYCLE_ALU=1"
+	"+TWO_STAGE_SHIFT=0 +BARREL_SHIFTER=1 +TWO_CYCLE_COMPARE=0 +TWO_CYCLE_ALU=1"
+	"+TWO_STAGE_SHIFT=0 +BARREL_SHIFTER=0 +TWO_CYCLE_COMPARE=1 +TWO_CYCLE_ALU=1"
+	"+TWO_STAGE_SHIFT=1 +BARREL_SHIFTER=0 +TWO_CYCLE_COMPARE=1 +TWO_CYCLE_ALU=1"
+	"+TWO_STAGE_SHIFT=0 +BARREL_SHIFTER=1 +TWO_CYCLE_COMPARE=1 +TWO_CYCLE_ALU=1"
+)
 
 mkdir -p tests
 for i in {0..999}; do
@@ -39,5 +41,5 @@ for i in {0..999}; do
 	riscv32-unknown-elf-gcc -ffreestanding -nostdlib -Wl,-Bstatic,-T,sections.lds -o $fn.elf $fn.s
 	riscv32-unknown-elf-objcopy -O binary $fn.elf $fn.bin
 	python3 ../../firmware/makehex.py $fn.bin 16384 > $fn.hex
-	for tb in testbench_{a,b,c,d,e,f,g,h,i,j,k,l}; do vvp -N $tb +hex=$fn.hex; done
+	for cfg in "${configs[@]}"; do vvp -N testbench $cfg +hex=$fn.hex; done
 done
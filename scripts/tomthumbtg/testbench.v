@@ -20,12 +20,17 @@ module testbench;
 	wire [3:0] mem_wstrb;
 	reg  [31:0] mem_rdata;
 
+`ifdef PICORV32_RUNTIME_CONFIG
+	// configuration from plusargs (+TWO_STAGE_SHIFT=0 ...), see run.sh
+	picorv32 uut (
+`else
 	picorv32 #(
 		.TWO_STAGE_SHIFT(`TWO_STAGE_SHIFT),
 		.BARREL_SHIFTER(`BARREL_SHIFTER),
 		.TWO_CYCLE_COMPARE(`TWO_CYCLE_COMPARE),
 		.TWO_CYCLE_ALU(`TWO_CYCLE_ALU)
 	) uut (
+`endif
 		.clk         (clk        ),
 		.resetn      (resetn     ),
 		.trap        (trap       ),
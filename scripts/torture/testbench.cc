@@ -1,11 +1,24 @@
 #include "Vtestbench.h"
+#include "Vtestbench_testbench.h"
 #include "verilated.h"
+#include "../../testbench_loader.h"
 
 int main(int argc, char **argv, char **env)
 {
 	Verilated::commandArgs(argc, argv);
 	Vtestbench* top = new Vtestbench;
 
+	// Test program (+bin=FILE, raw binary or ELF), loaded directly into the
+	// memory array (testbench.v is built with -DNO_READMEMH)
+	const char* flag_bin = Verilated::commandArgsPlusMatch("bin=");
+	if (flag_bin && 0==strncmp(flag_bin, "+bin=", 5)) {
+		ElfLoader loader;
+		if (!loader.load_image(flag_bin + 5, top->testbench->memory.data(), 4096*4)) {
+			delete top;
+			exit(1);
+		}
+	}
+
 	top->clk = 0;
 	while (!Verilated::gotFinish()) {
 		top->clk = !top->clk;
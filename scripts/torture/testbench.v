@@ -37,9 +37,14 @@ module testbench (
 		end
 	end
 
+`ifdef PICORV32_RUNTIME_CONFIG
+	// parameters from plusargs, see Makefile
+	picorv32 uut (
+`else
 	picorv32 #(
 `include "config.vh"
 	) uut (
+`endif
 		.clk         (clk         ),
 		.resetn      (resetn      ),
 		.trap        (trap        ),
@@ -63,13 +68,15 @@ module testbench (
 	reg [8*filename_len-1:0] hex_filename;
 	reg [8*filename_len-1:0] ref_filename;
 
-	reg [31:0] memory [0:4095];
+	reg [31:0] memory [0:4095] /* verilator public */;
 	reg [31:0] memory_ref [0:4095];
 	integer i, errcount;
 	integer cycle = 0;
 
 	initial begin
+`ifndef NO_READMEMH
 		if ($value$plusargs("hex=%s", hex_filename)) $readmemh(hex_filename, memory);
+`endif
 		if ($value$plusargs("ref=%s", ref_filename)) $readmemh(ref_filename, memory_ref);
 `ifndef VERILATOR
 		if ($test$plusargs("vcd")) begin
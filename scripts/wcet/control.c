@@ -0,0 +1,92 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+
+// Example firmware for wcet.py: a PI controller on the output of an FIR
+// filter over the samples taken by the IRQ handler. control_step() is the
+// task of the control loop, irq_vec (start.S) the IRQ handler.
+
+#include <stdint.h>
+#include "wcet.h"
+
+#define OUTPORT 0x10000000
+#define NTAPS 16
+#define NPERIODS 8
+
+void isr(uint32_t irqs);
+void control_step(int32_t setpoint);
+int main(void);
+
+static const int16_t coeffs[NTAPS] = {
+	3, 9, 19, 33, 50, 66, 79, 87, 87, 79, 66, 50, 33, 19, 9, 3
+};
+
+static volatile uint32_t ticks;
+static int32_t samples[NTAPS];
+static uint32_t sample_pos;
+static int32_t integral, output;
+
+// IRQ 4 of testbench.v: take a new sample of the plant
+void isr(uint32_t irqs)
+{
+	if (irqs & (1 << 4)) {
+		samples[sample_pos] = output / 4 + (int32_t)(ticks & 63);
+		sample_pos = (sample_pos + 1) % NTAPS;
+		ticks++;
+	}
+}
+
+void control_step(int32_t setpoint)
+{
+	int32_t acc = 0;
+	for (int i = 0; i < NTAPS; i++) {
+		WCET_LOOP_BOUND(NTAPS);
+		acc += samples[(sample_pos + i) % NTAPS] * coeffs[i];
+	}
+
+	int32_t error = setpoint - (acc >> 10);
+	integral += error;
+	if (integral > 4096)
+		integral = 4096;
+	if (integral < -4096)
+		integral = -4096;
+	output = (error * 3 + integral / 5) >> 1;
+}
+
+static void print_dec(int32_t v)
+{
+	char buffer[12], *p = buffer;
+	if (v < 0) {
+		*(volatile uint32_t*)OUTPORT = '-';
+		v = -v;
+	}
+	do {
+		*p++ = '0' + v % 10;
+		v /= 10;
+	} while (v);
+	while (p != buffer)
+		*(volatile uint32_t*)OUTPORT = *--p;
+}
+
+int main(void)
+{
+	ticks = 0;
+	sample_pos = 0;
+	integral = output = 0;
+	for (int i = 0; i < NTAPS; i++)
+		samples[i] = 0;
+
+	for (int k = 0; k < NPERIODS; k++) {
+		uint32_t t = ticks;
+		while (ticks == t)
+			;
+		control_step(1000);
+	}
+
+	print_dec(output);
+	*(volatile uint32_t*)OUTPORT = '\n';
+	return 0;
+}
@@ -0,0 +1,26 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+
+#ifndef WCET_H
+#define WCET_H
+
+// Loop bound annotation for scripts/wcet/wcet.py. Place it in the body of a
+// loop that runs at most n iterations per entry (n must be a constant):
+//
+//     for (int i = 0; i < NTAPS; i++) {
+//         WCET_LOOP_BOUND(NTAPS);
+//         ...
+//     }
+//
+// Records the address of the annotation and n in the section .wcet_bounds,
+// which is not loaded into memory (keep it out of the memory region in the
+// linker script, see sections.lds). No instructions are generated.
+#define WCET_LOOP_BOUND(n) \
+	__asm__ volatile ("1:\n\t.pushsection .wcet_bounds, \"\", @progbits\n\t" \
+			".word 1b, %0\n\t.popsection" : : "i"(n))
+
+#endif
@@ -0,0 +1,799 @@
+#!/usr/bin/env python3
+#
+# Static worst-case execution time (WCET) analysis of picorv32 firmware.
+#
+# Usage: wcet.py [--config=SPEC] [--bounds=FILE] [--irq=LOC] [--check=LOG] [-v] ELF [LOC ...]
+#
+# Every LOC (a symbol, symbol+offset or address) is analyzed as a task: the
+# code reachable from LOC up to its return. --irq=LOC is the IRQ handler
+# (PROGADDR_IRQ, usually irq_vec in start.S): it ends at retirq and its bound
+# includes the IRQ entry of the core.
+#
+# The ELF is decoded directly (no toolchain needed). Each function becomes a
+# control flow graph of basic blocks. Loops are the natural loops of the CFG
+# and need a bound N: the maximum number of iterations per entry into the
+# loop. Bounds come from WCET_LOOP_BOUND() annotations in the source (wcet.h,
+# section .wcet_bounds) or from a --bounds file. Calls are analyzed
+# recursively; recursion and unresolved indirect jumps are errors.
+#
+# A loop costs N * (longest path from the header back to the header) plus
+# the longest path from the header to each exit, with inner loops collapsed
+# into single nodes first. For loops that GCC tests at the bottom this counts
+# one iteration too many, which keeps the bound safe for both loop shapes.
+# Instruction costs are the worst case of the per-instruction model of
+# scripts/whatif/whatif.cc for the given configuration (SPEC, same syntax).
+#
+# --check=LOG compares the model with a commit log of testbench_cli
+# (--commit-log=LOG) of the same ELF: cycles of every instruction kind, and
+# the measured duration of every call of the tasks and of every IRQ against
+# their bounds (cycles spent in IRQ handlers are not counted for tasks).
+
+import argparse, re, struct, sys
+
+# --- configuration and cost model, see scripts/whatif/whatif.cc ------------
+
+class Config:
+    def __init__(self, spec=""):
+        self.barrel_shifter = False
+        self.two_stage_shift = True
+        self.two_cycle_alu = False
+        self.two_cycle_compare = False
+        self.enable_fast_mul = False
+        self.enable_regs_dualport = True
+        self.wait = 0
+        for item in spec.split(","):
+            if not item:
+                continue
+            name, _, value = item.partition("=")
+            v = int(value or "1", 0)
+            if name == "enable_mul":
+                self.enable_fast_mul = not v
+            elif name == "wait":
+                self.wait = v
+            elif name in ("barrel_shifter", "two_stage_shift", "two_cycle_alu", "two_cycle_compare",
+                          "enable_fast_mul", "enable_regs_dualport"):
+                setattr(self, name, bool(v))
+            else:
+                raise ValueError("unknown configuration option '%s'" % name)
+
+ALU_IMM, ALU_REG, BRANCH, JALR, LOAD, STORE, SHIFT_IMM, SHIFT_REG, MUL, MULH, DIV, BITMANIP, CLMUL, \
+    SIMPLE, FIXED = range(15)
+KIND_NAMES = ["alu_imm", "alu_reg", "branch", "jalr", "load", "store", "shift_imm", "shift_reg",
+              "mul", "mulh", "div", "bitmanip", "clmul", "simple", "fixed"]
+
+# Worst-case cycles of one instruction. Register shifts assume a shift
+# amount of 31, taken only applies to branches. retirq is a jump without
+# prefetch like jalr and is costed as one.
+def cost(insn, c, taken=False):
+    sp = 0 if c.enable_regs_dualport else 1
+    alu = int(c.two_cycle_alu)
+    cmp = int(c.two_cycle_compare)
+    w = c.wait
+    k = insn.kind
+    if k == ALU_IMM:
+        return 3 + alu + w
+    if k == ALU_REG:
+        return 3 + sp + alu + w
+    if k == BRANCH:
+        return 3 + sp + alu + cmp + w + (2 + w if taken else 0)
+    if k == JALR:
+        return 6 + alu + 2 * w
+    if k == LOAD:
+        return 5 + 2 * w
+    if k == STORE:
+        return 5 + sp + 2 * w
+    if k in (SHIFT_IMM, SHIFT_REG):
+        reg = sp if k == SHIFT_REG else 0
+        if c.barrel_shifter:
+            return 3 + reg + alu + w
+        shamt = insn.shamt if k == SHIFT_IMM else 31
+        return 4 + reg + w + (shamt // 4 + shamt % 4 if c.two_stage_shift else shamt)
+    if k == MUL:
+        return (6 if c.enable_fast_mul else 40) + sp + w
+    if k == MULH:
+        return (6 if c.enable_fast_mul else 72) + sp + w
+    if k == DIV:
+        return 40 + sp + w
+    if k == BITMANIP:
+        return 5 + sp + w
+    if k == CLMUL:
+        return 13 + sp + w
+    if k == SIMPLE:
+        return 3 + w
+    return 0
+
+def irq_entry_cost(c):
+    return 3 + c.wait
+
+# --- ELF reader --------------------------------------------------------------
+
+class Elf:
+    def __init__(self, filename):
+        with open(filename, "rb") as f:
+            self.data = data = f.read()
+        if data[:4] != b"\x7fELF" or data[4] != 1 or data[5] != 1:
+            raise ValueError("%s: not a little endian ELF32 file" % filename)
+        shoff, = struct.unpack_from("<I", data, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from("<HHH", data, 0x2e)
+        self.sections = []
+        for i in range(shnum):
+            name, type, flags, addr, offset, size, link = struct.unpack_from("<IIIIIII", data, shoff + i * shentsize)
+            self.sections.append([name, type, flags, addr, offset, size, link])
+        strtab = self.sections[shstrndx]
+        for s in self.sections:
+            s[0] = self.string(strtab[4], s[0])
+
+        # code and data that ends up in memory (SHF_ALLOC, not NOBITS)
+        self.segments = [(s[3], s[4], s[5]) for s in self.sections if s[2] & 2 and s[1] != 8]
+
+        self.symbols = dict()
+        self.functions = set()
+        for s in self.sections:
+            if s[1] != 2:  # SHT_SYMTAB
+                continue
+            strs = self.sections[s[6]][4]
+            for off in range(s[4], s[4] + s[5], 16):
+                name, value, size, info = struct.unpack_from("<IIIB", data, off)
+                name = self.string(strs, name)
+                if name and not name.startswith("$") and (info & 15) in (0, 1, 2):
+                    if name not in self.symbols or info >> 4:
+                        self.symbols[name] = value
+                    if (info & 15) == 2:
+                        self.functions.add(value)
+        self.names = sorted((v, n) for n, v in self.symbols.items())
+
+    def string(self, offset, index):
+        end = self.data.index(b"\0", offset + index)
+        return self.data[offset + index:end].decode()
+
+    def section(self, name):
+        for s in self.sections:
+            if s[0] == name:
+                return self.data[s[4]:s[4] + s[5]]
+        return None
+
+    def read16(self, addr):
+        for base, offset, size in self.segments:
+            if base <= addr and addr + 2 <= base + size:
+                return struct.unpack_from("<H", self.data, offset + addr - base)[0]
+        return None
+
+    def locate(self, addr):
+        best = None
+        for v, n in self.names:
+            if v > addr:
+                break
+            best = (v, n)
+        if best is None:
+            return "0x%08x" % addr
+        return best[1] if best[0] == addr else "%s+0x%x" % (best[1], addr - best[0])
+
+    def resolve(self, loc):
+        m = re.fullmatch(r"([^+\s]+)(?:\+(\w+))?", loc)
+        if not m:
+            raise ValueError("invalid location '%s'" % loc)
+        try:
+            addr = int(m.group(1), 0)
+        except ValueError:
+            if m.group(1) not in self.symbols:
+                raise ValueError("unknown symbol '%s'" % m.group(1))
+            addr = self.symbols[m.group(1)]
+        return addr + (int(m.group(2), 0) if m.group(2) else 0)
+
+# --- instruction decoder -------------------------------------------------------
+
+# Instructions of picorv32_pcpi_bitmanip (ENABLE_BITMANIP), some of them in
+# the encoding space of the shifts: BITMANIP, CLMUL or None
+def bitmanip_kind(insn):
+    f3, f7, imm = (insn >> 12) & 7, insn >> 25, insn >> 20
+    if insn & 0x7f == 0x13:
+        if (f3 == 5 and (f7 == 0x30 or imm in (0x687, 0x698))) or (f3 in (1, 5) and imm == 0x08f):
+            return BITMANIP
+        return None
+    if f7 == 0x05:
+        return CLMUL if f3 in (1, 2, 3) else None
+    if (f7, f3) in ((0x20, 4), (0x20, 6), (0x20, 7), (0x30, 1), (0x30, 5), (0x04, 4), (0x04, 7),
+                    (0x14, 2), (0x14, 4)):
+        return BITMANIP
+    return None
+
+def sext(v, bits):
+    return v - (1 << bits) if v & (1 << (bits - 1)) else v
+
+class Insn:
+    # flow: None (next instruction), "branch", "jump", "call", "ret", "retirq",
+    # "icall", "ijump", "stop" (ecall/ebreak), "waitirq" or "illegal"
+    def __init__(self, addr, raw):
+        self.addr = addr
+        self.raw = raw
+        self.size = 4 if raw & 3 == 3 else 2
+        self.kind = FIXED
+        self.shamt = 0
+        self.flow = None
+        self.target = None
+        self.rd = self.rs1 = 0
+        self.auipc = None
+        if self.size == 2:
+            self.decode16(raw)
+        else:
+            self.decode32(raw)
+
+    def decode16(self, insn):
+        q, f3 = insn & 3, (insn >> 13) & 7
+        rd, rs2 = (insn >> 7) & 31, (insn >> 2) & 31
+        b12 = (insn >> 12) & 1
+        bit = lambda n: (insn >> n) & 1
+        if q == 0:
+            self.kind = ALU_IMM if f3 == 0 else LOAD if f3 == 2 else STORE if f3 == 6 else FIXED
+            if insn == 0 or self.kind == FIXED:
+                self.flow = "illegal"
+        elif q == 1:
+            if f3 in (1, 5):
+                self.kind = ALU_IMM
+                self.flow = "call" if f3 == 1 else "jump"
+                self.rd = 1 if f3 == 1 else 0
+                self.target = self.addr + sext(bit(12) << 11 | bit(11) << 4 | bit(10) << 9 | bit(9) << 8 |
+                                               bit(8) << 10 | bit(7) << 6 | bit(6) << 7 | bit(5) << 3 |
+                                               bit(4) << 2 | bit(3) << 1 | bit(2) << 5, 12)
+            elif f3 in (6, 7):
+                self.kind = BRANCH
+                self.flow = "branch"
+                self.target = self.addr + sext(bit(12) << 8 | bit(11) << 4 | bit(10) << 3 | bit(6) << 7 |
+                                               bit(5) << 6 | bit(4) << 2 | bit(3) << 1 | bit(2) << 5, 9)
+            elif f3 == 4 and (insn >> 10) & 3 < 2:
+                self.kind = SHIFT_IMM
+                self.shamt = rs2 | b12 << 5
+            elif f3 == 4 and (insn >> 10) & 3 == 3:
+                self.kind = ALU_REG
+            else:
+                self.kind = ALU_IMM
+        elif q == 2:
+            if f3 == 0:
+                self.kind = SHIFT_IMM
+                self.shamt = rs2 | b12 << 5
+            elif f3 == 2:
+                self.kind = LOAD
+            elif f3 == 6:
+                self.kind = STORE
+            elif f3 == 4 and not rs2:
+                if not rd:
+                    self.kind = FIXED
+                    self.flow = "stop" if b12 else "illegal"
+                else:
+                    self.kind = JALR
+                    self.rs1 = rd
+                    self.rd = 1 if b12 else 0
+                    self.flow = "icall" if b12 else "ret" if rd == 1 else "ijump"
+            elif f3 == 4:
+                self.kind = ALU_REG if b12 else ALU_IMM
+            else:
+                self.flow = "illegal"
+
+    def decode32(self, insn):
+        f3, f7 = (insn >> 12) & 7, insn >> 25
+        self.rd, self.rs1 = (insn >> 7) & 31, (insn >> 15) & 31
+        op = insn & 0x7f
+        if op in (0x37, 0x17):
+            self.kind = ALU_IMM
+            if op == 0x17:
+                self.auipc = self.addr + sext(insn & 0xfffff000, 32)
+        elif op == 0x6f:
+            self.kind = ALU_IMM
+            self.flow = "call" if self.rd else "jump"
+            self.target = self.addr + sext((insn >> 31) << 20 | ((insn >> 21) & 0x3ff) << 1 |
+                                           ((insn >> 20) & 1) << 11 | ((insn >> 12) & 0xff) << 12, 21)
+        elif op == 0x67:
+            self.kind = JALR
+            self.target = sext(insn >> 20, 12)  # offset to rs1, see resolve_auipc()
+            self.flow = "icall" if self.rd else "ret" if self.rs1 == 1 and self.target == 0 else "ijump"
+        elif op == 0x63:
+            self.kind = BRANCH
+            self.flow = "branch"
+            self.target = self.addr + sext((insn >> 31) << 12 | ((insn >> 25) & 0x3f) << 5 |
+                                           ((insn >> 8) & 15) << 1 | ((insn >> 7) & 1) << 11, 13)
+        elif op == 0x03:
+            self.kind = LOAD
+        elif op == 0x23:
+            self.kind = STORE
+        elif op == 0x13:
+            if bitmanip_kind(insn) is not None:
+                self.kind = bitmanip_kind(insn)
+            elif f3 in (1, 5):
+                self.kind = SHIFT_IMM
+                self.shamt = (insn >> 20) & 31
+            else:
+                self.kind = ALU_IMM
+        elif op == 0x33:
+            if f7 == 1:
+                self.kind = MUL if f3 == 0 else MULH if f3 < 4 else DIV
+            elif bitmanip_kind(insn) is not None:
+                self.kind = bitmanip_kind(insn)
+            elif f3 in (1, 5) and f7 != 7:  # f7 == 7: czero.eqz/nez
+                self.kind = SHIFT_REG
+            else:
+                self.kind = ALU_REG
+        elif op == 0x0f:
+            self.kind = ALU_IMM  # fence, fence.i
+        elif op == 0x73:
+            if f3 == 2:
+                self.kind = SIMPLE  # rdcycle & co.
+            else:
+                self.flow = "stop" if insn in (0x00000073, 0x00100073) else "illegal"
+        elif op == 0x0b:
+            # picorv32 custom-0: getq, setq, retirq, maskirq, waitirq, timer
+            if f7 == 2:
+                self.kind = JALR
+                self.flow = "retirq"
+            elif f7 == 4:
+                self.flow = "waitirq"
+            else:
+                self.kind = SIMPLE
+        else:
+            self.flow = "illegal"
+
+# --- CFG and loop analysis -------------------------------------------------------
+
+EXIT = "exit"
+
+class AnalysisError(Exception):
+    pass
+
+class Block:
+    def __init__(self, addr):
+        self.addr = addr
+        self.insns = []
+        self.succs = []   # (target address or EXIT, cycles of the edge)
+
+class Analyzer:
+    def __init__(self, elf, config, bounds, targets, verbose):
+        self.elf = elf
+        self.config = config
+        self.bounds = bounds      # address -> N
+        self.targets = targets    # address of indirect jalr -> list of targets
+        self.verbose = verbose
+        self.wcet = dict()        # function address -> cycles
+        self.active = []
+        self.max_insn = 0         # longest single instruction seen (IRQ latency)
+        self.covered = set()      # addresses of all analyzed instructions
+        self.used_bounds = set()
+
+    def where(self, addr):
+        return "%s (0x%08x)" % (self.elf.locate(addr), addr)
+
+    def decode(self, addr):
+        lo = self.elf.read16(addr)
+        if lo is None:
+            raise AnalysisError("no code at %s" % self.where(addr))
+        raw = lo
+        if lo & 3 == 3:
+            hi = self.elf.read16(addr + 2)
+            if hi is None:
+                raise AnalysisError("no code at %s" % self.where(addr + 2))
+            raw |= hi << 16
+        return Insn(addr, raw)
+
+    def function(self, entry):
+        if entry in self.wcet:
+            return self.wcet[entry]
+        if entry in self.active:
+            raise AnalysisError("recursion: %s" % " -> ".join(self.elf.locate(a) for a in self.active + [entry]))
+        self.active.append(entry)
+        self.wcet[entry] = self.analyze(entry, irq=False)
+        self.active.pop()
+        return self.wcet[entry]
+
+    def call_cost(self, insn, target):
+        # call through a jal/jalr: the callee returns to the next instruction
+        return cost(insn, self.config) + self.function(target)
+
+    # Basic blocks reachable from entry. Calls are not followed (their cost
+    # is added to the edge), tail calls (jumps to another function) end the
+    # function.
+    def build_cfg(self, entry, irq):
+        leaders = {entry}
+        insns = dict()
+        work = [entry]
+        seen = set()
+        while work:
+            addr = work.pop()
+            while addr not in seen:
+                seen.add(addr)
+                insn = self.decode(addr)
+                insns[addr] = insn
+                self.covered.add(addr)
+                self.max_insn = max(self.max_insn, cost(insn, self.config, True))
+                nxt = addr + insn.size
+                flow = insn.flow
+                if flow is None or flow == "call":
+                    addr = nxt
+                    continue
+                if flow == "illegal":
+                    raise AnalysisError("illegal instruction 0x%x at %s" % (insn.raw, self.where(addr)))
+                if flow == "waitirq":
+                    raise AnalysisError("waitirq at %s has no bound" % self.where(addr))
+                if flow == "icall":
+                    self.resolve_auipc(insns, insn)
+                    addr = nxt
+                    continue
+                if flow == "ijump":
+                    self.resolve_auipc(insns, insn)
+                    if insn.flow == "tail":
+                        break
+                    targets = self.targets.get(addr)
+                    if targets is None:
+                        raise AnalysisError("unresolved indirect jump at %s, add a 'jumps' line to the bounds file"
+                                            % self.where(addr))
+                    for t in targets:
+                        leaders.add(t)
+                        work.append(t)
+                    break
+                if flow == "jump" and insn.target != entry and insn.target in self.elf.functions:
+                    insn.flow = "tail"
+                    break
+                if flow in ("branch", "jump"):
+                    leaders.add(insn.target)
+                    work.append(insn.target)
+                if flow == "branch":
+                    leaders.add(nxt)
+                    work.append(nxt)
+                if flow == "retirq" and not irq:
+                    raise AnalysisError("retirq at %s outside of the IRQ handler" % self.where(addr))
+                break
+
+        blocks = dict()
+        for addr in sorted(insns):
+            if addr in leaders or not blocks or not self.falls_into(insns, addr):
+                block = blocks[addr] = Block(addr)
+            block.insns.append(insns[addr])
+
+        for block in blocks.values():
+            body = 0
+            for insn in block.insns[:-1]:
+                body += self.insn_cost(insn)
+            last = block.insns[-1]
+            nxt = last.addr + last.size
+            flow = last.flow
+            if flow == "branch":
+                block.succs.append((last.target, body + cost(last, self.config, True)))
+                block.succs.append((nxt, body + cost(last, self.config, False)))
+            elif flow == "jump":
+                block.succs.append((last.target, body + cost(last, self.config)))
+            elif flow == "ijump":
+                for t in self.targets[last.addr]:
+                    block.succs.append((t, body + cost(last, self.config)))
+            elif flow == "tail":
+                block.succs.append((EXIT, body + self.call_cost(last, last.target)))
+            elif flow in ("ret", "retirq", "stop"):
+                block.succs.append((EXIT, body + cost(last, self.config)))
+            else:
+                block.succs.append((nxt, body + self.insn_cost(last)))
+        return blocks
+
+    def falls_into(self, insns, addr):
+        # addr continues the block of the previous instruction
+        for size in (2, 4):
+            prev = insns.get(addr - size)
+            if prev is not None and prev.size == size:
+                return prev.flow in (None, "call", "icall")
+        return False
+
+    def resolve_auipc(self, insns, insn):
+        # auipc rX + jalr (call/tail with a 32-bit offset): direct target
+        prev = insns.get(insn.addr - 4)
+        if prev is not None and prev.auipc is not None and prev.rd == insn.rs1 and insn.size == 4:
+            insn.target = (prev.auipc + insn.target) & 0xffffffff
+            insn.flow = "call" if insn.flow == "icall" else "tail"
+        elif insn.flow == "icall":
+            if insn.addr not in self.targets:
+                raise AnalysisError("unresolved indirect call at %s, add a 'calls' line to the bounds file"
+                                    % self.where(insn.addr))
+
+    def insn_cost(self, insn):
+        if insn.flow == "call":
+            return self.call_cost(insn, insn.target)
+        if insn.flow == "icall":
+            return cost(insn, self.config) + max(self.function(t) for t in self.targets[insn.addr])
+        return cost(insn, self.config)
+
+    def analyze(self, entry, irq):
+        blocks = self.build_cfg(entry, irq)
+        if irq:
+            first = blocks[entry]
+            first.succs = [(t, w + irq_entry_cost(self.config)) for t, w in first.succs]
+
+        # dominators (iterative, reverse postorder)
+        order, seen = [], set()
+        def dfs(a):
+            stack = [(a, iter(blocks[a].succs))]
+            seen.add(a)
+            while stack:
+                node, it = stack[-1]
+                for t, w in it:
+                    if t != EXIT and t not in seen:
+                        seen.add(t)
+                        stack.append((t, iter(blocks[t].succs)))
+                        break
+                else:
+                    order.append(node)
+                    stack.pop()
+        dfs(entry)
+        order.reverse()
+        index = {a: i for i, a in enumerate(order)}
+        preds = {a: [] for a in order}
+        for a in order:
+            for t, w in blocks[a].succs:
+                if t != EXIT:
+                    preds[t].append(a)
+        idom = {entry: entry}
+        def intersect(a, b):
+            while a != b:
+                while index[a] > index[b]:
+                    a = idom[a]
+                while index[b] > index[a]:
+                    b = idom[b]
+            return a
+        changed = True
+        while changed:
+            changed = False
+            for a in order[1:]:
+                ps = [p for p in preds[a] if p in idom]
+                new = ps[0]
+                for p in ps[1:]:
+                    new = intersect(p, new)
+                if idom.get(a) != new:
+                    idom[a] = new
+                    changed = True
+        def dominates(h, a):
+            while True:
+                if a == h:
+                    return True
+                if a == entry:
+                    return False
+                a = idom[a]
+
+        # natural loops
+        loops = dict()
+        for a in order:
+            for t, w in blocks[a].succs:
+                if t != EXIT and dominates(t, a):
+                    body = loops.setdefault(t, {t})
+                    work = [a]
+                    while work:
+                        b = work.pop()
+                        if b not in body:
+                            body.add(b)
+                            work.extend(preds[b])
+                elif t != EXIT and index[t] <= index[a]:
+                    raise AnalysisError("irreducible control flow at %s" % self.where(t))
+
+        # collapse loops, innermost first
+        rep = {a: a for a in order}
+        exits = {a: blocks[a].succs for a in order}
+        for header, body in sorted(loops.items(), key=lambda l: len(l[1])):
+            bound = self.loop_bound(header, body, loops, blocks)
+            nodes = {rep[a] for a in body}
+            dist = self.longest(rep[header], nodes, exits, rep, header)
+            iteration = 0
+            out = dict()
+            for n in nodes:
+                if n not in dist:
+                    continue
+                for t, w in exits[n]:
+                    if t == header:
+                        iteration = max(iteration, dist[n] + w)
+                    elif t == EXIT or t not in body:
+                        out[t] = max(out.get(t, 0), dist[n] + w)
+            node = ("loop", header)
+            exits[node] = [(t, bound * iteration + w) for t, w in out.items()]
+            for a in body:
+                rep[a] = node
+            if self.verbose:
+                print("  loop %s: bound %d, %d cycles per iteration" % (self.where(header), bound, iteration))
+
+        nodes = set(rep.values())
+        dist = self.longest(rep[entry], nodes, exits, rep, None)
+        result = None
+        for n in dist:
+            for t, w in exits[n]:
+                if t == EXIT:
+                    result = max(result or 0, dist[n] + w)
+        if result is None:
+            raise AnalysisError("%s never returns" % self.where(entry))
+        if self.verbose:
+            print("%s: %d cycles" % (self.where(entry), result))
+        return result
+
+    def loop_bound(self, header, body, loops, blocks):
+        inner = set()
+        for h, b in loops.items():
+            if h != header and h in body:
+                inner |= b
+        bound = None
+        for a in body - inner:
+            last = blocks[a].insns[-1]
+            for addr, n in self.bounds.items():
+                if a <= addr < last.addr + last.size:
+                    bound = n if bound is None else min(bound, n)
+                    self.used_bounds.add(addr)
+        if bound is None:
+            raise AnalysisError("no bound for the loop at %s" % self.where(header))
+        return bound
+
+    # longest paths from start through nodes, ignoring edges back to header
+    def longest(self, start, nodes, exits, rep, header):
+        order, seen = [], {start}
+        stack = [(start, iter(exits[start]))]
+        while stack:
+            n, it = stack[-1]
+            for t, w in it:
+                if t == EXIT or t == header:
+                    continue
+                r = rep[t]
+                if r in nodes and r not in seen:
+                    seen.add(r)
+                    stack.append((r, iter(exits[r])))
+                    break
+            else:
+                order.append(n)
+                stack.pop()
+        order.reverse()
+        dist = {start: 0}
+        for n in order:
+            if n not in dist:
+                continue
+            for t, w in exits[n]:
+                if t == EXIT or t == header:
+                    continue
+                r = rep[t]
+                if r in nodes and r != start:
+                    dist[r] = max(dist.get(r, 0), dist[n] + w)
+        return dist
+
+# --- annotations -----------------------------------------------------------------
+
+def read_bounds(elf, filename):
+    bounds, targets = dict(), dict()
+    # WCET_LOOP_BOUND(): pairs of (address, N) words
+    data = elf.section(".wcet_bounds")
+    if data:
+        for off in range(0, len(data) - 7, 8):
+            addr, n = struct.unpack_from("<II", data, off)
+            bounds[addr] = min(n, bounds.get(addr, n))
+    if filename:
+        with open(filename, "r") as f:
+            for lineno, line in enumerate(f, 1):
+                line = line.split("#")[0].split()
+                if not line:
+                    continue
+                try:
+                    if line[0] == "loop" and len(line) == 3:
+                        addr = elf.resolve(line[1])
+                        bounds[addr] = min(int(line[2], 0), bounds.get(addr, int(line[2], 0)))
+                    elif line[0] in ("calls", "jumps") and len(line) == 3:
+                        targets[elf.resolve(line[1])] = [elf.resolve(t) for t in line[2].split(",")]
+                    else:
+                        raise ValueError("expected 'loop LOC N', 'calls LOC LOC,...' or 'jumps LOC LOC,...'")
+                except ValueError as e:
+                    raise ValueError("%s:%d: %s" % (filename, lineno, e))
+    return bounds, targets
+
+# --- validation against a commit log ---------------------------------------------
+
+def check(filename, config, elf, tasks, irq, results):
+    kinds = dict()
+    measured = {entry: [] for entry in tasks}
+    irq_measured = []
+    open_calls = []         # [entry, return address, start cycle, irq cycles]
+    irq_start = None
+    last_cycle = None
+    with open(filename, "r") as f:
+        for line in f:
+            if line.startswith("#"):
+                continue
+            fields = line.split()
+            cycle, pc, raw = int(fields[1]), int(fields[2], 16), int(fields[3], 16)
+            rd_value = int(fields[6].split(":")[1], 16)
+            next_pc, flags = int(fields[12], 16), fields[13]
+            insn = Insn(pc, raw if raw & 3 == 3 else raw & 0xffff)
+            taken = next_pc != pc + insn.size
+            if last_cycle is not None:
+                model = cost(insn, config, taken) + (irq_entry_cost(config) if flags[0] == "I" else 0)
+                k = kinds.setdefault(KIND_NAMES[insn.kind], [0, 0, 0, 0])
+                k[0] += 1
+                k[1] = max(k[1], cycle - last_cycle)
+                k[2] = max(k[2], model)
+                if insn.kind != FIXED and cycle - last_cycle > model:
+                    k[3] += 1
+            if flags[0] == "I":
+                irq_start = last_cycle
+            if insn.flow == "retirq" and irq_start is not None:
+                irq_measured.append(cycle - irq_start)
+                for c in open_calls:
+                    c[3] += cycle - irq_start
+                irq_start = None
+            for c in open_calls:
+                if next_pc == c[1]:
+                    measured[c[0]].append(cycle - c[2] - c[3])
+            open_calls = [c for c in open_calls if next_pc != c[1]]
+            if next_pc in measured and insn.rd and insn.flow in ("call", "icall"):
+                open_calls.append([next_pc, rd_value, cycle, 0])
+            last_cycle = cycle
+
+    print("\n%-10s %10s %10s %10s %10s" % ("kind", "count", "max", "model", "exceeded"))
+    for name in KIND_NAMES:
+        if name in kinds:
+            k = kinds[name]
+            print("%-10s %10d %10d %10d %10d" % (name, k[0], k[1], k[2], k[3]))
+
+    ok = True
+    print("\n%-24s %10s %10s %10s" % ("entry", "runs", "max", "bound"))
+    rows = [(elf.locate(e), measured[e], results.get(e)) for e in tasks]
+    if irq is not None:
+        rows.append((elf.locate(irq) + " (irq)", irq_measured, results.get(irq)))
+    for name, runs, bound in rows:
+        worst = max(runs) if runs else 0
+        print("%-24s %10d %10d %10s" % (name, len(runs), worst, bound if bound is not None else "-"))
+        if bound is not None and worst > bound:
+            ok = False
+            print("  measured %d cycles exceed the bound of %d cycles" % (worst, bound))
+    return ok
+
+# --- main ------------------------------------------------------------------------
+
+parser = argparse.ArgumentParser(description="static WCET analysis of picorv32 firmware")
+parser.add_argument("elf")
+parser.add_argument("entries", nargs="*", metavar="LOC", help="tasks to analyze (symbol, symbol+offset or address)")
+parser.add_argument("--config", default="", metavar="SPEC",
+                    help="core configuration, e.g. \"barrel_shifter,enable_fast_mul,wait=1\" (see scripts/whatif)")
+parser.add_argument("--bounds", metavar="FILE", help="loop bounds and indirect jump/call targets")
+parser.add_argument("--irq", metavar="LOC", help="IRQ handler (PROGADDR_IRQ), analyzed up to retirq")
+parser.add_argument("--check", metavar="LOG", help="compare with a commit log of testbench_cli (--commit-log)")
+parser.add_argument("-v", "--verbose", action="store_true", help="print the bound of every function and loop")
+args = parser.parse_args()
+
+try:
+    config = Config(args.config)
+    elf = Elf(args.elf)
+    bounds, targets = read_bounds(elf, args.bounds)
+    tasks = [elf.resolve(e) for e in args.entries]
+    irq = elf.resolve(args.irq) if args.irq else None
+except (ValueError, OSError) as e:
+    print("Error: %s" % e, file=sys.stderr)
+    sys.exit(1)
+if not tasks and irq is None:
+    parser.error("no task or IRQ handler given")
+
+analyzer = Analyzer(elf, config, bounds, targets, args.verbose)
+results = dict()
+failed = False
+for entry in tasks + ([irq] if irq is not None else []):
+    try:
+        if entry == irq:
+            analyzer.active = [entry]
+            results[entry] = analyzer.analyze(entry, irq=True)
+            analyzer.active = []
+        else:
+            results[entry] = analyzer.function(entry)
+    except AnalysisError as e:
+        print("Error: %s: %s" % (elf.locate(entry), e), file=sys.stderr)
+        analyzer.active = []
+        failed = True
+
+print("%-24s %10s" % ("entry", "wcet"))
+for entry in tasks:
+    if entry in results:
+        print("%-24s %10d" % (elf.locate(entry), results[entry]))
+if irq in results:
+    print("%-24s %10d" % (elf.locate(irq) + " (irq)", results[irq]))
+    # an IRQ is taken when the current instruction has finished
+    print("\nIRQ response <= %d cycles (longest instruction of the analyzed code + IRQ entry),"
+          % (analyzer.max_insn + irq_entry_cost(config)))
+    print("plus the time IRQs are masked and the WCET of the handler for an IRQ already being served")
+
+for addr in sorted(set(bounds) - analyzer.used_bounds):
+    if addr in analyzer.covered:
+        print("Warning: bound at %s is not in a loop" % analyzer.where(addr), file=sys.stderr)
+
+if args.check and not check(args.check, config, elf, tasks, irq, results):
+    failed = True
+sys.exit(1 if failed else 0)
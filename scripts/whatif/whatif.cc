@@ -0,0 +1,543 @@
+// Trace-driven "what-if" timing model for picorv32 configurations
+//
+// Replays the committed instruction stream of one run (testbench_cli
+// --commit-log=FILE) and predicts the cycle count of the same program for
+// other core configurations, without re-verilating:
+//
+//   BARREL_SHIFTER, TWO_STAGE_SHIFT, TWO_CYCLE_ALU, TWO_CYCLE_COMPARE,
+//   ENABLE_FAST_MUL, ENABLE_REGS_DUALPORT and memory wait states
+//
+// plus dual_issue, a hypothetical core (not implemented in picorv32.v) that
+// issues two independent simple instructions from the same 64-bit fetch
+// block together (see Model::load).
+//
+// The trace is reduced to a histogram of timing-relevant events (instruction
+// kind, shift amount, branch direction, issue pair), so evaluating a configuration costs
+// a few hundred operations no matter how long the trace is.
+//
+// By default the prediction is calibrated against the RTL: the cycle column
+// of the commit log gives the measured cycles of every event in the traced
+// configuration (--base), and only the per-event difference between the
+// model costs of the two configurations is added. --analytic uses the model
+// costs alone, --calibrate compares the model with the measured cycles.
+//
+// Usage: whatif [options] commit.log
+//   --base=SPEC     configuration of the traced run (default: testbench.v)
+//   --config=SPEC   evaluate SPEC (may be repeated); default: sweep all
+//   --sweep-wait=L  comma separated wait states for the sweep (default: 0)
+//   --analytic      ignore the measured cycles
+//   --calibrate     print model vs. measured cycles per event kind
+//
+// SPEC is a comma separated list of parameter names with an optional =0/=1
+// (lower case, e.g. "barrel_shifter,enable_regs_dualport=0,wait=2"); names
+// that are not given keep the picorv32 defaults. The base default is the
+// core in testbench.v: "enable_mul".
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cinttypes>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <chrono>
+#include <tuple>
+
+struct Config {
+    bool barrel_shifter = false;
+    bool two_stage_shift = true;
+    bool two_cycle_alu = false;
+    bool two_cycle_compare = false;
+    bool enable_fast_mul = false;
+    bool enable_regs_dualport = true;
+    bool dual_issue = false;
+    int wait_states = 0;
+
+    bool parse(const char* spec) {
+        std::string s = spec;
+        size_t pos = 0;
+        while (pos < s.size()) {
+            size_t end = s.find(',', pos);
+            if (end == std::string::npos)
+                end = s.size();
+            std::string item = s.substr(pos, end - pos);
+            pos = end + 1;
+            if (item.empty())
+                continue;
+            std::string name = item, value = "1";
+            size_t eq = item.find('=');
+            if (eq != std::string::npos) {
+                name = item.substr(0, eq);
+                value = item.substr(eq + 1);
+            }
+            int v = atoi(value.c_str());
+            if (name == "barrel_shifter") barrel_shifter = v;
+            else if (name == "two_stage_shift") two_stage_shift = v;
+            else if (name == "two_cycle_alu") two_cycle_alu = v;
+            else if (name == "two_cycle_compare") two_cycle_compare = v;
+            else if (name == "enable_fast_mul") enable_fast_mul = v;
+            else if (name == "enable_mul") enable_fast_mul = !v;
+            else if (name == "enable_regs_dualport") enable_regs_dualport = v;
+            else if (name == "dual_issue") dual_issue = v;
+            else if (name == "wait") wait_states = v;
+            else {
+                fprintf(stderr, "Error: Unknown configuration option '%s'\n", name.c_str());
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static const char* header() {
+        return "barrel_shifter,two_stage_shift,two_cycle_alu,two_cycle_compare,enable_fast_mul,enable_regs_dualport,dual_issue,wait";
+    }
+
+    void print(FILE* f) const {
+        fprintf(f, "%d,%d,%d,%d,%d,%d,%d,%d", barrel_shifter, two_stage_shift, two_cycle_alu,
+                two_cycle_compare, enable_fast_mul, enable_regs_dualport, dual_issue, wait_states);
+    }
+};
+
+enum EventKind {
+    EV_ALU_IMM,     // lui, auipc, jal and ALU reg + immediate
+    EV_ALU_REG,     // ALU reg + reg
+    EV_BRANCH,
+    EV_JALR,
+    EV_LOAD,
+    EV_STORE,
+    EV_SHIFT_IMM,
+    EV_SHIFT_REG,
+    EV_MUL,
+    EV_MULH,
+    EV_DIV,
+    EV_BITMANIP,    // Zbkb and Zbkx (ENABLE_BITMANIP)
+    EV_CLMUL,       // Zbc (ENABLE_BITMANIP)
+    EV_SIMPLE,      // rdcycle & co. and the IRQ custom instructions
+    EV_FIXED,       // waitirq, ecall/ebreak and anything else the model does not cover
+    EV_COUNT
+};
+
+static const char* const event_names[EV_COUNT] = {
+    "alu_imm", "alu_reg", "branch", "jalr", "load", "store", "shift_imm", "shift_reg",
+    "mul", "mulh", "div", "bitmanip", "clmul", "simple", "fixed"
+};
+
+// Key of the event histogram
+struct Event {
+    uint8_t kind;
+    uint8_t shamt;
+    bool taken;
+    bool intr;
+    bool paired;    // second instruction of an issue pair
+
+    bool operator<(const Event& other) const {
+        return std::tie(kind, shamt, taken, intr, paired) <
+               std::tie(other.kind, other.shamt, other.taken, other.intr, other.paired);
+    }
+};
+
+struct EventStats {
+    uint64_t count = 0;
+    uint64_t measured = 0;
+};
+
+// Instructions of picorv32_pcpi_bitmanip, some of them in the encoding space
+// of the shifts: EV_BITMANIP, EV_CLMUL or EV_COUNT for anything else
+static int bitmanip_kind(uint32_t insn) {
+    uint32_t f3 = (insn >> 12) & 7, f7 = insn >> 25, imm = insn >> 20;
+    if ((insn & 0x7f) == 0x13)
+        return (f3 == 5 && (f7 == 0x30 || imm == 0x687 || imm == 0x698)) ||
+               ((f3 == 1 || f3 == 5) && imm == 0x08f) ? EV_BITMANIP : EV_COUNT;
+    if (f7 == 0x05)
+        return f3 >= 1 && f3 <= 3 ? EV_CLMUL : EV_COUNT;
+    if ((f7 == 0x20 && (f3 == 4 || f3 == 6 || f3 == 7)) || (f7 == 0x30 && (f3 == 1 || f3 == 5)) ||
+        (f7 == 0x04 && (f3 == 4 || f3 == 7)) || (f7 == 0x14 && (f3 == 2 || f3 == 4)))
+        return EV_BITMANIP;
+    return EV_COUNT;
+}
+
+// Classify a committed instruction (compressed instructions in the low 16
+// bits). Compressed instructions have the same timing as their expansion.
+static Event classify(uint32_t insn, uint32_t rs2_value, bool taken, bool intr) {
+    Event e = {EV_FIXED, 0, false, intr, false};
+
+    if ((insn & 3) != 3) {
+        uint32_t q = insn & 3, f3 = (insn >> 13) & 7;
+        uint32_t rd = (insn >> 7) & 31, rs2 = (insn >> 2) & 31;
+        bool b12 = insn & 0x1000;
+        if (q == 0)
+            e.kind = f3 == 0 ? EV_ALU_IMM : f3 == 2 ? EV_LOAD : f3 == 6 ? EV_STORE : EV_FIXED;
+        else if (q == 1) {
+            if (f3 == 1 || f3 == 5)
+                e.kind = EV_ALU_IMM;
+            else if (f3 == 6 || f3 == 7)
+                e.kind = EV_BRANCH, e.taken = taken;
+            else if (f3 == 4 && ((insn >> 10) & 3) < 2)
+                e.kind = EV_SHIFT_IMM, e.shamt = ((insn >> 2) & 31) | (b12 << 5);
+            else if (f3 == 4 && ((insn >> 10) & 3) == 3)
+                e.kind = EV_ALU_REG;
+            else
+                e.kind = EV_ALU_IMM;
+        } else {
+            if (f3 == 0)
+                e.kind = EV_SHIFT_IMM, e.shamt = ((insn >> 2) & 31) | (b12 << 5);
+            else if (f3 == 2)
+                e.kind = EV_LOAD;
+            else if (f3 == 6)
+                e.kind = EV_STORE;
+            else if (f3 == 4 && !rs2)
+                e.kind = b12 && !rd ? EV_FIXED : EV_JALR;
+            else if (f3 == 4)
+                e.kind = b12 ? EV_ALU_REG : EV_ALU_IMM;  // c.mv is addi rd, rs2, 0
+        }
+        return e;
+    }
+
+    uint32_t f3 = (insn >> 12) & 7, f7 = insn >> 25;
+    switch (insn & 0x7f) {
+    case 0x37: case 0x17: case 0x6f: e.kind = EV_ALU_IMM; break;
+    case 0x67: e.kind = EV_JALR; break;
+    case 0x63: e.kind = EV_BRANCH; e.taken = taken; break;
+    case 0x03: e.kind = EV_LOAD; break;
+    case 0x23: e.kind = EV_STORE; break;
+    case 0x13:
+        if (bitmanip_kind(insn) != EV_COUNT)
+            e.kind = bitmanip_kind(insn);
+        else if (f3 == 1 || f3 == 5)
+            e.kind = EV_SHIFT_IMM, e.shamt = (insn >> 20) & 31;
+        else
+            e.kind = EV_ALU_IMM;
+        break;
+    case 0x33:
+        if (f7 == 1)
+            e.kind = f3 == 0 ? EV_MUL : f3 < 4 ? EV_MULH : EV_DIV;
+        else if (bitmanip_kind(insn) != EV_COUNT)
+            e.kind = bitmanip_kind(insn);
+        else if ((f3 == 1 || f3 == 5) && f7 != 7)  // f7 == 7: czero.eqz/nez
+            e.kind = EV_SHIFT_REG, e.shamt = rs2_value & 31;
+        else
+            e.kind = EV_ALU_REG;
+        break;
+    case 0x73:
+        e.kind = f3 == 2 ? EV_SIMPLE : EV_FIXED;
+        break;
+    case 0x0b:
+        e.kind = f7 == 4 ? EV_FIXED : EV_SIMPLE;  // waitirq
+        break;
+    }
+    return e;
+}
+
+// Slot of an instruction in an issue pair, as in PairCounter::slot in
+// testbench_cli.cc: lui, auipc and the 32-bit ALU instructions other than
+// shifts and czero issue first or second, branches whose offset is a
+// multiple of 4 only second, RVC instructions never
+enum { SLOT_NONE, SLOT_ALU, SLOT_BRANCH };
+
+static int pair_slot(uint32_t insn) {
+    uint32_t opcode = insn & 0x7f, f3 = (insn >> 12) & 7, f7 = insn >> 25;
+    if (opcode == 0x37 || opcode == 0x17)
+        return SLOT_ALU;
+    if (opcode == 0x13 && (f3 & 3) != 1)
+        return SLOT_ALU;
+    if (opcode == 0x33 && (f3 & 3) != 1 && (f7 == 0 || (f7 == 0x20 && f3 == 0)))
+        return SLOT_ALU;
+    if (opcode == 0x63 && (f3 >> 1) != 1 && !(insn & 0x100))
+        return SLOT_BRANCH;
+    return SLOT_NONE;
+}
+
+// Model cost in cycles of one event. The numbers follow the CPI table in
+// README.md (look-ahead interface, ENABLE_REGS_DUALPORT, memory without wait
+// states) and the state machine in picorv32.v; each memory transfer adds the
+// configured wait states. ENABLE_FAST_MUL, IRQ entry and the "simple" kind
+// are estimates, see --calibrate. With dual_issue the second instruction of
+// a pair executes alongside the first and only a taken branch still costs
+// the refetch.
+static int cost(const Event& e, const Config& c) {
+    int sp = c.enable_regs_dualport ? 0 : 1;
+    int alu = c.two_cycle_alu;
+    int cmp = c.two_cycle_compare;
+    int w = c.wait_states;
+    int n = 0;
+
+    if (c.dual_issue && e.paired)
+        return e.taken ? 2 + w : 0;
+
+    switch (e.kind) {
+    case EV_ALU_IMM: n = 3 + alu + w; break;
+    case EV_ALU_REG: n = 3 + sp + alu + w; break;
+    case EV_BRANCH:  n = 3 + sp + alu + cmp + w + (e.taken ? 2 + w : 0); break;
+    case EV_JALR:    n = 6 + alu + 2 * w; break;
+    case EV_LOAD:    n = 5 + 2 * w; break;
+    case EV_STORE:   n = 5 + sp + 2 * w; break;
+    case EV_SHIFT_IMM:
+    case EV_SHIFT_REG: {
+        int reg = e.kind == EV_SHIFT_REG ? sp : 0;
+        if (c.barrel_shifter)
+            n = 3 + reg + alu + w;
+        else
+            n = 4 + reg + w + (c.two_stage_shift ? e.shamt / 4 + e.shamt % 4 : e.shamt);
+        break;
+    }
+    case EV_MUL:     n = (c.enable_fast_mul ? 6 : 40) + sp + w; break;
+    case EV_MULH:    n = (c.enable_fast_mul ? 6 : 72) + sp + w; break;
+    case EV_DIV:     n = 40 + sp + w; break;
+    case EV_BITMANIP: n = 5 + sp + w; break;
+    case EV_CLMUL:   n = 13 + sp + w; break;
+    case EV_SIMPLE:  n = 3 + w; break;
+    case EV_FIXED:   n = 0; break;
+    }
+    if (e.intr)
+        n += 3 + w;
+    return n;
+}
+
+// Memory transfers per event, used to fit the wait states in --calibrate
+static int transfers(const Event& e) {
+    Config zero, one;
+    one.wait_states = 1;
+    return cost(e, one) - cost(e, zero);
+}
+
+class Model {
+public:
+    std::vector<std::pair<Event, EventStats>> events;
+    uint64_t instret = 0;
+    uint64_t measured_cycles = 0;
+    uint64_t fixed_cycles = 0;
+
+    uint64_t pairs = 0;
+
+    // Issue pairs follow the rule of PairCounter in testbench_cli.cc: an ALU
+    // instruction at the start of an aligned 8-byte block followed by an ALU
+    // instruction or a branch in the second word that neither reads nor
+    // writes its rd, formed greedily in commit order and broken by an IRQ
+    // entry.
+    bool load(const char* filename) {
+        FILE* f = fopen(filename, "r");
+        if (!f) {
+            fprintf(stderr, "Error: Cannot open commit log '%s'\n", filename);
+            return false;
+        }
+        std::map<Event, EventStats> hist;
+        char line[512];
+        uint64_t last_cycle = 0;
+        bool first = true;
+        bool pair_open = false;
+        unsigned pair_next_pc = 0, pair_rd = 0;
+        while (fgets(line, sizeof(line), f)) {
+            if (line[0] == '#')
+                continue;
+            uint64_t order, cycle;
+            unsigned pc, insn, rs1, rs2, rs2_value, rd, next_pc, n;
+            char flags[8];
+            if (sscanf(line, "%" SCNu64 " %" SCNu64 " %x %x x%u:%*x x%u:%x x%u:%*x %*x %*x %*x %*x %*x %x %7s",
+                       &order, &cycle, &pc, &insn, &rs1, &rs2, &rs2_value, &rd, &next_pc, flags) != 10) {
+                fprintf(stderr, "Error: Cannot parse commit log line: %s", line);
+                fclose(f);
+                return false;
+            }
+            n = (insn & 3) == 3 ? 4 : 2;
+            Event e = classify(insn, rs2_value, next_pc != pc + n, flags[0] == 'I');
+            bool trap = flags[1] == 'T';
+            int slot = pair_slot(insn);
+            if (pair_open && !e.intr && !trap && slot != SLOT_NONE && pc == pair_next_pc &&
+                (!pair_rd || (rs1 != pair_rd && rs2 != pair_rd && rd != pair_rd))) {
+                e.paired = true;
+                pairs++;
+                pair_open = false;
+            } else {
+                pair_open = slot == SLOT_ALU && !(pc & 7) && !trap && next_pc == pc + 4;
+                pair_next_pc = next_pc;
+                pair_rd = rd;
+            }
+            EventStats& s = hist[e];
+            s.count++;
+            // The core reports an instruction when the next one is launched,
+            // so the cycle delta is the execution time of this instruction
+            if (!first)
+                s.measured += cycle - last_cycle;
+            first = false;
+            last_cycle = cycle;
+            instret++;
+        }
+        fclose(f);
+        if (!instret) {
+            fprintf(stderr, "Error: No instructions in commit log '%s'\n", filename);
+            return false;
+        }
+        events.assign(hist.begin(), hist.end());
+        for (auto& ev : events) {
+            measured_cycles += ev.second.measured;
+            if (ev.first.kind == EV_FIXED)
+                fixed_cycles += ev.second.measured;
+        }
+        return true;
+    }
+
+    // Cycles of the whole trace with configuration c
+    uint64_t analytic(const Config& c) const {
+        uint64_t cycles = fixed_cycles;
+        for (auto& ev : events)
+            cycles += ev.second.count * cost(ev.first, c);
+        return cycles;
+    }
+
+    uint64_t calibrated(const Config& c, const Config& base) const {
+        int64_t delta = 0;
+        for (auto& ev : events)
+            delta += (int64_t)ev.second.count * (cost(ev.first, c) - cost(ev.first, base));
+        return measured_cycles + delta;
+    }
+
+    void calibrate(const Config& base) const {
+        struct Row { uint64_t count = 0, measured = 0, model = 0, transfers = 0; };
+        Row rows[EV_COUNT], total;
+        for (auto& ev : events) {
+            Row& r = rows[ev.first.kind];
+            r.count += ev.second.count;
+            r.measured += ev.second.measured;
+            r.model += ev.second.count * cost(ev.first, base);
+            r.transfers += ev.second.count * transfers(ev.first);
+        }
+        printf("%-10s %12s %10s %10s %8s\n", "kind", "count", "measured", "model", "error");
+        for (int k = 0; k < EV_COUNT; k++) {
+            Row& r = rows[k];
+            if (!r.count)
+                continue;
+            if (k == EV_FIXED)
+                r.model = r.measured;
+            printf("%-10s %12" PRIu64 " %10.2f %10.2f %7.1f%%\n", event_names[k], r.count,
+                   (double)r.measured / r.count, (double)r.model / r.count,
+                   r.measured ? 100.0 * ((double)r.model - r.measured) / r.measured : 0.0);
+            total.count += r.count;
+            total.measured += r.measured;
+            total.model += r.model;
+            total.transfers += r.transfers;
+        }
+        printf("%-10s %12" PRIu64 " %10.2f %10.2f %7.1f%%\n", "total", total.count,
+               (double)total.measured / total.count, (double)total.model / total.count,
+               100.0 * ((double)total.model - total.measured) / total.measured);
+
+        // Wait states that make the analytic model match the measured total
+        Config zero = base;
+        zero.wait_states = 0;
+        if (total.transfers)
+            printf("\nFitted wait states per memory transfer: %.2f\n",
+                   ((double)total.measured - (double)analytic(zero)) / total.transfers);
+    }
+};
+
+static bool parse_wait_list(const char* s, std::vector<int>& list) {
+    list.clear();
+    while (*s) {
+        char* end;
+        long v = strtol(s, &end, 0);
+        if (end == s || v < 0)
+            return false;
+        list.push_back(v);
+        s = *end == ',' ? end + 1 : end;
+    }
+    return !list.empty();
+}
+
+static void print_usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [options] commit.log\n", prog);
+    fprintf(stderr, "  --base=SPEC     configuration of the traced run (default: enable_mul)\n");
+    fprintf(stderr, "  --config=SPEC   evaluate SPEC (may be repeated); default: sweep all\n");
+    fprintf(stderr, "  --sweep-wait=L  comma separated wait states for the sweep (default: 0)\n");
+    fprintf(stderr, "  --analytic      ignore the measured cycles in the commit log\n");
+    fprintf(stderr, "  --calibrate     print model vs. measured cycles per event kind\n");
+}
+
+int main(int argc, char** argv) {
+    const char* log_file = nullptr;
+    Config base;
+    base.parse("enable_mul");
+    std::vector<Config> configs;
+    std::vector<int> waits = {0};
+    bool analytic = false;
+    bool calibrate = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--base=", 7) == 0) {
+            base = Config();
+            if (!base.parse(argv[i] + 7))
+                return 1;
+        } else if (strncmp(argv[i], "--config=", 9) == 0) {
+            Config c;
+            if (!c.parse(argv[i] + 9))
+                return 1;
+            configs.push_back(c);
+        } else if (strncmp(argv[i], "--sweep-wait=", 13) == 0) {
+            if (!parse_wait_list(argv[i] + 13, waits)) {
+                fprintf(stderr, "Error: Invalid wait state list\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--analytic") == 0) {
+            analytic = true;
+        } else if (strcmp(argv[i], "--calibrate") == 0) {
+            calibrate = true;
+        } else if (argv[i][0] == '-') {
+            print_usage(argv[0]);
+            return strcmp(argv[i], "-h") && strcmp(argv[i], "--help") ? 1 : 0;
+        } else {
+            log_file = argv[i];
+        }
+    }
+
+    if (!log_file) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    Model model;
+    if (!model.load(log_file))
+        return 1;
+    fprintf(stderr, "%" PRIu64 " instructions, %" PRIu64 " measured cycles, %zu distinct events, %" PRIu64 " issue pairs\n",
+            model.instret, model.measured_cycles, model.events.size(), model.pairs);
+
+    if (calibrate) {
+        model.calibrate(base);
+        return 0;
+    }
+
+    if (configs.empty()) {
+        for (int w : waits)
+            for (int bits = 0; bits < 128; bits++) {
+                Config c;
+                c.barrel_shifter = bits & 1;
+                c.two_stage_shift = bits & 2;
+                c.two_cycle_alu = bits & 4;
+                c.two_cycle_compare = bits & 8;
+                c.enable_fast_mul = bits & 16;
+                c.enable_regs_dualport = bits & 32;
+                c.dual_issue = bits & 64;
+                c.wait_states = w;
+                // TWO_STAGE_SHIFT has no effect with BARREL_SHIFTER
+                if (c.barrel_shifter && !c.two_stage_shift)
+                    continue;
+                configs.push_back(c);
+            }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::pair<uint64_t, size_t>> results;
+    for (size_t i = 0; i < configs.size(); i++)
+        results.push_back({analytic ? model.analytic(configs[i]) : model.calibrated(configs[i], base), i});
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::sort(results.begin(), results.end());
+
+    uint64_t base_cycles = analytic ? model.analytic(base) : model.measured_cycles;
+    printf("cycles,cpi,speedup,%s\n", Config::header());
+    for (auto& r : results) {
+        printf("%" PRIu64 ",%.3f,%.3f,", r.first, (double)r.first / model.instret, (double)base_cycles / r.first);
+        configs[r.second].print(stdout);
+        printf("\n");
+    }
+    fprintf(stderr, "%zu configurations in %.3f ms (%.0f configurations/s)\n",
+            configs.size(), seconds * 1e3, seconds > 0 ? configs.size() / seconds : 0.0);
+    return 0;
+}
@@ -1,5 +1,8 @@
 #include "Vpicorv32_wrapper.h"
+#include "Vpicorv32_wrapper_picorv32_wrapper.h"
+#include "Vpicorv32_wrapper_axi4_memory.h"
 #include "verilated_vcd_c.h"
+#include "testbench_loader.h"
 
 int main(int argc, char **argv, char **env)
 {
@@ -9,6 +12,18 @@ int main(int argc, char **argv, char **env)
 	Verilated::commandArgs(argc, argv);
 	Vpicorv32_wrapper* top = new Vpicorv32_wrapper;
 
+	// Program (ELF or raw binary), loaded directly into the memory array
+	// (testbench.v is built with -DNO_READMEMH)
+	const char* firmware_file = "firmware/firmware.elf";
+	const char* flag_firmware = Verilated::commandArgsPlusMatch("firmware=");
+	if (flag_firmware && 0==strncmp(flag_firmware, "+firmware=", 10))
+		firmware_file = flag_firmware + 10;
+	ElfLoader loader;
+	if (!loader.load_image(firmware_file, top->picorv32_wrapper->mem->memory.data(), 128*1024)) {
+		delete top;
+		exit(1);
+	}
+
 	// Tracing (vcd)
 	VerilatedVcdC* tfp = NULL;
 	const char* flag_vcd = Verilated::commandArgsPlusMatch("vcd");
@@ -77,7 +77,7 @@ module picorv32_wrapper #(
 	wire tests_passed;
 	reg [31:0] irq = 0;
 
-	reg [15:0] count_cycle = 0;
+	reg [15:0] count_cycle /* verilator public_flat_rw */ = 0;
 	always @(posedge clk) count_cycle <= resetn ? count_cycle + 1 : 0;
 
 	always @* begin
@@ -139,25 +139,25 @@ module picorv32_wrapper #(
 	);
 
 `ifdef RISCV_FORMAL
-	wire        rvfi_valid;
-	wire [63:0] rvfi_order;
-	wire [31:0] rvfi_insn;
-	wire        rvfi_trap;
-	wire        rvfi_halt;
-	wire        rvfi_intr;
-	wire [4:0]  rvfi_rs1_addr;
-	wire [4:0]  rvfi_rs2_addr;
-	wire [31:0] rvfi_rs1_rdata;
-	wire [31:0] rvfi_rs2_rdata;
-	wire [4:0]  rvfi_rd_addr;
-	wire [31:0] rvfi_rd_wdata;
-	wire [31:0] rvfi_pc_rdata;
-	wire [31:0] rvfi_pc_wdata;
-	wire [31:0] rvfi_mem_addr;
-	wire [3:0]  rvfi_mem_rmask;
-	wire [3:0]  rvfi_mem_wmask;
-	wire [31:0] rvfi_mem_rdata;
-	wire [31:0] rvfi_mem_wdata;
+	wire        rvfi_valid /* verilator public */;
+	wire [63:0] rvfi_order /* verilator public */;
+	wire [31:0] rvfi_insn /* verilator public */;
+	wire        rvfi_trap /* verilator public */;
+	wire        rvfi_halt /* verilator public */;
+	wire        rvfi_intr /* verilator public */;
+	wire [4:0]  rvfi_rs1_addr /* verilator public */;
+	wire [4:0]  rvfi_rs2_addr /* verilator public */;
+	wire [31:0] rvfi_rs1_rdata /* verilator public */;
+	wire [31:0] rvfi_rs2_rdata /* verilator public */;
+	wire [4:0]  rvfi_rd_addr /* verilator public */;
+	wire [31:0] rvfi_rd_wdata /* verilator public */;
+	wire [31:0] rvfi_pc_rdata /* verilator public */;
+	wire [31:0] rvfi_pc_wdata /* verilator public */;
+	wire [31:0] rvfi_mem_addr /* verilator public */;
+	wire [3:0]  rvfi_mem_rmask /* verilator public */;
+	wire [3:0]  rvfi_mem_wmask /* verilator public */;
+	wire [31:0] rvfi_mem_rdata /* verilator public */;
+	wire [31:0] rvfi_mem_wdata /* verilator public */;
 `endif
 
 	picorv32_axi #(
@@ -170,6 +170,21 @@ module picorv32_wrapper #(
 `endif
 		.ENABLE_MUL(1),
 		.ENABLE_DIV(1),
+`ifdef FAST_MUL_TEST
+		.ENABLE_FAST_MUL(1),
+`endif
+`ifdef MUL_REUSE_TEST
+		.ENABLE_MUL_REUSE(1),
+`endif
+`ifdef ZICOND_TEST
+		.ENABLE_ZICOND(1),
+`endif
+`ifdef BITMANIP_TEST
+		.ENABLE_BITMANIP(1),
+`endif
+`ifdef DECOUPLED_TEST
+		.DECOUPLED_PCPI(1),
+`endif
 		.ENABLE_IRQ(1),
 		.ENABLE_TRACE(1)
 `endif
@@ -220,40 +235,147 @@ module picorv32_wrapper #(
 		.trace_data     (trace_data     )
 	);
 
+`ifdef VERILATOR
+	// High while the core waits in waitirq with no IRQ pending and the bus is
+	// idle. Only the cycle counters and the IRQ timer change in this state,
+	// which lets testbench_cli --idle-skip jump ahead to the next IRQ event.
+	wire idle_waitirq /* verilator public */ = !trap && uut.picorv32_core.do_waitirq && !uut.picorv32_core.irq_pending &&
+			!uut.picorv32_core.mem_valid && !mem_axi_awvalid && !mem_axi_wvalid && !mem_axi_arvalid && !mem_axi_bvalid && !mem_axi_rvalid;
+
+	// High while none of the IRQ sources of this testbench (irq[4], irq[5] and
+	// the core timer) can interrupt the core, used by the testbench_cli hang
+	// detector to tell a dead loop from an idle loop waiting for an IRQ.
+	wire irqs_blocked /* verilator public */ = uut.picorv32_core.irq_active ||
+			(&uut.picorv32_core.irq_mask[5:4] && (uut.picorv32_core.irq_mask[0] || !uut.picorv32_core.timer));
+
+	// Probes for testbench_cli --coverage: the instruction in flight and its
+	// cpu_state, the kind of memory access the core is waiting for (0 none,
+	// 1 fetch, 2 load, 3 store) and an unmasked IRQ waiting to be taken.
+	wire [7:0] cov_cpu_state /* verilator public */ = uut.picorv32_core.cpu_state;
+	wire [31:0] cov_insn /* verilator public */ = uut.picorv32_core.dbg_insn_opcode;
+	wire cov_insn_valid /* verilator public */ = uut.picorv32_core.dbg_valid_insn;
+	wire [1:0] cov_mem_stall /* verilator public */ = !uut.mem_valid || uut.mem_ready ? 2'd0 :
+			uut.mem_instr ? 2'd1 : |uut.mem_wstrb ? 2'd3 : 2'd2;
+	wire cov_irq_pending /* verilator public */ = !uut.picorv32_core.irq_active &&
+			|(uut.picorv32_core.irq_pending & ~uut.picorv32_core.irq_mask);
+
+	// Probes for testbench_cli --memtrace and --timeline: a pending and a
+	// completed transfer on the native memory interface between the core and
+	// the AXI adapter
+	wire mem_xfer_valid /* verilator public */ = uut.mem_valid;
+	wire mem_xfer /* verilator public */ = uut.mem_valid && uut.mem_ready;
+	wire [31:0] mem_xfer_addr /* verilator public */ = uut.mem_addr;
+	wire mem_xfer_instr /* verilator public */ = uut.mem_instr;
+	wire [3:0] mem_xfer_wstrb /* verilator public */ = uut.mem_wstrb;
+`endif
+
 `ifdef RISCV_FORMAL
+`ifndef NO_RVFIMON
+	// With DECOUPLED_PCPI the core reports an instruction left on the
+	// co-processor after the instructions behind it. rvfi_reorder puts the
+	// commits back in rvfi_order for the monitor, which checks them in
+	// program order. Without DECOUPLED_PCPI it only adds a cycle.
+	wire        mon_rvfi_valid;
+	wire [63:0] mon_rvfi_order;
+	wire [31:0] mon_rvfi_insn;
+	wire        mon_rvfi_trap;
+	wire        mon_rvfi_halt;
+	wire        mon_rvfi_intr;
+	wire [4:0]  mon_rvfi_rs1_addr;
+	wire [4:0]  mon_rvfi_rs2_addr;
+	wire [31:0] mon_rvfi_rs1_rdata;
+	wire [31:0] mon_rvfi_rs2_rdata;
+	wire [4:0]  mon_rvfi_rd_addr;
+	wire [31:0] mon_rvfi_rd_wdata;
+	wire [31:0] mon_rvfi_pc_rdata;
+	wire [31:0] mon_rvfi_pc_wdata;
+	wire [31:0] mon_rvfi_mem_addr;
+	wire [3:0]  mon_rvfi_mem_rmask;
+	wire [3:0]  mon_rvfi_mem_wmask;
+	wire [31:0] mon_rvfi_mem_rdata;
+	wire [31:0] mon_rvfi_mem_wdata;
+
+	rvfi_reorder reorder (
+		.clock              (clk              ),
+		.reset              (!resetn          ),
+		.in_rvfi_valid      (rvfi_valid       ),
+		.in_rvfi_order      (rvfi_order       ),
+		.in_rvfi_insn       (rvfi_insn        ),
+		.in_rvfi_trap       (rvfi_trap        ),
+		.in_rvfi_halt       (rvfi_halt        ),
+		.in_rvfi_intr       (rvfi_intr        ),
+		.in_rvfi_rs1_addr   (rvfi_rs1_addr    ),
+		.in_rvfi_rs2_addr   (rvfi_rs2_addr    ),
+		.in_rvfi_rs1_rdata  (rvfi_rs1_rdata   ),
+		.in_rvfi_rs2_rdata  (rvfi_rs2_rdata   ),
+		.in_rvfi_rd_addr    (rvfi_rd_addr     ),
+		.in_rvfi_rd_wdata   (rvfi_rd_wdata    ),
+		.in_rvfi_pc_rdata   (rvfi_pc_rdata    ),
+		.in_rvfi_pc_wdata   (rvfi_pc_wdata    ),
+		.in_rvfi_mem_addr   (rvfi_mem_addr    ),
+		.in_rvfi_mem_rmask  (rvfi_mem_rmask   ),
+		.in_rvfi_mem_wmask  (rvfi_mem_wmask   ),
+		.in_rvfi_mem_rdata  (rvfi_mem_rdata   ),
+		.in_rvfi_mem_wdata  (rvfi_mem_wdata   ),
+		.out_rvfi_valid     (mon_rvfi_valid   ),
+		.out_rvfi_order     (mon_rvfi_order   ),
+		.out_rvfi_insn      (mon_rvfi_insn    ),
+		.out_rvfi_trap      (mon_rvfi_trap    ),
+		.out_rvfi_halt      (mon_rvfi_halt    ),
+		.out_rvfi_intr      (mon_rvfi_intr    ),
+		.out_rvfi_rs1_addr  (mon_rvfi_rs1_addr),
+		.out_rvfi_rs2_addr  (mon_rvfi_rs2_addr),
+		.out_rvfi_rs1_rdata (mon_rvfi_rs1_rdata),
+		.out_rvfi_rs2_rdata (mon_rvfi_rs2_rdata),
+		.out_rvfi_rd_addr   (mon_rvfi_rd_addr ),
+		.out_rvfi_rd_wdata  (mon_rvfi_rd_wdata),
+		.out_rvfi_pc_rdata  (mon_rvfi_pc_rdata),
+		.out_rvfi_pc_wdata  (mon_rvfi_pc_wdata),
+		.out_rvfi_mem_addr  (mon_rvfi_mem_addr),
+		.out_rvfi_mem_rmask (mon_rvfi_mem_rmask),
+		.out_rvfi_mem_wmask (mon_rvfi_mem_wmask),
+		.out_rvfi_mem_rdata (mon_rvfi_mem_rdata),
+		.out_rvfi_mem_wdata (mon_rvfi_mem_wdata)
+	);
+
 	picorv32_rvfimon rvfi_monitor (
-		.clock          (clk           ),
-		.reset          (!resetn       ),
-		.rvfi_valid     (rvfi_valid    ),
-		.rvfi_order     (rvfi_order    ),
-		.rvfi_insn      (rvfi_insn     ),
-		.rvfi_trap      (rvfi_trap     ),
-		.rvfi_halt      (rvfi_halt     ),
-		.rvfi_intr      (rvfi_intr     ),
-		.rvfi_rs1_addr  (rvfi_rs1_addr ),
-		.rvfi_rs2_addr  (rvfi_rs2_addr ),
-		.rvfi_rs1_rdata (rvfi_rs1_rdata),
-		.rvfi_rs2_rdata (rvfi_rs2_rdata),
-		.rvfi_rd_addr   (rvfi_rd_addr  ),
-		.rvfi_rd_wdata  (rvfi_rd_wdata ),
-		.rvfi_pc_rdata  (rvfi_pc_rdata ),
-		.rvfi_pc_wdata  (rvfi_pc_wdata ),
-		.rvfi_mem_addr  (rvfi_mem_addr ),
-		.rvfi_mem_rmask (rvfi_mem_rmask),
-		.rvfi_mem_wmask (rvfi_mem_wmask),
-		.rvfi_mem_rdata (rvfi_mem_rdata),
-		.rvfi_mem_wdata (rvfi_mem_wdata)
+		.clock          (clk               ),
+		.reset          (!resetn           ),
+		.rvfi_valid     (mon_rvfi_valid    ),
+		.rvfi_order     (mon_rvfi_order    ),
+		.rvfi_insn      (mon_rvfi_insn     ),
+		.rvfi_trap      (mon_rvfi_trap     ),
+		.rvfi_halt      (mon_rvfi_halt     ),
+		.rvfi_intr      (mon_rvfi_intr     ),
+		.rvfi_rs1_addr  (mon_rvfi_rs1_addr ),
+		.rvfi_rs2_addr  (mon_rvfi_rs2_addr ),
+		.rvfi_rs1_rdata (mon_rvfi_rs1_rdata),
+		.rvfi_rs2_rdata (mon_rvfi_rs2_rdata),
+		.rvfi_rd_addr   (mon_rvfi_rd_addr  ),
+		.rvfi_rd_wdata  (mon_rvfi_rd_wdata ),
+		.rvfi_pc_rdata  (mon_rvfi_pc_rdata ),
+		.rvfi_pc_wdata  (mon_rvfi_pc_wdata ),
+		.rvfi_mem_addr  (mon_rvfi_mem_addr ),
+		.rvfi_mem_rmask (mon_rvfi_mem_rmask),
+		.rvfi_mem_wmask (mon_rvfi_mem_wmask),
+		.rvfi_mem_rdata (mon_rvfi_mem_rdata),
+		.rvfi_mem_wdata (mon_rvfi_mem_wdata)
 	);
 `endif
+`endif
 
+`ifndef NO_READMEMH
+	// Verilator testbenches built with -DNO_READMEMH load the program into
+	// mem.memory themselves (testbench_loader.h)
 	reg [1023:0] firmware_file;
 	initial begin
 		if (!$value$plusargs("firmware=%s", firmware_file))
 			firmware_file = "firmware/firmware.hex";
 		$readmemh(firmware_file, mem.memory);
 	end
+`endif
 
-	integer cycle_counter;
+	integer cycle_counter /* verilator public_flat_rw */;
 	always @(posedge clk) begin
 		cycle_counter <= resetn ? cycle_counter + 1 : 0;
 		if (resetn && trap) begin
@@ -274,6 +396,101 @@ module picorv32_wrapper #(
 	end
 endmodule
 
+// Puts RVFI commits back in rvfi_order. Each commit is stored in the slot
+// of its rvfi_order and the slot of the next expected order is sent on in
+// the cycle after it arrives. DEPTH must cover the commits that can
+// overtake a DECOUPLED_PCPI instruction.
+module rvfi_reorder #(
+	parameter DEPTH_BITS = 5
+) (
+	input clock,
+	input reset,
+
+	input             in_rvfi_valid,
+	input      [63:0] in_rvfi_order,
+	input      [31:0] in_rvfi_insn,
+	input             in_rvfi_trap,
+	input             in_rvfi_halt,
+	input             in_rvfi_intr,
+	input      [ 4:0] in_rvfi_rs1_addr,
+	input      [ 4:0] in_rvfi_rs2_addr,
+	input      [31:0] in_rvfi_rs1_rdata,
+	input      [31:0] in_rvfi_rs2_rdata,
+	input      [ 4:0] in_rvfi_rd_addr,
+	input      [31:0] in_rvfi_rd_wdata,
+	input      [31:0] in_rvfi_pc_rdata,
+	input      [31:0] in_rvfi_pc_wdata,
+	input      [31:0] in_rvfi_mem_addr,
+	input      [ 3:0] in_rvfi_mem_rmask,
+	input      [ 3:0] in_rvfi_mem_wmask,
+	input      [31:0] in_rvfi_mem_rdata,
+	input      [31:0] in_rvfi_mem_wdata,
+
+	output reg        out_rvfi_valid,
+	output reg [63:0] out_rvfi_order,
+	output reg [31:0] out_rvfi_insn,
+	output reg        out_rvfi_trap,
+	output reg        out_rvfi_halt,
+	output reg        out_rvfi_intr,
+	output reg [ 4:0] out_rvfi_rs1_addr,
+	output reg [ 4:0] out_rvfi_rs2_addr,
+	output reg [31:0] out_rvfi_rs1_rdata,
+	output reg [31:0] out_rvfi_rs2_rdata,
+	output reg [ 4:0] out_rvfi_rd_addr,
+	output reg [31:0] out_rvfi_rd_wdata,
+	output reg [31:0] out_rvfi_pc_rdata,
+	output reg [31:0] out_rvfi_pc_wdata,
+	output reg [31:0] out_rvfi_mem_addr,
+	output reg [ 3:0] out_rvfi_mem_rmask,
+	output reg [ 3:0] out_rvfi_mem_wmask,
+	output reg [31:0] out_rvfi_mem_rdata,
+	output reg [31:0] out_rvfi_mem_wdata
+);
+	localparam DEPTH = 1 << DEPTH_BITS;
+
+	reg [377:0] records [0:DEPTH-1];
+	reg [DEPTH-1:0] pending;
+	reg [63:0] next_order;
+
+	wire [DEPTH_BITS-1:0] in_slot = in_rvfi_order;
+	wire [DEPTH_BITS-1:0] out_slot = next_order;
+
+	wire [377:0] in_record = {in_rvfi_order, in_rvfi_insn, in_rvfi_trap, in_rvfi_halt, in_rvfi_intr,
+			in_rvfi_rs1_addr, in_rvfi_rs2_addr, in_rvfi_rs1_rdata, in_rvfi_rs2_rdata,
+			in_rvfi_rd_addr, in_rvfi_rd_wdata, in_rvfi_pc_rdata, in_rvfi_pc_wdata,
+			in_rvfi_mem_addr, in_rvfi_mem_rmask, in_rvfi_mem_wmask, in_rvfi_mem_rdata,
+			in_rvfi_mem_wdata};
+
+	always @(posedge clock) begin
+		out_rvfi_valid <= 0;
+
+		if (reset) begin
+			pending <= 0;
+			next_order <= 0;
+		end else begin
+			if (in_rvfi_valid) begin
+				if (in_rvfi_order - next_order >= DEPTH) begin
+					$display("RVFI REORDER ERROR: order %0d arrived while waiting for %0d", in_rvfi_order, next_order);
+					$stop;
+				end
+				records[in_slot] <= in_record;
+				pending[in_slot] <= 1;
+			end
+
+			if (pending[out_slot]) begin
+				out_rvfi_valid <= 1;
+				{out_rvfi_order, out_rvfi_insn, out_rvfi_trap, out_rvfi_halt, out_rvfi_intr,
+					out_rvfi_rs1_addr, out_rvfi_rs2_addr, out_rvfi_rs1_rdata, out_rvfi_rs2_rdata,
+					out_rvfi_rd_addr, out_rvfi_rd_wdata, out_rvfi_pc_rdata, out_rvfi_pc_wdata,
+					out_rvfi_mem_addr, out_rvfi_mem_rmask, out_rvfi_mem_wmask, out_rvfi_mem_rdata,
+					out_rvfi_mem_wdata} <= records[out_slot];
+				pending[out_slot] <= 0;
+				next_order <= next_order + 1;
+			end
+		end
+	end
+endmodule
+
 module axi4_memory #(
 	parameter AXI_TEST = 0,
 	parameter VERBOSE = 0
@@ -306,6 +523,22 @@ module axi4_memory #(
 	output reg        tests_passed
 );
 	reg [31:0]   memory [0:128*1024/4-1] /* verilator public */;
+
+	// Block device registers at 0x3000_0000 (see firmware/blkdev.c):
+	//   0x00 CMD      1 = read COUNT blocks from BLOCK to ADDR, 2 = write
+	//   0x04 STATUS   0 = idle, 1 = busy, 2 = error
+	//   0x08 BLOCK, 0x0c COUNT, 0x10 ADDR
+	//   0x14 NBLOCKS, 0x18 BLKSIZE (read-only)
+	// Commands are carried out by testbench_cli --blkdev=FILE, which polls
+	// STATUS. Without a backing file NBLOCKS is 0 and every command fails.
+	reg [31:0]   blkdev_regs [0:7] /* verilator public */;
+	initial begin : blkdev_init
+		integer i;
+		for (i = 0; i < 8; i = i+1)
+			blkdev_regs[i] = 0;
+		blkdev_regs[6] = 512;
+	end
+
 	reg verbose;
 	initial verbose = $test$plusargs("verbose") || VERBOSE;
 
@@ -387,6 +620,11 @@ module axi4_memory #(
 			mem_axi_rdata <= memory[latched_raddr >> 2];
 			mem_axi_rvalid <= 1;
 			latched_raddr_en = 0;
+		end else
+		if (latched_raddr[31:5] == 32'h3000_0000 >> 5) begin
+			mem_axi_rdata <= blkdev_regs[latched_raddr[4:2]];
+			mem_axi_rvalid <= 1;
+			latched_raddr_en = 0;
 		end else begin
 			$display("OUT-OF-BOUNDS MEMORY READ FROM %08x", latched_raddr);
 			$finish;
@@ -418,6 +656,21 @@ module axi4_memory #(
 		if (latched_waddr == 32'h2000_0000) begin
 			if (latched_wdata == 123456789)
 				tests_passed = 1;
+		end else
+		if (latched_waddr == 32'h2000_0004 || latched_waddr == 32'h2000_0008 || latched_waddr == 32'h2000_000c) begin
+			// Region-of-interest begin/end/bytes markers (ROI_BEGIN/ROI_END/
+			// ROI_BYTES in firmware/firmware.h), evaluated by testbench_cli
+			if (verbose)
+				$display("ROI %0s: %0d", latched_waddr[3:2] == 3 ? "BYTES" : latched_waddr[3] ? "END" : "BEGIN", latched_wdata);
+		end else
+		if (latched_waddr[31:5] == 32'h3000_0000 >> 5) begin
+			case (latched_waddr[4:2])
+				0: begin
+					blkdev_regs[0] <= latched_wdata;
+					blkdev_regs[1] <= blkdev_regs[5] ? 1 : 2;
+				end
+				2, 3, 4: blkdev_regs[latched_waddr[4:2]] <= latched_wdata;
+			endcase
 		end else begin
 			$display("OUT-OF-BOUNDS MEMORY WRITE TO %08x", latched_waddr);
 			$finish;
@@ -1,20 +1,52 @@
 // PicoRV32 CLI Testbench - Similar to Spike/Rocket
 // Usage: ./testbench_cli [options] <elf_file>
+// (a raw binary image, loaded at address 0, works as well)
 // Options:
 //   +vcd           - Generate VCD waveform
 //   +trace         - Generate instruction trace
 //   +verbose       - Verbose output
 //   --timeout=N    - Set timeout in cycles (default: 1000000)
+//   --hash-interval=K      - Write a rolling architectural state hash every K instructions
+//   --hash-file=FILE       - Output file for --hash-interval (default: testbench.hash)
+//   --hash-window=A:B      - Only hash/log instructions A..B-1 and stop after B
+//   --commit-log=FILE      - Write one line per committed instruction (RVFI)
+//   --rvfi-log=FILE        - Record the commit stream in the columnar format of scripts/rvfilog
+//   --idle-skip            - Fast-forward over cycles spent idle in waitirq
+//   --signature=FILE       - At halt, dump begin_signature..end_signature to FILE
+//   --coverage=FILE        - Write functional coverage bins to FILE (see Coverage)
+//   --memtrace=FILE        - Record every memory transfer to FILE (scripts/cachesim/memtrace.h)
+//   --blkdev=FILE          - Back the block device at 0x3000_0000 with FILE (see BlockDevice)
+//   --timeline=FILE        - Write a Perfetto/Chrome timeline trace to FILE (see TimelineWriter)
+//   --roi-only[=ID]        - Only trace (VCD, +trace, commit/RVFI log, memtrace, timeline) inside ROIs (see RoiTracker)
+//   --hang                 - Stop early on hangs/livelocks (see HangDetector)
+//   --hang-selfloop=N, --hang-noretire=N, --hang-statehash=N, --hang-noprogress=N
+//                          - Enable a single hang detector with limit N
+//
+// Exit codes: 0 finished, 1 error, 2 timeout, 3 hang detected
+//
+// The commit stream is taken from the RVFI port of the core, so this testbench
+// must be built with -DRISCV_FORMAL (see the testbench_cli target in Makefile).
 
 #include "Vpicorv32_wrapper.h"
 #include "Vpicorv32_wrapper_picorv32_wrapper.h"
 #include "Vpicorv32_wrapper_axi4_memory.h"
+#if VM_TRACE
 #include "verilated_vcd_c.h"
+#endif
+#include "verilated_vpi.h"
+#include "testbench_loader.h"
+#include "scripts/cachesim/memtrace.h"
+#include "scripts/rvfilog/rvfilog.h"
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <string>
-#include <elf.h>
+#include <cinttypes>
+#include <chrono>
+#include <algorithm>
+#include <vector>
+#include <map>
+#include <unordered_map>
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/stat.h>
@@ -25,110 +57,1173 @@
 #define MEM_SIZE (128 * 1024)
 #define MEM_WORDS (MEM_SIZE / 4)
 
-class ElfLoader {
+bool dump_signature(const char* filename, const ElfLoader& loader, const uint32_t* memory) {
+    uint32_t begin, end;
+    if (!loader.find_symbol("begin_signature", &begin) || !loader.find_symbol("end_signature", &end)) {
+        fprintf(stderr, "Error: ELF file has no begin_signature/end_signature symbols\n");
+        return false;
+    }
+    if (begin > end || end > MEM_SIZE || (begin & 3) || (end & 3)) {
+        fprintf(stderr, "Error: Invalid signature region 0x%08x..0x%08x\n", begin, end);
+        return false;
+    }
+    FILE* f = fopen(filename, "w");
+    if (!f) {
+        fprintf(stderr, "Error: Cannot open signature file '%s'\n", filename);
+        return false;
+    }
+    for (uint32_t addr = begin; addr < end; addr += 4)
+        fprintf(f, "%08x\n", memory[addr >> 2]);
+    fclose(f);
+    printf("Signature 0x%08x..0x%08x -> %s\n", begin, end, filename);
+    return true;
+}
+
+// splitmix64 finalizer, used for all state hashes below
+static inline uint64_t hash_mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+// One committed instruction, as reported by the RVFI port of the core
+struct CommitRecord {
+    uint64_t order;
+    uint64_t cycle;
+    uint32_t insn;
+    uint32_t pc_rdata, pc_wdata;
+    uint32_t rs1_addr, rs1_rdata;
+    uint32_t rs2_addr, rs2_rdata;
+    uint32_t rd_addr, rd_wdata;
+    uint32_t mem_addr, mem_rmask, mem_wmask;
+    uint32_t mem_rdata, mem_wdata;
+    bool trap, intr;
+
+    void sample(const Vpicorv32_wrapper_picorv32_wrapper* w, uint64_t now) {
+        order = w->rvfi_order;
+        cycle = now;
+        insn = w->rvfi_insn;
+        pc_rdata = w->rvfi_pc_rdata;
+        pc_wdata = w->rvfi_pc_wdata;
+        rs1_addr = w->rvfi_rs1_addr;
+        rs1_rdata = w->rvfi_rs1_rdata;
+        rs2_addr = w->rvfi_rs2_addr;
+        rs2_rdata = w->rvfi_rs2_rdata;
+        rd_addr = w->rvfi_rd_addr;
+        rd_wdata = w->rvfi_rd_wdata;
+        mem_addr = w->rvfi_mem_addr;
+        mem_rmask = w->rvfi_mem_rmask;
+        mem_wmask = w->rvfi_mem_wmask;
+        mem_rdata = w->rvfi_mem_rdata;
+        mem_wdata = w->rvfi_mem_wdata;
+        trap = w->rvfi_trap;
+        intr = w->rvfi_intr;
+    }
+
+    // Bit mask of the bytes written by a store
+    uint32_t write_mask() const {
+        uint32_t mask = 0;
+        for (int i = 0; i < 4; i++)
+            if (mem_wmask & (1 << i))
+                mask |= 0xffu << (8 * i);
+        return mask;
+    }
+
+    // Instructions whose result depends on the cycle count rather than on
+    // the program: rdcycle[h], rdtime[h] and the picorv32 timer and waitirq
+    // instructions
+    bool timing_dependent() const {
+        if ((insn & 0x707f) == 0x2073) {
+            uint32_t csr = insn >> 20;
+            return csr == 0xc00 || csr == 0xc80 || csr == 0xc01 || csr == 0xc81;
+        }
+        return (insn & 0xfe00007f) == 0x0a00000b || (insn & 0xfe00007f) == 0x0800000b;
+    }
+
+    RvfiLogRecord log_record() const {
+        RvfiLogRecord r;
+        r.order = order;
+        r.cycle = cycle;
+        r.insn = insn;
+        r.pc_rdata = pc_rdata;
+        r.pc_wdata = pc_wdata;
+        r.rs1_addr = rs1_addr;
+        r.rs1_rdata = rs1_rdata;
+        r.rs2_addr = rs2_addr;
+        r.rs2_rdata = rs2_rdata;
+        r.rd_addr = rd_addr;
+        r.rd_wdata = rd_wdata;
+        r.mem_addr = mem_addr;
+        r.mem_rmask = mem_rmask;
+        r.mem_wmask = mem_wmask;
+        r.mem_rdata = mem_rdata;
+        r.mem_wdata = mem_wdata;
+        r.trap = trap;
+        r.intr = intr;
+        return r;
+    }
+
+    // Format: order cycle pc insn rs1:val rs2:val rd:val addr rmask wmask rdata wdata next_pc flags
+    void print(FILE* f) const {
+        fprintf(f, "%" PRIu64 " %" PRIu64 " %08x %08x x%u:%08x x%u:%08x x%u:%08x %08x %x %x %08x %08x %08x %s%s\n",
+                order, cycle, pc_rdata, insn, rs1_addr, rs1_rdata, rs2_addr, rs2_rdata,
+                rd_addr, rd_wdata, mem_addr, mem_rmask, mem_wmask, mem_rdata, mem_wdata,
+                pc_wdata, intr ? "I" : "-", trap ? "T" : "-");
+    }
+};
+
+// Puts the commits back in rvfi_order. With DECOUPLED_PCPI a multiply or
+// divide left on the co-processor is reported when its result is written
+// back, after the younger instructions (see dbg_pcpi_defer in picorv32.v).
+// These wait here until it arrives.
+class CommitReorder {
+private:
+    std::map<uint64_t, CommitRecord> pending;
+    CommitRecord head;
+    bool have_head;
+    uint64_t next;
+
+public:
+    CommitReorder() : have_head(false), next(0) {}
+
+    void push(const CommitRecord& c) {
+        if (c.order == next && !have_head) {
+            head = c;
+            have_head = true;
+        } else {
+            pending[c.order] = c;
+        }
+    }
+
+    // Next commit in order, if it has been reported
+    bool pop(CommitRecord& c) {
+        if (!have_head) {
+            auto it = pending.find(next);
+            if (it == pending.end())
+                return false;
+            head = it->second;
+            pending.erase(it);
+        }
+        c = head;
+        have_head = false;
+        next++;
+        return true;
+    }
+
+    size_t waiting() const { return pending.size(); }
+};
+
+// Rolling hash over the architectural effects of the committed instruction
+// stream: PC, register writes and memory writes. Two runs that have the same
+// hash after N instructions have (with overwhelming probability) executed the
+// same first N instructions, so the first differing checkpoint brackets the
+// first divergence. Cycle counts are deliberately not part of the hash.
+class StateHasher {
+private:
+    uint64_t hash;
+
+    void add(uint64_t x) {
+        hash = hash_mix(hash ^ x);
+    }
+
+public:
+    StateHasher() : hash(0) {}
+
+    void commit(const CommitRecord& c) {
+        add(((uint64_t)c.insn << 32) | c.pc_rdata);
+        add(((uint64_t)c.intr << 63) | ((uint64_t)c.trap << 62) | c.pc_wdata);
+        if (c.rd_addr != 0) {
+            uint32_t wdata = c.timing_dependent() ? 0 : c.rd_wdata;
+            add(((uint64_t)c.rd_addr << 32) | wdata);
+        }
+        if (c.mem_wmask != 0) {
+            add(((uint64_t)c.mem_wmask << 32) | c.mem_addr);
+            add(c.mem_wdata & c.write_mask());
+        }
+    }
+
+    uint64_t value() const { return hash; }
+};
+
+// Shadow copy of the architectural state (PC, registers and RAM), kept up to
+// date from the commit stream. hash() covers the whole state; it is an XOR of
+// per-location hashes so that it can be updated in O(1) per instruction.
+class ArchState {
+private:
+    uint32_t regs[32];
+    std::vector<uint32_t> mem;
+    uint64_t reg_hash;
+    uint64_t mem_hash;
+
+    static uint64_t entry(uint64_t where, uint32_t value) {
+        return hash_mix((where << 32) ^ value ^ 0x5bd1e995);
+    }
+
+public:
+    uint32_t pc;
+
+    ArchState() : mem(MEM_WORDS), reg_hash(0), mem_hash(0), pc(0) {
+        memset(regs, 0, sizeof(regs));
+    }
+
+    void init(const uint32_t* memory) {
+        memcpy(mem.data(), memory, MEM_SIZE);
+        mem_hash = 0;
+        for (uint32_t i = 0; i < MEM_WORDS; i++)
+            if (mem[i])
+                mem_hash ^= entry(i, mem[i]);
+    }
+
+    // Returns true if the instruction changed RAM or wrote to an I/O address
+    bool commit(const CommitRecord& c) {
+        pc = c.pc_wdata;
+        if (c.rd_addr != 0 && regs[c.rd_addr] != c.rd_wdata) {
+            reg_hash ^= entry(0x10000 | c.rd_addr, regs[c.rd_addr]) ^ entry(0x10000 | c.rd_addr, c.rd_wdata);
+            regs[c.rd_addr] = c.rd_wdata;
+        }
+        if (c.mem_wmask == 0)
+            return false;
+        if (c.mem_addr >= MEM_SIZE)
+            return true;
+        uint32_t index = c.mem_addr >> 2;
+        uint32_t mask = c.write_mask();
+        uint32_t value = (mem[index] & ~mask) | (c.mem_wdata & mask);
+        if (value == mem[index])
+            return false;
+        mem_hash ^= entry(index, mem[index]) ^ entry(index, value);
+        mem[index] = value;
+        return true;
+    }
+
+    uint32_t reg(int i) const { return regs[i]; }
+    uint64_t hash() const { return hash_mix(pc) ^ reg_hash ^ mem_hash; }
+};
+
+// Detectors for runs that will never finish, so that they can be stopped
+// long before --timeout:
+//  - selfloop:   a jump to itself (e.g. "j .") taken N times in a row while
+//                no testbench IRQ can interrupt the core
+//  - noretire:   no instruction retired for N cycles (not counting cycles
+//                the core waits in waitirq)
+//  - statehash:  the full architectural state, sampled every N instructions,
+//                repeats. While IRQs are enabled the repeat must span at least
+//                two periods of the testbench IRQ stimulus without an IRQ.
+//  - noprogress: N instructions without console output or a change to memory
+class HangDetector {
+private:
+    uint64_t selfloop_count;
+    uint64_t noretire_count;
+    uint64_t noprogress_count;
+    std::unordered_map<uint64_t, uint64_t> seen_states;
+    CommitRecord history[16];
+    uint64_t history_count;
+
+public:
+    static const int EXIT_CODE = 3;
+    // irq[5] of testbench.v fires when the 16-bit count_cycle wraps
+    static const uint64_t IRQ_PERIOD = 1 << 16;
+
+    uint64_t selfloop_limit;
+    uint64_t noretire_limit;
+    uint64_t statehash_interval;
+    uint64_t noprogress_limit;
+    const char* reason;
+
+    HangDetector() : selfloop_count(0), noretire_count(0), noprogress_count(0), history_count(0),
+            selfloop_limit(0), noretire_limit(0), statehash_interval(0), noprogress_limit(0), reason(nullptr) {}
+
+    bool enabled() const {
+        return selfloop_limit || noretire_limit || statehash_interval || noprogress_limit;
+    }
+
+    void enable_defaults() {
+        if (!selfloop_limit) selfloop_limit = 16;
+        if (!noretire_limit) noretire_limit = 100000;
+        if (!statehash_interval) statehash_interval = 100000;
+        if (!noprogress_limit) noprogress_limit = 100000000;
+    }
+
+    // Called once per clock cycle
+    void cycle(bool retired, bool idle) {
+        if (retired || idle)
+            noretire_count = 0;
+        else if (noretire_limit && ++noretire_count >= noretire_limit)
+            reason = "no instruction retired";
+    }
+
+    // Called for each committed instruction
+    void commit(const CommitRecord& c, uint64_t instret, bool progress, bool irqs_blocked, const ArchState& state) {
+        history[history_count++ % 16] = c;
+
+        if (c.intr)
+            seen_states.clear();
+
+        if (c.pc_wdata == c.pc_rdata && !c.trap && irqs_blocked) {
+            if (selfloop_limit && ++selfloop_count >= selfloop_limit)
+                reason = "tight self-loop";
+        } else
+            selfloop_count = 0;
+
+        if (statehash_interval && instret % statehash_interval == 0) {
+            auto it = seen_states.find(state.hash());
+            if (it == seen_states.end())
+                seen_states[state.hash()] = c.cycle;
+            else if (irqs_blocked || c.cycle - it->second >= 2 * IRQ_PERIOD)
+                reason = "repeated architectural state";
+        }
+
+        if (progress)
+            noprogress_count = 0;
+        else if (noprogress_limit && ++noprogress_count >= noprogress_limit)
+            reason = "no console or memory progress";
+    }
+
+    void print_snapshot(const ArchState& state) const {
+        printf("\nHang detected: %s\n", reason);
+        printf("  PC: 0x%08x\n", state.pc);
+        for (int i = 0; i < 32; i++)
+            printf("  x%-2d %08x%s", i, state.reg(i), i % 4 == 3 ? "\n" : "");
+        printf("  Last committed instructions (order cycle pc insn rs1 rs2 rd mem_addr rmask wmask rdata wdata next_pc flags):\n");
+        uint64_t first = history_count > 16 ? history_count - 16 : 0;
+        for (uint64_t i = first; i < history_count; i++) {
+            printf("    ");
+            history[i % 16].print(stdout);
+        }
+    }
+};
+
+// Fast-forward over cycles in which the core is parked in waitirq (see
+// picorv32_waitirq_insn in firmware/custom_ops.S). While idle_waitirq is set
+// in testbench.v only the cycle counters and the IRQ timer change, so they
+// can be advanced in one step to just before the next IRQ event: irq[4] or
+// irq[5] from the count_cycle stimulus in picorv32_wrapper, or the core timer
+// reaching zero. The counters are written through VPI (verilator --vpi, the
+// public_flat_rw signals in testbench.v and, for the core, testbench_cli.vlt).
+class IdleSkipper {
+private:
+    vpiHandle core_count_cycle;
+    vpiHandle core_timer;
+    vpiHandle tb_count_cycle;
+    vpiHandle tb_cycle_counter;
+    bool idle_q;
+
+    static vpiHandle lookup(const char* name) {
+        vpiHandle h = vpi_handle_by_name((PLI_BYTE8*)name, NULL);
+        if (!h)
+            fprintf(stderr, "Error: VPI signal '%s' not found\n", name);
+        return h;
+    }
+
+    static uint64_t get(vpiHandle h) {
+        s_vpi_value val;
+        val.format = vpiVectorVal;
+        vpi_get_value(h, &val);
+        uint64_t x = val.value.vector[0].aval;
+        if (vpi_get(vpiSize, h) > 32)
+            x |= (uint64_t)val.value.vector[1].aval << 32;
+        return x;
+    }
+
+    static void put(vpiHandle h, uint64_t x) {
+        s_vpi_vecval vec[2] = {{(PLI_UINT32)x, 0}, {(PLI_UINT32)(x >> 32), 0}};
+        s_vpi_value val;
+        val.format = vpiVectorVal;
+        val.value.vector = vec;
+        vpi_put_value(h, &val, NULL, vpiNoDelay);
+    }
+
+public:
+    uint64_t skipped_cycles;
+    uint64_t jumps;
+
+    IdleSkipper() : core_count_cycle(NULL), core_timer(NULL), tb_count_cycle(NULL),
+            tb_cycle_counter(NULL), idle_q(false), skipped_cycles(0), jumps(0) {}
+
+    bool init() {
+        core_count_cycle = lookup("TOP.picorv32_wrapper.uut.picorv32_core.count_cycle");
+        core_timer = lookup("TOP.picorv32_wrapper.uut.picorv32_core.timer");
+        tb_count_cycle = lookup("TOP.picorv32_wrapper.count_cycle");
+        tb_cycle_counter = lookup("TOP.picorv32_wrapper.cycle_counter");
+        return core_count_cycle && core_timer && tb_count_cycle && tb_cycle_counter;
+    }
+
+    // Called after each rising edge, returns the number of cycles skipped
+    uint64_t skip(const Vpicorv32_wrapper_picorv32_wrapper* w) {
+        // Require two idle cycles in a row so that the waitirq loop is settled
+        bool idle = w->idle_waitirq;
+        bool settled = idle && idle_q;
+        idle_q = idle;
+        if (!settled)
+            return 0;
+
+        // Rising edges until irq[4] = &count_cycle[12:0] or irq[5] = &count_cycle[15:0]
+        uint64_t count = get(tb_count_cycle);
+        uint64_t n = std::min((0x1fff - count) & 0x1fff, (0xffff - count) & 0xffff);
+
+        // The timer raises its IRQ on the edge where it counts down from 1
+        uint64_t timer = get(core_timer);
+        if (timer)
+            n = std::min(n, timer - 1);
+
+        // Leave the last cycle before the event to the simulation
+        if (n <= 1)
+            return 0;
+        n -= 1;
+
+        put(tb_count_cycle, (count + n) & 0xffff);
+        put(tb_cycle_counter, get(tb_cycle_counter) + n);
+        put(core_count_cycle, get(core_count_cycle) + n);
+        if (timer)
+            put(core_timer, timer - n);
+
+        skipped_cycles += n;
+        jumps++;
+        return n;
+    }
+};
+
+// Block device backed by a host file (--blkdev=FILE). The firmware programs
+// the registers in axi4_memory (testbench.v, see also firmware/blkdev.c) and
+// writes CMD, which sets STATUS to busy. poll() then copies the blocks
+// between the mmap'ed file and the simulated RAM with a single memcpy and
+// sets STATUS back to idle (or error for an out-of-range request).
+// "make test_blkdev" runs a read/write round trip (firmware/blktest.c).
+class BlockDevice {
 private:
-    void *mapped_file;
-    size_t file_size;
     int fd;
+    uint8_t* data;
+    uint32_t nblocks;
+    bool writable;
 
 public:
-    ElfLoader() : mapped_file(nullptr), file_size(0), fd(-1) {}
-    
-    ~ElfLoader() {
-        if (mapped_file) {
-            munmap(mapped_file, file_size);
+    static const uint32_t BLOCK_SIZE = 512;
+    enum { REG_CMD, REG_STATUS, REG_BLOCK, REG_COUNT, REG_ADDR, REG_NBLOCKS, REG_BLKSIZE };
+    enum { CMD_READ = 1, CMD_WRITE = 2 };
+    enum { STATUS_IDLE = 0, STATUS_BUSY = 1, STATUS_ERROR = 2 };
+
+    uint64_t blocks_read;
+    uint64_t blocks_written;
+
+    BlockDevice() : fd(-1), data(NULL), nblocks(0), writable(false), blocks_read(0), blocks_written(0) {}
+
+    ~BlockDevice() {
+        if (data) {
+            msync(data, (size_t)nblocks * BLOCK_SIZE, MS_SYNC);
+            munmap(data, (size_t)nblocks * BLOCK_SIZE);
         }
-        if (fd >= 0) {
+        if (fd >= 0)
             close(fd);
-        }
     }
 
-    bool load(const char* filename, uint32_t* memory) {
-        // Open ELF file
-        fd = open(filename, O_RDONLY);
+    bool open(const char* filename) {
+        writable = true;
+        fd = ::open(filename, O_RDWR);
+        if (fd < 0) {
+            writable = false;
+            fd = ::open(filename, O_RDONLY);
+        }
         if (fd < 0) {
-            fprintf(stderr, "Error: Cannot open file '%s'\n", filename);
+            fprintf(stderr, "Error: Cannot open block device file '%s'\n", filename);
             return false;
         }
-
-        // Get file size
         struct stat st;
-        if (fstat(fd, &st) < 0) {
-            fprintf(stderr, "Error: Cannot stat file '%s'\n", filename);
+        if (fstat(fd, &st) < 0 || st.st_size < BLOCK_SIZE || st.st_size / BLOCK_SIZE > UINT32_MAX) {
+            fprintf(stderr, "Error: Block device file '%s' must hold 1 to 2^32-1 blocks of %u bytes\n", filename, BLOCK_SIZE);
             return false;
         }
-        file_size = st.st_size;
-
-        // Memory map the file
-        mapped_file = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
-        if (mapped_file == MAP_FAILED) {
-            fprintf(stderr, "Error: Cannot mmap file '%s'\n", filename);
+        nblocks = st.st_size / BLOCK_SIZE;
+        if (st.st_size % BLOCK_SIZE)
+            fprintf(stderr, "Warning: Ignoring the last %u bytes of '%s' (not a whole block)\n",
+                    (unsigned)(st.st_size % BLOCK_SIZE), filename);
+        void* p = mmap(NULL, (size_t)nblocks * BLOCK_SIZE, PROT_READ | (writable ? PROT_WRITE : 0), MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) {
+            fprintf(stderr, "Error: Cannot mmap block device file '%s'\n", filename);
             return false;
         }
+        data = (uint8_t*)p;
+        return true;
+    }
+
+    uint32_t size() const { return nblocks; }
+    bool read_only() const { return !writable; }
+
+    void attach(Vpicorv32_wrapper_axi4_memory* mem) {
+        mem->blkdev_regs[REG_NBLOCKS] = nblocks;
+    }
+
+    // Called once per clock cycle
+    void poll(Vpicorv32_wrapper_axi4_memory* mem) {
+        if (mem->blkdev_regs[REG_STATUS] != STATUS_BUSY)
+            return;
+        uint32_t cmd = mem->blkdev_regs[REG_CMD];
+        uint32_t block = mem->blkdev_regs[REG_BLOCK];
+        uint32_t count = mem->blkdev_regs[REG_COUNT];
+        uint32_t addr = mem->blkdev_regs[REG_ADDR];
+        uint64_t bytes = (uint64_t)count * BLOCK_SIZE;
+
+        bool ok = (cmd == CMD_READ || (cmd == CMD_WRITE && writable)) &&
+                (uint64_t)block + count <= nblocks && addr % 4 == 0 && addr + bytes <= MEM_SIZE;
+        if (ok) {
+            uint8_t* ram = (uint8_t*)mem->memory.data() + addr;
+            uint8_t* file = data + (size_t)block * BLOCK_SIZE;
+            if (cmd == CMD_READ) {
+                memcpy(ram, file, bytes);
+                blocks_read += count;
+            } else {
+                memcpy(file, ram, bytes);
+                blocks_written += count;
+            }
+        }
+        mem->blkdev_regs[REG_STATUS] = ok ? STATUS_IDLE : STATUS_ERROR;
+    }
+};
+
+// Region-of-interest markers: the firmware writes an ID to 0x2000_0004 to
+// begin and to 0x2000_0008 to end a ROI (ROI_BEGIN/ROI_END in
+// firmware/firmware.h). The markers are taken from the stores in the commit
+// stream. ROIs may nest; cycles and instructions are summed per ID. A write
+// to 0x2000_000c (ROI_BYTES) adds to the bytes processed by the innermost
+// open ROI, which are printed as cycles per byte. With
+// --roi-only, tracing is restricted to the time inside a ROI (optionally
+// only the ROI with a given ID).
+class RoiTracker {
+private:
+    struct OpenRoi {
+        uint32_t id;
+        uint64_t cycle, instret, bytes;
+    };
+    struct RoiStats {
+        uint64_t count = 0, cycles = 0, instret = 0, bytes = 0;
+    };
+    std::vector<OpenRoi> open_rois;
+    std::map<uint32_t, RoiStats> stats;
+    bool inside_q;
+
+    void update() {
+        inside_q = false;
+        for (auto& r : open_rois)
+            if (!filter || r.id == filter_id)
+                inside_q = true;
+    }
+
+    void close_roi(size_t i, uint64_t cycle, uint64_t instret) {
+        RoiStats& s = stats[open_rois[i].id];
+        s.count++;
+        s.cycles += cycle - open_rois[i].cycle;
+        s.instret += instret - open_rois[i].instret;
+        s.bytes += open_rois[i].bytes;
+        open_rois.erase(open_rois.begin() + i);
+    }
+
+public:
+    static const uint32_t BEGIN_ADDR = 0x20000004;
+    static const uint32_t END_ADDR = 0x20000008;
+    static const uint32_t BYTES_ADDR = 0x2000000c;
+
+    bool filter;
+    uint32_t filter_id;
+    uint64_t unmatched;
+
+    RoiTracker() : inside_q(false), filter(false), filter_id(0), unmatched(0) {}
+
+    // Called for each committed instruction
+    void commit(const CommitRecord& c, uint64_t instret) {
+        if (!c.mem_wmask || (c.mem_addr != BEGIN_ADDR && c.mem_addr != END_ADDR && c.mem_addr != BYTES_ADDR))
+            return;
+        if (c.mem_addr == BYTES_ADDR) {
+            if (!open_rois.empty())
+                open_rois.back().bytes += c.mem_wdata;
+            return;
+        }
+        if (c.mem_addr == BEGIN_ADDR) {
+            open_rois.push_back({c.mem_wdata, c.cycle, instret, 0});
+        } else {
+            size_t i = open_rois.size();
+            while (i > 0 && open_rois[i - 1].id != c.mem_wdata)
+                i--;
+            if (i > 0)
+                close_roi(i - 1, c.cycle, instret);
+            else
+                unmatched++;
+        }
+        update();
+    }
+
+    // Close ROIs still open when the simulation stops
+    size_t finish(uint64_t cycle, uint64_t instret) {
+        size_t n = open_rois.size();
+        while (!open_rois.empty())
+            close_roi(open_rois.size() - 1, cycle, instret);
+        update();
+        return n;
+    }
+
+    bool inside() const { return inside_q; }
+    bool empty() const { return stats.empty(); }
+
+    void print() const {
+        printf("  ROIs:\n");
+        for (auto& s : stats) {
+            printf("    %-10u %6" PRIu64 "x %12" PRIu64 " cycles %12" PRIu64 " instructions  CPI %.3f",
+                   s.first, s.second.count, s.second.cycles, s.second.instret,
+                   s.second.instret ? (double)s.second.cycles / s.second.instret : 0.0);
+            if (s.second.bytes)
+                printf("  %.1f cycles/byte", (double)s.second.cycles / s.second.bytes);
+            printf("\n");
+        }
+        if (unmatched)
+            printf("    (%" PRIu64 " ROI end markers without a matching begin)\n", unmatched);
+    }
+};
+
+// Coarse instruction classes, used for the IRQ coverage bins
+enum InsnClass { CLS_UNKNOWN, CLS_ALU, CLS_SHIFT, CLS_LOAD, CLS_STORE, CLS_BRANCH, CLS_JUMP,
+                 CLS_MULDIV, CLS_CSR, CLS_IRQ, CLS_SYSTEM, CLS_COUNT };
 
-        // Check ELF magic
-        Elf32_Ehdr* ehdr = (Elf32_Ehdr*)mapped_file;
-        if (memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0) {
-            fprintf(stderr, "Error: '%s' is not a valid ELF file\n", filename);
+static const char* const insn_class_names[CLS_COUNT] = {
+    "unknown", "alu", "shift", "load", "store", "branch", "jump", "muldiv", "csr", "irq", "system"
+};
+
+struct InsnInfo {
+    const char* name;
+    InsnClass cls;
+};
+
+// Mnemonic and class of an RV32IMC, Zicond or picorv32 custom instruction
+// (compressed instructions are passed in the low 16 bits)
+static InsnInfo decode_insn(uint32_t insn) {
+    uint32_t f3 = (insn >> 12) & 7;
+
+    if ((insn & 3) != 3) {
+        uint32_t q = insn & 3;
+        f3 = (insn >> 13) & 7;
+        uint32_t rd = (insn >> 7) & 31, rs2 = (insn >> 2) & 31;
+        bool b12 = insn & 0x1000;
+        if (q == 0 && f3 == 0) return {"c.addi4spn", CLS_ALU};
+        if (q == 0 && f3 == 2) return {"c.lw", CLS_LOAD};
+        if (q == 0 && f3 == 6) return {"c.sw", CLS_STORE};
+        if (q == 1) {
+            static const InsnInfo q1[8] = {
+                {"c.addi", CLS_ALU}, {"c.jal", CLS_JUMP}, {"c.li", CLS_ALU}, {"c.lui", CLS_ALU},
+                {nullptr, CLS_UNKNOWN}, {"c.j", CLS_JUMP}, {"c.beqz", CLS_BRANCH}, {"c.bnez", CLS_BRANCH}
+            };
+            if (f3 == 3 && rd == 2) return {"c.addi16sp", CLS_ALU};
+            if (f3 != 4) return q1[f3];
+            switch ((insn >> 10) & 3) {
+            case 0: return {"c.srli", CLS_SHIFT};
+            case 1: return {"c.srai", CLS_SHIFT};
+            case 2: return {"c.andi", CLS_ALU};
+            }
+            static const char* const alu[4] = {"c.sub", "c.xor", "c.or", "c.and"};
+            if (!b12) return {alu[(insn >> 5) & 3], CLS_ALU};
+        }
+        if (q == 2 && f3 == 0) return {"c.slli", CLS_SHIFT};
+        if (q == 2 && f3 == 2) return {"c.lwsp", CLS_LOAD};
+        if (q == 2 && f3 == 6) return {"c.swsp", CLS_STORE};
+        if (q == 2 && f3 == 4) {
+            if (!b12) return rs2 ? InsnInfo{"c.mv", CLS_ALU} : InsnInfo{"c.jr", CLS_JUMP};
+            if (!rs2) return rd ? InsnInfo{"c.jalr", CLS_JUMP} : InsnInfo{"c.ebreak", CLS_SYSTEM};
+            return {"c.add", CLS_ALU};
+        }
+        return {"unknown", CLS_UNKNOWN};
+    }
+
+    uint32_t f7 = insn >> 25;
+    switch (insn & 0x7f) {
+    case 0x37: return {"lui", CLS_ALU};
+    case 0x17: return {"auipc", CLS_ALU};
+    case 0x6f: return {"jal", CLS_JUMP};
+    case 0x67: return {"jalr", CLS_JUMP};
+    case 0x63: {
+        static const char* const names[8] = {"beq", "bne", nullptr, nullptr, "blt", "bge", "bltu", "bgeu"};
+        if (names[f3]) return {names[f3], CLS_BRANCH};
+        break;
+    }
+    case 0x03: {
+        static const char* const names[8] = {"lb", "lh", "lw", nullptr, "lbu", "lhu", nullptr, nullptr};
+        if (names[f3]) return {names[f3], CLS_LOAD};
+        break;
+    }
+    case 0x23: {
+        static const char* const names[8] = {"sb", "sh", "sw", nullptr, nullptr, nullptr, nullptr, nullptr};
+        if (names[f3]) return {names[f3], CLS_STORE};
+        break;
+    }
+    case 0x13: {
+        static const char* const names[8] = {"addi", "slli", "slti", "sltiu", "xori", "srli", "ori", "andi"};
+        // Zbkb (ENABLE_BITMANIP): PCPI instructions like mul/div, so CLS_MULDIV
+        uint32_t imm = insn >> 20;
+        if (f3 == 5 && f7 == 0x30) return {"rori", CLS_MULDIV};
+        if (f3 == 5 && imm == 0x687) return {"brev8", CLS_MULDIV};
+        if (f3 == 5 && imm == 0x698) return {"rev8", CLS_MULDIV};
+        if ((f3 == 1 || f3 == 5) && imm == 0x08f) return {f3 == 1 ? "zip" : "unzip", CLS_MULDIV};
+        if (f3 == 1 || f3 == 5)
+            return {f3 == 5 && (insn & 0x40000000) ? "srai" : names[f3], CLS_SHIFT};
+        return {names[f3], CLS_ALU};
+    }
+    case 0x33: {
+        if (f7 == 1) {
+            static const char* const names[8] = {"mul", "mulh", "mulhsu", "mulhu", "div", "divu", "rem", "remu"};
+            return {names[f3], CLS_MULDIV};
+        }
+        static const char* const names[8] = {"add", "sll", "slt", "sltu", "xor", "srl", "or", "and"};
+        if (f3 == 0 && f7 == 0x20) return {"sub", CLS_ALU};
+        if (f3 == 5 && f7 == 0x20) return {"sra", CLS_SHIFT};
+        if (f3 == 5 && f7 == 7) return {"czero.eqz", CLS_ALU};
+        if (f3 == 7 && f7 == 7) return {"czero.nez", CLS_ALU};
+        // Zbc, Zbkb and Zbkx (ENABLE_BITMANIP)
+        switch (f7 << 3 | f3) {
+        case 0x05 << 3 | 1: return {"clmul", CLS_MULDIV};
+        case 0x05 << 3 | 2: return {"clmulr", CLS_MULDIV};
+        case 0x05 << 3 | 3: return {"clmulh", CLS_MULDIV};
+        case 0x20 << 3 | 4: return {"xnor", CLS_MULDIV};
+        case 0x20 << 3 | 6: return {"orn", CLS_MULDIV};
+        case 0x20 << 3 | 7: return {"andn", CLS_MULDIV};
+        case 0x30 << 3 | 1: return {"rol", CLS_MULDIV};
+        case 0x30 << 3 | 5: return {"ror", CLS_MULDIV};
+        case 0x04 << 3 | 4: return {"pack", CLS_MULDIV};
+        case 0x04 << 3 | 7: return {"packh", CLS_MULDIV};
+        case 0x14 << 3 | 2: return {"xperm4", CLS_MULDIV};
+        case 0x14 << 3 | 4: return {"xperm8", CLS_MULDIV};
+        }
+        if (f7 == 0) return {names[f3], f3 == 1 || f3 == 5 ? CLS_SHIFT : CLS_ALU};
+        break;
+    }
+    case 0x0f: return {"fence", CLS_SYSTEM};
+    case 0x73:
+        if (insn == 0x00000073) return {"ecall", CLS_SYSTEM};
+        if (insn == 0x00100073) return {"ebreak", CLS_SYSTEM};
+        if (f3 == 2) return {"rdcsr", CLS_CSR};
+        break;
+    case 0x0b: {
+        static const char* const names[6] = {"getq", "setq", "retirq", "maskirq", "waitirq", "timer"};
+        if (f7 < 6) return {names[f7], CLS_IRQ};
+        break;
+    }
+    }
+    return {"unknown", CLS_UNKNOWN};
+}
+
+// Index (bit number) and name of a one-hot cpu_state value of picorv32.v
+static const char* const cpu_state_names[9] = {"ldmem", "stmem", "shift", "exec", "ld_rs2", "ld_rs1", "fetch", "trap", "invalid"};
+
+static int cpu_state_index(uint8_t state) {
+    for (int i = 0; i < 8; i++)
+        if (state == (1 << i))
+            return i;
+    return 8;
+}
+
+static const char* cpu_state_name(uint8_t state) {
+    return cpu_state_names[cpu_state_index(state)];
+}
+
+// Lightweight functional coverage (--coverage=FILE), meant for picking a
+// small regression subset with the same coverage (see scripts/covmin):
+//  - state:  cpu_state transitions per instruction mnemonic
+//  - branch: direction (taken/not-taken) and offset sign per branch mnemonic
+//  - irq:    instruction classes in flight while an unmasked IRQ is pending,
+//            and classes retired right before an IRQ is taken
+//  - stall:  memory wait states per access kind (fetch/load/store), bucketed
+// The file has one "<count> <bin>" line per bin that was hit. While running,
+// bins are packed integer keys (kind, mnemonic id, two small fields); the
+// strings are only formatted in write().
+class Coverage {
+private:
+    enum BinKind { BIN_STATE, BIN_BRANCH, BIN_IRQ_PENDING, BIN_IRQ_TAKEN, BIN_STALL };
+
+    std::unordered_map<uint64_t, uint64_t> bins;
+    std::vector<const char*> mnemonics;             // mnemonic id -> name
+    std::unordered_map<const char*, uint16_t> mnemonic_ids;
+    uint32_t last_insn;
+    bool last_insn_valid;
+    uint16_t last_mnemonic;
+    InsnClass last_cls;
+    uint8_t last_state;
+    InsnClass last_retired;
+    int stall_kind;
+    uint64_t stall_cycles;
+
+    static uint64_t key(BinKind kind, uint32_t mnemonic, uint32_t a, uint32_t b) {
+        return (uint64_t)kind << 48 | (uint64_t)mnemonic << 16 | a << 8 | b;
+    }
+
+    void hit(BinKind kind, uint32_t mnemonic, uint32_t a, uint32_t b) {
+        bins[key(kind, mnemonic, a, b)]++;
+    }
+
+    // decode_insn() returns string literals, so the name pointer identifies the mnemonic
+    uint16_t mnemonic_id(const char* name) {
+        auto it = mnemonic_ids.find(name);
+        if (it != mnemonic_ids.end())
+            return it->second;
+        mnemonics.push_back(name);
+        return mnemonic_ids[name] = mnemonics.size() - 1;
+    }
+
+    static int stall_bucket(uint64_t cycles) {
+        return cycles < 2 ? 0 : cycles < 4 ? 1 : cycles < 8 ? 2 : cycles < 16 ? 3 : 4;
+    }
+
+    void end_stall() {
+        hit(BIN_STALL, 0, stall_kind, stall_bucket(stall_cycles));
+        stall_kind = 0;
+        stall_cycles = 0;
+    }
+
+    std::string bin_name(uint64_t k) const {
+        static const char* const stall_kinds[4] = {"none", "fetch", "load", "store"};
+        static const char* const stall_buckets[5] = {"1", "2-3", "4-7", "8-15", "16+"};
+        uint32_t mnemonic = (k >> 16) & 0xffffffff, a = (k >> 8) & 0xff, b = k & 0xff;
+        switch ((BinKind)(k >> 48)) {
+        case BIN_STATE:
+            return std::string("state ") + mnemonics[mnemonic] + " " + cpu_state_names[a] + ">" + cpu_state_names[b];
+        case BIN_BRANCH:
+            return std::string("branch ") + mnemonics[mnemonic] + (a ? " taken" : " not-taken") +
+                   (b ? " backward" : " forward");
+        case BIN_IRQ_PENDING:
+            return std::string("irq ") + insn_class_names[a] + " pending";
+        case BIN_IRQ_TAKEN:
+            return std::string("irq ") + insn_class_names[a] + " taken";
+        case BIN_STALL:
+            return std::string("stall ") + stall_kinds[a] + " " + stall_buckets[b];
+        }
+        return "";
+    }
+
+public:
+    Coverage() : last_insn(0), last_insn_valid(false), last_mnemonic(0), last_cls(CLS_UNKNOWN),
+                 last_state(0), last_retired(CLS_UNKNOWN), stall_kind(0), stall_cycles(0) {}
+
+    // Called once per clock cycle
+    void cycle(const Vpicorv32_wrapper_picorv32_wrapper* w) {
+        uint8_t state = w->cov_cpu_state;
+        if (w->cov_insn_valid) {
+            // The instruction in flight stays the same for several cycles
+            if (!last_insn_valid || w->cov_insn != last_insn) {
+                InsnInfo info = decode_insn(w->cov_insn);
+                last_insn = w->cov_insn;
+                last_insn_valid = true;
+                last_mnemonic = mnemonic_id(info.name);
+                last_cls = info.cls;
+            }
+            if (last_state && state != last_state)
+                hit(BIN_STATE, last_mnemonic, cpu_state_index(last_state), cpu_state_index(state));
+            if (w->cov_irq_pending)
+                hit(BIN_IRQ_PENDING, 0, last_cls, 0);
+        }
+        last_state = state;
+
+        int kind = w->cov_mem_stall;
+        if (stall_kind && kind != stall_kind)
+            end_stall();
+        if (kind) {
+            stall_kind = kind;
+            stall_cycles++;
+        }
+    }
+
+    // Called for each committed instruction
+    void commit(const CommitRecord& c) {
+        InsnInfo info = decode_insn(c.insn);
+        if (c.intr)
+            hit(BIN_IRQ_TAKEN, 0, last_retired, 0);
+        last_retired = info.cls;
+
+        if (info.cls == CLS_BRANCH) {
+            bool compressed = (c.insn & 3) != 3;
+            bool taken = c.pc_wdata != c.pc_rdata + (compressed ? 2 : 4);
+            bool backward = compressed ? (c.insn & 0x1000) : (c.insn & 0x80000000);
+            hit(BIN_BRANCH, mnemonic_id(info.name), taken, backward);
+        }
+    }
+
+    size_t size() const { return bins.size(); }
+
+    bool write(const char* filename, const char* elf_file, uint64_t cycles, uint64_t instret) {
+        if (stall_kind)
+            end_stall();
+        FILE* f = fopen(filename, "w");
+        if (!f) {
+            fprintf(stderr, "Error: Cannot open coverage file '%s'\n", filename);
             return false;
         }
+        std::vector<std::pair<std::string, uint64_t>> sorted;
+        for (auto& bin : bins)
+            sorted.push_back(std::make_pair(bin_name(bin.first), bin.second));
+        std::sort(sorted.begin(), sorted.end());
+        fprintf(f, "# elf %s\n", elf_file);
+        fprintf(f, "# cycles %" PRIu64 " instret %" PRIu64 "\n", cycles, instret);
+        for (auto& bin : sorted)
+            fprintf(f, "%" PRIu64 " %s\n", bin.second, bin.first.c_str());
+        fclose(f);
+        return true;
+    }
+};
 
-        // Check for 32-bit RISC-V
-        if (ehdr->e_ident[EI_CLASS] != ELFCLASS32) {
-            fprintf(stderr, "Error: Only 32-bit ELF files are supported\n");
+// Estimated issue pairs of a dual-issue front end that fetches an aligned
+// 8-byte block at a time. picorv32 has no such core, the count only tells
+// how much a program could gain from one. The pairing rule:
+//  - the first instruction starts the block and is lui, auipc or a 32-bit
+//    register/immediate ALU instruction other than a shift (add, sub, slt,
+//    sltu, xor, or, and and their immediate forms; no czero)
+//  - the second one is the next word of the block and is such an
+//    instruction or a branch whose offset is a multiple of 4
+//  - the second one neither reads nor writes the rd of the first one
+// RVC instructions never pair. Pairs are formed greedily in commit order
+// and an IRQ entry breaks a pair. scripts/whatif (dual_issue) uses the same
+// rule for its cycle estimate.
+class PairCounter {
+private:
+    CommitRecord first;
+    bool have_first;
+
+    enum { SLOT_NONE, SLOT_ALU, SLOT_BRANCH };
+
+    static int slot(uint32_t insn) {
+        uint32_t opcode = insn & 0x7f, f3 = (insn >> 12) & 7, f7 = insn >> 25;
+        if (opcode == 0x37 || opcode == 0x17)
+            return SLOT_ALU;
+        if (opcode == 0x13 && (f3 & 3) != 1)
+            return SLOT_ALU;
+        if (opcode == 0x33 && (f3 & 3) != 1 && (f7 == 0 || (f7 == 0x20 && f3 == 0)))
+            return SLOT_ALU;
+        if (opcode == 0x63 && (f3 >> 1) != 1 && !(insn & 0x100))
+            return SLOT_BRANCH;
+        return SLOT_NONE;
+    }
+
+    bool pairs_with(const CommitRecord& c, int s) const {
+        if (c.intr || c.trap || s == SLOT_NONE)
+            return false;
+        if (c.pc_rdata != first.pc_rdata + 4 || first.pc_wdata != c.pc_rdata)
             return false;
+        return !first.rd_addr || (c.rs1_addr != first.rd_addr && c.rs2_addr != first.rd_addr &&
+                                  c.rd_addr != first.rd_addr);
+    }
+
+public:
+    uint64_t alu_alu, alu_branch;
+
+    PairCounter() : have_first(false), alu_alu(0), alu_branch(0) {}
+
+    // Called for each committed instruction
+    void commit(const CommitRecord& c) {
+        int s = slot(c.insn);
+        if (have_first && pairs_with(c, s)) {
+            (s == SLOT_BRANCH ? alu_branch : alu_alu)++;
+            have_first = false;
+            return;
+        }
+        first = c;
+        have_first = s == SLOT_ALU && !(c.pc_rdata & 7) && !c.trap;
+    }
+
+    void print(uint64_t instret) const {
+        uint64_t pairs = alu_alu + alu_branch;
+        printf("  Issue pairs (estimate): %" PRIu64 " (%.1f%% of instructions; alu/alu %" PRIu64 ", alu/branch %" PRIu64 ")\n",
+               pairs, instret ? 200.0 * pairs / instret : 0.0, alu_alu, alu_branch);
+    }
+};
+
+// Timeline trace (--timeline=FILE) in the Chrome trace event JSON format,
+// for ui.perfetto.dev or chrome://tracing. One clock cycle is shown as one
+// microsecond. Tracks (threads of one process):
+//  - functions: calls (jal/jalr writing ra or t0) to returns (jalr through ra
+//               or t0), named after the ELF function symbols, with IRQ
+//               handlers from IRQ entry to retirq as "irq" slices
+//  - cpu_state: one slice per run of cycles in the same cpu_state
+//  - memory:    transfers on the native memory interface, from mem_valid to
+//               mem_ready, so the slice length is the latency
+//  - console:   one instant event per line written to 0x1000_0000
+// Slices still open at the end of the simulation are closed there.
+class TimelineWriter {
+private:
+    enum { TID_FUNCTIONS = 1, TID_CPU_STATE, TID_MEMORY, TID_CONSOLE };
+
+    struct Function {
+        std::string name;
+        uint32_t size;
+    };
+
+    struct Frame {
+        std::string name;
+        uint64_t begin;
+        bool irq;
+    };
+
+    FILE* f;
+    bool first_event;
+    std::map<uint32_t, Function> functions;
+    std::vector<Frame> frames;
+    uint8_t state;
+    uint64_t state_begin;
+    bool mem_pending;
+    uint64_t mem_begin;
+    std::string console_line;
+
+    static std::string json_escape(const std::string& s) {
+        std::string r;
+        for (unsigned char ch : s) {
+            if (ch == '"' || ch == '\\') {
+                r += '\\';
+                r += ch;
+            } else if (ch < 0x20 || ch >= 0x7f) {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", ch);
+                r += buf;
+            } else {
+                r += ch;
+            }
         }
+        return r;
+    }
 
-        if (ehdr->e_machine != EM_RISCV) {
-            fprintf(stderr, "Warning: ELF file is not for RISC-V (machine type: %d)\n", ehdr->e_machine);
+    void begin_event() {
+        fprintf(f, first_event ? "\n" : ",\n");
+        first_event = false;
+    }
+
+    void slice(int tid, const std::string& name, uint64_t begin, uint64_t end, const char* args = nullptr) {
+        if (!enabled)
+            return;
+        begin_event();
+        fprintf(f, "{\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"name\":\"%s\",\"ts\":%" PRIu64 ",\"dur\":%" PRIu64 "%s%s%s}",
+                tid, json_escape(name).c_str(), begin, end > begin ? end - begin : 1,
+                args ? ",\"args\":{" : "", args ? args : "", args ? "}" : "");
+        events++;
+    }
+
+    void thread_name(int tid, const char* name) {
+        begin_event();
+        fprintf(f, "{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":\"%s\"}},\n", tid, name);
+        fprintf(f, "{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"thread_sort_index\",\"args\":{\"sort_index\":%d}}", tid, tid);
+    }
+
+    std::string function_name(uint32_t addr) const {
+        auto it = functions.upper_bound(addr);
+        if (it != functions.begin()) {
+            --it;
+            if (it->first == addr || addr - it->first < it->second.size)
+                return it->second.name;
         }
+        char buf[16];
+        snprintf(buf, sizeof(buf), "0x%08x", addr);
+        return buf;
+    }
 
-        // Initialize memory to zero
-        memset(memory, 0, MEM_SIZE);
+    void pop_frame(uint64_t cycle) {
+        slice(TID_FUNCTIONS, frames.back().name, frames.back().begin, cycle);
+        frames.pop_back();
+    }
 
-        printf("Loading ELF file: %s\n", filename);
-        printf("Entry point: 0x%08x\n", ehdr->e_entry);
+public:
+    bool enabled;       // cleared outside of ROIs with --roi-only
+    uint64_t events;
 
-        // Load program headers
-        Elf32_Phdr* phdr = (Elf32_Phdr*)((char*)mapped_file + ehdr->e_phoff);
-        for (int i = 0; i < ehdr->e_phnum; i++) {
-            if (phdr[i].p_type == PT_LOAD) {
-                uint32_t paddr = phdr[i].p_paddr;
-                uint32_t vaddr = phdr[i].p_vaddr;
-                uint32_t filesz = phdr[i].p_filesz;
-                uint32_t memsz = phdr[i].p_memsz;
-                uint32_t offset = phdr[i].p_offset;
+    TimelineWriter() : f(nullptr), first_event(true), state(0), state_begin(0), mem_pending(false), mem_begin(0),
+                       enabled(true), events(0) {}
 
-                // Use physical address if available, otherwise virtual address
-                uint32_t load_addr = (paddr != 0) ? paddr : vaddr;
+    ~TimelineWriter() {
+        if (f)
+            fclose(f);
+    }
 
-                printf("  Segment %d: addr=0x%08x size=0x%08x (file=0x%08x)\n", 
-                       i, load_addr, memsz, filesz);
+    bool open(const char* filename, const ElfLoader& loader) {
+        f = fopen(filename, "w");
+        if (!f)
+            return false;
+        loader.for_each_function([this](const char* name, uint32_t value, uint32_t size) {
+            functions[value] = Function{name, size};
+        });
+        fprintf(f, "{\"displayTimeUnit\":\"ns\",\"otherData\":{\"time unit\":\"1 us = 1 clock cycle\"},\"traceEvents\":[");
+        begin_event();
+        fprintf(f, "{\"ph\":\"M\",\"pid\":1,\"name\":\"process_name\",\"args\":{\"name\":\"picorv32\"}}");
+        thread_name(TID_FUNCTIONS, "functions");
+        thread_name(TID_CPU_STATE, "cpu_state");
+        thread_name(TID_MEMORY, "memory");
+        thread_name(TID_CONSOLE, "console");
+        return true;
+    }
 
-                // Check bounds
-                if (load_addr >= MEM_SIZE || load_addr + memsz > MEM_SIZE) {
-                    fprintf(stderr, "Error: Segment %d exceeds memory bounds (0x%08x + 0x%08x > 0x%08x)\n",
-                            i, load_addr, memsz, MEM_SIZE);
-                    return false;
-                }
+    // Called for each committed instruction
+    void commit(const CommitRecord& c) {
+        InsnInfo info = decode_insn(c.insn);
+        if (c.intr)
+            frames.push_back(Frame{"irq", c.cycle, true});
 
-                // Copy file data
-                if (filesz > 0) {
-                    uint8_t* src = (uint8_t*)mapped_file + offset;
-                    uint8_t* dst = (uint8_t*)memory + load_addr;
-                    memcpy(dst, src, filesz);
-                }
+        if (info.cls == CLS_JUMP) {
+            bool link = c.rd_addr == 1 || c.rd_addr == 5;
+            bool through_link = c.rs1_addr == 1 || c.rs1_addr == 5;
+            bool indirect = strcmp(info.name, "jalr") == 0 || strcmp(info.name, "c.jr") == 0 ||
+                            strcmp(info.name, "c.jalr") == 0;
+            if (!link && indirect && through_link) {
+                // Return: never past the IRQ slice the call was made in
+                if (!frames.empty() && !frames.back().irq)
+                    pop_frame(c.cycle);
+            } else if (link) {
+                frames.push_back(Frame{function_name(c.pc_wdata), c.cycle, false});
+            }
+        } else if (strcmp(info.name, "retirq") == 0) {
+            while (!frames.empty() && !frames.back().irq)
+                pop_frame(c.cycle);
+            if (!frames.empty())
+                pop_frame(c.cycle);
+        }
 
-                // Zero out BSS (memsz > filesz)
-                if (memsz > filesz) {
-                    uint8_t* dst = (uint8_t*)memory + load_addr + filesz;
-                    memset(dst, 0, memsz - filesz);
+        if (c.mem_wmask && c.mem_addr == 0x10000000) {
+            char ch = c.mem_wdata & 0xff;
+            if (ch == '\n') {
+                if (enabled) {
+                    begin_event();
+                    fprintf(f, "{\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%d,\"name\":\"%s\",\"ts\":%" PRIu64 "}",
+                            TID_CONSOLE, json_escape(console_line).c_str(), c.cycle);
+                    events++;
                 }
+                console_line.clear();
+            } else {
+                console_line += ch;
             }
         }
+    }
+
+    // Called once per clock cycle, after the positive edge
+    void cycle(const Vpicorv32_wrapper_picorv32_wrapper* w, uint64_t now) {
+        uint8_t s = w->cov_cpu_state;
+        if (s != state) {
+            if (state)
+                slice(TID_CPU_STATE, cpu_state_name(state), state_begin, now);
+            state = s;
+            state_begin = now;
+        }
+    }
 
-        printf("ELF loaded successfully\n\n");
-        return true;
+    // Called once per clock cycle, before the positive edge (like memtrace)
+    void memory(const Vpicorv32_wrapper_picorv32_wrapper* w, uint64_t now) {
+        if (w->mem_xfer_valid && !mem_pending) {
+            mem_pending = true;
+            mem_begin = now;
+        }
+        if (w->mem_xfer) {
+            char args[64];
+            snprintf(args, sizeof(args), "\"addr\":\"0x%08x\",\"latency\":%" PRIu64, w->mem_xfer_addr, now - mem_begin + 1);
+            slice(TID_MEMORY, w->mem_xfer_instr ? "fetch" : w->mem_xfer_wstrb ? "store" : "load",
+                  mem_begin, now + 1, args);
+            mem_pending = false;
+        }
+    }
+
+    void finish(uint64_t now) {
+        while (!frames.empty())
+            pop_frame(now);
+        if (state)
+            slice(TID_CPU_STATE, cpu_state_name(state), state_begin, now);
+        fprintf(f, "\n]}\n");
+        fclose(f);
+        f = nullptr;
     }
 };
 
@@ -140,11 +1235,29 @@ void print_usage(const char* prog) {
     fprintf(stderr, "  +trace            Generate instruction trace (testbench.trace)\n");
     fprintf(stderr, "  +verbose          Enable verbose output\n");
     fprintf(stderr, "  --timeout=N       Set simulation timeout in cycles (default: 1000000)\n");
+    fprintf(stderr, "  --hash-interval=K Write architectural state hash every K instructions\n");
+    fprintf(stderr, "  --hash-file=FILE  Output file for state hashes (default: testbench.hash)\n");
+    fprintf(stderr, "  --hash-window=A:B Only hash/log instructions A..B-1, stop after B\n");
+    fprintf(stderr, "  --commit-log=FILE Log every committed instruction (RVFI) to FILE\n");
+    fprintf(stderr, "  --rvfi-log=FILE   Record the commit stream to FILE (columnar, compressed, see scripts/rvfilog)\n");
+    fprintf(stderr, "  --idle-skip       Fast-forward over cycles spent idle in waitirq\n");
+    fprintf(stderr, "  --signature=FILE  At halt, dump the begin_signature..end_signature region to FILE\n");
+    fprintf(stderr, "  --coverage=FILE   Write functional coverage bins to FILE\n");
+    fprintf(stderr, "  --memtrace=FILE   Record every memory transfer to FILE (binary, see scripts/cachesim)\n");
+    fprintf(stderr, "  --blkdev=FILE     Back the block device at 0x30000000 with FILE\n");
+    fprintf(stderr, "  --timeline=FILE   Write a timeline trace to FILE (JSON, for ui.perfetto.dev)\n");
+    fprintf(stderr, "  --roi-only[=ID]   Only write VCD, trace, commit/RVFI log, memtrace and timeline inside ROIs (with ID)\n");
+    fprintf(stderr, "  --hang            Stop early on hangs and livelocks (exit code 3)\n");
+    fprintf(stderr, "  --hang-selfloop=N     ... after N iterations of a jump to itself (default: 16)\n");
+    fprintf(stderr, "  --hang-noretire=N     ... after N cycles without retirement (default: 100000)\n");
+    fprintf(stderr, "  --hang-statehash=N    ... on a repeated state, sampled every N instructions (default: 100000)\n");
+    fprintf(stderr, "  --hang-noprogress=N   ... after N instructions without output or memory change (default: 100000000)\n");
     fprintf(stderr, "  -h, --help        Show this help message\n\n");
     fprintf(stderr, "Examples:\n");
     fprintf(stderr, "  %s firmware/firmware.elf\n", prog);
     fprintf(stderr, "  %s +vcd +trace program.elf\n", prog);
     fprintf(stderr, "  %s --timeout=5000000 dhrystone.elf\n", prog);
+    fprintf(stderr, "  %s --hash-interval=10000 firmware/firmware.elf\n", prog);
 }
 
 int main(int argc, char **argv, char **env)
@@ -155,6 +1268,23 @@ int main(int argc, char **argv, char **env)
     // Parse command line arguments
     const char* elf_file = nullptr;
     int timeout_cycles = 1000000;
+    uint64_t hash_interval = 0;
+    const char* hash_file = "testbench.hash";
+    uint64_t window_begin = 0;
+    uint64_t window_end = UINT64_MAX;
+    const char* commit_log_file = nullptr;
+    const char* rvfi_log_file = nullptr;
+    bool idle_skip = false;
+    const char* signature_file = nullptr;
+    const char* coverage_file = nullptr;
+    const char* memtrace_file = nullptr;
+    const char* blkdev_file = nullptr;
+    const char* timeline_file = nullptr;
+    bool roi_only = false;
+    RoiTracker roi;
+    PairCounter pairs;
+    bool hang_defaults = false;
+    HangDetector hang;
     
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
@@ -166,6 +1296,53 @@ int main(int argc, char **argv, char **env)
                 fprintf(stderr, "Error: Invalid timeout value\n");
                 return 1;
             }
+        } else if (strncmp(argv[i], "--hash-interval=", 16) == 0) {
+            hash_interval = strtoull(argv[i] + 16, nullptr, 0);
+            if (hash_interval == 0) {
+                fprintf(stderr, "Error: Invalid hash interval\n");
+                return 1;
+            }
+        } else if (strncmp(argv[i], "--hash-file=", 12) == 0) {
+            hash_file = argv[i] + 12;
+        } else if (strncmp(argv[i], "--hash-window=", 14) == 0) {
+            char* end;
+            window_begin = strtoull(argv[i] + 14, &end, 0);
+            if (*end != ':' || (window_end = strtoull(end + 1, nullptr, 0)) <= window_begin) {
+                fprintf(stderr, "Error: Invalid hash window (expected A:B with A < B)\n");
+                return 1;
+            }
+        } else if (strncmp(argv[i], "--commit-log=", 13) == 0) {
+            commit_log_file = argv[i] + 13;
+        } else if (strncmp(argv[i], "--rvfi-log=", 11) == 0) {
+            rvfi_log_file = argv[i] + 11;
+        } else if (strcmp(argv[i], "--idle-skip") == 0) {
+            idle_skip = true;
+        } else if (strncmp(argv[i], "--signature=", 12) == 0) {
+            signature_file = argv[i] + 12;
+        } else if (strncmp(argv[i], "--coverage=", 11) == 0) {
+            coverage_file = argv[i] + 11;
+        } else if (strncmp(argv[i], "--memtrace=", 11) == 0) {
+            memtrace_file = argv[i] + 11;
+        } else if (strncmp(argv[i], "--blkdev=", 9) == 0) {
+            blkdev_file = argv[i] + 9;
+        } else if (strncmp(argv[i], "--timeline=", 11) == 0) {
+            timeline_file = argv[i] + 11;
+        } else if (strcmp(argv[i], "--roi-only") == 0) {
+            roi_only = true;
+        } else if (strncmp(argv[i], "--roi-only=", 11) == 0) {
+            roi_only = true;
+            roi.filter = true;
+            roi.filter_id = strtoul(argv[i] + 11, nullptr, 0);
+        } else if (strcmp(argv[i], "--hang") == 0) {
+            hang_defaults = true;
+        } else if (strncmp(argv[i], "--hang-selfloop=", 16) == 0) {
+            hang.selfloop_limit = strtoull(argv[i] + 16, nullptr, 0);
+        } else if (strncmp(argv[i], "--hang-noretire=", 16) == 0) {
+            hang.noretire_limit = strtoull(argv[i] + 16, nullptr, 0);
+        } else if (strncmp(argv[i], "--hang-statehash=", 17) == 0) {
+            hang.statehash_interval = strtoull(argv[i] + 17, nullptr, 0);
+        } else if (strncmp(argv[i], "--hang-noprogress=", 18) == 0) {
+            hang.noprogress_limit = strtoull(argv[i] + 18, nullptr, 0);
         } else if (argv[i][0] == '+') {
             // Verilator plusargs - will be handled by Verilated::commandArgs
             continue;
@@ -194,23 +1371,38 @@ int main(int argc, char **argv, char **env)
     Vpicorv32_wrapper* top = new Vpicorv32_wrapper;
 
     // Load ELF file into memory
-    printf("Loading ELF: %s\n", elf_file);
+    printf("Loading program: %s\n", elf_file);
     ElfLoader loader;
-    if (!loader.load(elf_file, top->picorv32_wrapper->mem->memory.data())) {
+    if (!loader.load_image(elf_file, top->picorv32_wrapper->mem->memory.data(), MEM_SIZE)) {
         fprintf(stderr, "Failed to load ELF file\n");
         delete top;
         return 1;
     }
 
-    // Setup VCD tracing
+    uint32_t signature_begin;
+    if (signature_file && !loader.find_symbol("begin_signature", &signature_begin)) {
+        fprintf(stderr, "Error: --signature needs begin_signature/end_signature symbols in the ELF file\n");
+        delete top;
+        return 1;
+    }
+
+    // Setup VCD tracing (not in testbench_cli_fast, which is built without --trace)
+#if VM_TRACE
     VerilatedVcdC* tfp = NULL;
+#endif
     const char* flag_vcd = Verilated::commandArgsPlusMatch("vcd");
     if (flag_vcd && 0==strcmp(flag_vcd, "+vcd")) {
+#if VM_TRACE
         Verilated::traceEverOn(true);
         tfp = new VerilatedVcdC;
         top->trace(tfp, 99);
         tfp->open("testbench.vcd");
         printf("VCD tracing enabled -> testbench.vcd\n");
+#else
+        fprintf(stderr, "Error: +vcd needs a model built with --trace (make testbench_cli)\n");
+        delete top;
+        return 1;
+#endif
     }
 
     // Setup instruction trace
@@ -223,6 +1415,119 @@ int main(int argc, char **argv, char **env)
         }
     }
 
+    // Setup state hash and commit log
+    FILE *hash_fd = NULL;
+    if (hash_interval) {
+        hash_fd = fopen(hash_file, "w");
+        if (!hash_fd) {
+            fprintf(stderr, "Error: Cannot open hash file '%s'\n", hash_file);
+            delete top;
+            return 1;
+        }
+        printf("State hashing enabled (every %" PRIu64 " instructions) -> %s\n", hash_interval, hash_file);
+    }
+
+    FILE *commit_fd = NULL;
+    if (commit_log_file) {
+        commit_fd = fopen(commit_log_file, "w");
+        if (!commit_fd) {
+            fprintf(stderr, "Error: Cannot open commit log '%s'\n", commit_log_file);
+            delete top;
+            return 1;
+        }
+        fprintf(commit_fd, "# order cycle pc insn rs1 rs2 rd mem_addr rmask wmask rdata wdata next_pc flags\n");
+        printf("Commit log enabled -> %s\n", commit_log_file);
+    }
+
+    RvfiLogWriter* rvfi_log = NULL;
+    if (rvfi_log_file) {
+        rvfi_log = new RvfiLogWriter;
+        if (!rvfi_log->open(rvfi_log_file)) {
+            fprintf(stderr, "Error: Cannot open RVFI log '%s'\n", rvfi_log_file);
+            delete rvfi_log;
+            delete top;
+            return 1;
+        }
+        printf("RVFI log enabled -> %s\n", rvfi_log_file);
+    }
+
+    // Setup hang detection
+    if (hang_defaults)
+        hang.enable_defaults();
+    ArchState* state = NULL;
+    if (hang.enabled()) {
+        state = new ArchState;
+        state->init(top->picorv32_wrapper->mem->memory.data());
+        printf("Hang detection enabled (selfloop=%" PRIu64 " noretire=%" PRIu64 " statehash=%" PRIu64 " noprogress=%" PRIu64 ")\n",
+               hang.selfloop_limit, hang.noretire_limit, hang.statehash_interval, hang.noprogress_limit);
+    }
+
+    // Setup memory trace
+    MemTraceWriter* memtrace = NULL;
+    if (memtrace_file) {
+        memtrace = new MemTraceWriter;
+        if (!memtrace->open(memtrace_file)) {
+            fprintf(stderr, "Error: Cannot open memory trace '%s'\n", memtrace_file);
+            delete memtrace;
+            delete top;
+            return 1;
+        }
+        printf("Memory trace enabled -> %s\n", memtrace_file);
+    }
+
+    // Setup block device
+    BlockDevice* blkdev = NULL;
+    if (blkdev_file) {
+        blkdev = new BlockDevice;
+        if (!blkdev->open(blkdev_file)) {
+            delete blkdev;
+            delete top;
+            return 1;
+        }
+        blkdev->attach(top->picorv32_wrapper->mem);
+        printf("Block device enabled (%u blocks%s) <- %s\n", blkdev->size(),
+               blkdev->read_only() ? ", read-only" : "", blkdev_file);
+    }
+
+    // Setup timeline trace
+    TimelineWriter* timeline = NULL;
+    if (timeline_file) {
+        timeline = new TimelineWriter;
+        if (!timeline->open(timeline_file, loader)) {
+            fprintf(stderr, "Error: Cannot open timeline '%s'\n", timeline_file);
+            delete timeline;
+            delete top;
+            return 1;
+        }
+        printf("Timeline trace enabled -> %s\n", timeline_file);
+    }
+
+    // Setup coverage collection
+    Coverage* coverage = NULL;
+    if (coverage_file) {
+        coverage = new Coverage;
+        printf("Coverage collection enabled -> %s\n", coverage_file);
+    }
+
+    // Setup idle skipping
+    IdleSkipper* skipper = NULL;
+    if (idle_skip) {
+        const char* flag_axi_test = Verilated::commandArgsPlusMatch("axi_test");
+        if (flag_axi_test && 0==strcmp(flag_axi_test, "+axi_test")) {
+            // The random AXI delays advance every cycle, idle or not
+            printf("Idle skipping disabled by +axi_test\n");
+        } else {
+            skipper = new IdleSkipper;
+            if (!skipper->init()) {
+                fprintf(stderr, "Error: Idle skipping needs a model built with --vpi\n");
+                delete skipper;
+                delete top;
+                return 1;
+            }
+            printf("Idle skipping enabled\n");
+        }
+    }
+
     const char* flag_verbose = Verilated::commandArgsPlusMatch("verbose");
     bool verbose = (flag_verbose && 0==strcmp(flag_verbose, "+verbose"));
 
@@ -235,8 +1540,13 @@ int main(int argc, char **argv, char **env)
     int t = 0;
     int cycle = 0;
     bool timed_out = false;
+    bool window_done = false;
+    StateHasher hasher;
+    CommitReorder reorder;
+    uint64_t instret = 0;
+    auto sim_start = std::chrono::steady_clock::now();
 
-    while (!Verilated::gotFinish() && cycle < timeout_cycles) {
+    while (!Verilated::gotFinish() && cycle < timeout_cycles && !window_done && !hang.reason) {
         // Release reset after 200 time units
         if (t > 200)
             top->resetn = 1;
@@ -245,11 +1555,16 @@ int main(int argc, char **argv, char **env)
         top->clk = !top->clk;
         top->eval();
         
+        // Outside of ROIs nothing is traced with --roi-only
+        bool tracing = !roi_only || roi.inside();
+
+#if VM_TRACE
         // Dump waveform
-        if (tfp) tfp->dump(t);
+        if (tfp && tracing) tfp->dump(t);
+#endif
         
         // Log instruction trace
-        if (trace_fd && top->clk && top->resetn && top->trace_valid) {
+        if (trace_fd && tracing && top->clk && top->resetn && top->trace_valid) {
             fprintf(trace_fd, "%9.9lx\n", (unsigned long)top->trace_data);
         }
         
@@ -261,6 +1576,81 @@ int main(int argc, char **argv, char **env)
                 fflush(stdout);
             }
         }
+
+        // Hash and log committed instructions, in order
+        if (top->clk && top->picorv32_wrapper->rvfi_valid) {
+            CommitRecord sampled;
+            sampled.sample(top->picorv32_wrapper, cycle);
+            reorder.push(sampled);
+        }
+        CommitRecord commit;
+        while (top->clk && !window_done && reorder.pop(commit)) {
+            hasher.commit(commit);
+            instret = commit.order + 1;
+            roi.commit(commit, instret);
+            pairs.commit(commit);
+
+            if (commit.order >= window_begin && commit.order < window_end) {
+                if (commit_fd && (!roi_only || roi.inside()))
+                    commit.print(commit_fd);
+                if (rvfi_log && (!roi_only || roi.inside()))
+                    rvfi_log->write(commit.log_record());
+                if (hash_fd && instret % hash_interval == 0)
+                    fprintf(hash_fd, "%" PRIu64 " %016" PRIx64 "\n", instret, hasher.value());
+            }
+            if (instret >= window_end)
+                window_done = true;
+
+            if (coverage)
+                coverage->commit(commit);
+
+            if (timeline) {
+                timeline->enabled = !roi_only || roi.inside();
+                timeline->commit(commit);
+            }
+
+            if (state) {
+                bool progress = state->commit(commit);
+                hang.commit(commit, instret, progress, top->picorv32_wrapper->irqs_blocked, *state);
+            }
+        }
+
+        if (coverage && top->clk && top->resetn)
+            coverage->cycle(top->picorv32_wrapper);
+
+        if (timeline && top->clk && top->resetn) {
+            timeline->enabled = tracing;
+            timeline->cycle(top->picorv32_wrapper, cycle);
+        }
+
+        if (timeline && !top->clk && top->resetn) {
+            timeline->enabled = tracing;
+            timeline->memory(top->picorv32_wrapper, cycle);
+        }
+
+        if (blkdev && top->clk)
+            blkdev->poll(top->picorv32_wrapper->mem);
+
+        // Record memory transfers (sampled before the edge that completes them)
+        if (memtrace && tracing && !top->clk && top->resetn && top->picorv32_wrapper->mem_xfer) {
+            const Vpicorv32_wrapper_picorv32_wrapper* w = top->picorv32_wrapper;
+            MemTraceRecord r;
+            r.cycle = cycle;
+            r.addr = w->mem_xfer_addr;
+            r.kind = w->mem_xfer_instr ? MEMTRACE_FETCH : w->mem_xfer_wstrb ? MEMTRACE_STORE : MEMTRACE_LOAD;
+            r.wstrb = w->mem_xfer_wstrb;
+            memtrace->write(r);
+        }
+
+        if (state && top->clk && top->resetn)
+            hang.cycle(top->picorv32_wrapper->rvfi_valid, top->picorv32_wrapper->idle_waitirq);
+
+        // Jump over idle waitirq cycles
+        if (skipper && top->clk && top->resetn) {
+            uint64_t skipped = skipper->skip(top->picorv32_wrapper);
+            cycle += skipped;
+            t += 10 * skipped;
+        }
         
         t += 5;
     }
@@ -269,25 +1659,99 @@ int main(int argc, char **argv, char **env)
         timed_out = true;
     }
 
+    double sim_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - sim_start).count();
+
     // Cleanup
+#if VM_TRACE
     if (tfp) {
         tfp->close();
         delete tfp;
     }
+#endif
     if (trace_fd) {
         fclose(trace_fd);
     }
+    if (hash_fd) {
+        // Final state, so that runs of different length can be told apart
+        if (instret > window_begin)
+            fprintf(hash_fd, "%" PRIu64 " %016" PRIx64 " end\n", instret, hasher.value());
+        fclose(hash_fd);
+    }
+    if (commit_fd) {
+        fclose(commit_fd);
+    }
+    uint64_t rvfi_log_records = 0;
+    if (rvfi_log) {
+        rvfi_log_records = rvfi_log->records;
+        delete rvfi_log;
+    }
+    uint64_t timeline_events = 0;
+    if (timeline) {
+        timeline->finish(cycle);
+        timeline_events = timeline->events;
+        delete timeline;
+    }
+    uint64_t memtrace_records = 0;
+    if (memtrace) {
+        memtrace_records = memtrace->records;
+        delete memtrace;
+    }
 
     printf("\n---------------------------------------------------\n");
     printf("Simulation finished:\n");
     printf("  Cycles: %d\n", cycle);
     printf("  Time: %d ns\n", t);
-    if (timed_out) {
+    printf("  Instructions: %" PRIu64 "\n", instret);
+    if (reorder.waiting())
+        printf("    (%zu later commits still waiting for an earlier one)\n", reorder.waiting());
+    if (sim_seconds > 0)
+        printf("  Speed: %.1f kHz (%.2f s)\n", cycle / sim_seconds / 1e3, sim_seconds);
+    pairs.print(instret);
+    size_t unfinished_rois = roi.finish(cycle, instret);
+    if (!roi.empty()) {
+        roi.print();
+        if (unfinished_rois)
+            printf("    (%zu ROIs still open at the end of the simulation)\n", unfinished_rois);
+    }
+    if (rvfi_log_file)
+        printf("  RVFI log records: %" PRIu64 "\n", rvfi_log_records);
+    if (memtrace_file)
+        printf("  Memory transfers: %" PRIu64 "\n", memtrace_records);
+    if (timeline_file)
+        printf("  Timeline events: %" PRIu64 "\n", timeline_events);
+    if (blkdev) {
+        printf("  Block device: %" PRIu64 " blocks read, %" PRIu64 " blocks written\n",
+               blkdev->blocks_read, blkdev->blocks_written);
+        delete blkdev;
+    }
+    if (skipper) {
+        printf("  Idle skipped: %" PRIu64 " cycles in %" PRIu64 " jumps\n",
+               skipper->skipped_cycles, skipper->jumps);
+        delete skipper;
+    }
+    int exit_code = timed_out ? 2 : 0;
+    if (coverage) {
+        if (coverage->write(coverage_file, elf_file, cycle, instret))
+            printf("  Coverage: %zu bins -> %s\n", coverage->size(), coverage_file);
+        else
+            exit_code = 1;
+        delete coverage;
+    }
+    if (signature_file && !dump_signature(signature_file, loader, top->picorv32_wrapper->mem->memory.data()))
+        exit_code = 1;
+    if (hang.reason) {
+        printf("  Status: HANG (%s)\n", hang.reason);
+        hang.print_snapshot(*state);
+        exit_code = HangDetector::EXIT_CODE;
+    } else if (window_done) {
+        printf("  Status: WINDOW END\n");
+    } else if (timed_out) {
         printf("  Status: TIMEOUT\n");
     } else {
         printf("  Status: FINISHED\n");
     }
 
+    delete state;
     delete top;
-    return timed_out ? 2 : 0;
+    return exit_code;
 }
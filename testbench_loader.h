@@ -0,0 +1,195 @@
+// Program loader shared by the Verilator testbenches (testbench_cli.cc,
+// testbench.cc, scripts/torture/testbench.cc). ELF files and raw binary
+// images are copied straight into the public memory array of the model
+// from an mmap of the file, so the Verilog side can be built with
+// -DNO_READMEMH and skip parsing a hex file at startup.
+
+#ifndef TESTBENCH_LOADER_H
+#define TESTBENCH_LOADER_H
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <elf.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+class ElfLoader {
+private:
+    void *mapped_file;
+    size_t file_size;
+    int fd;
+    bool raw_ok;
+
+    // Raw binary image (objcopy -O binary), loaded at address 0
+    bool load_raw(const char* filename, void* memory, size_t mem_size) {
+        if (file_size > mem_size) {
+            fprintf(stderr, "Error: Image '%s' exceeds memory size (0x%zx > 0x%zx)\n", filename, file_size, mem_size);
+            return false;
+        }
+        memcpy(memory, mapped_file, file_size);
+        memset((uint8_t*)memory + file_size, 0, mem_size - file_size);
+        if (!quiet)
+            printf("Loaded binary image: %s (%zu bytes)\n\n", filename, file_size);
+        return true;
+    }
+
+public:
+    bool quiet;     // no progress messages on stdout (errors still go to stderr)
+
+    ElfLoader() : mapped_file(nullptr), file_size(0), fd(-1), raw_ok(false), quiet(false) {}
+    
+    ~ElfLoader() {
+        if (mapped_file) {
+            munmap(mapped_file, file_size);
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    bool load(const char* filename, void* memory, size_t mem_size) {
+        // Open ELF file
+        fd = open(filename, O_RDONLY);
+        if (fd < 0) {
+            fprintf(stderr, "Error: Cannot open file '%s'\n", filename);
+            return false;
+        }
+
+        // Get file size
+        struct stat st;
+        if (fstat(fd, &st) < 0) {
+            fprintf(stderr, "Error: Cannot stat file '%s'\n", filename);
+            return false;
+        }
+        file_size = st.st_size;
+
+        // Memory map the file
+        mapped_file = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped_file == MAP_FAILED) {
+            fprintf(stderr, "Error: Cannot mmap file '%s'\n", filename);
+            return false;
+        }
+
+        // Check ELF magic
+        Elf32_Ehdr* ehdr = (Elf32_Ehdr*)mapped_file;
+        if (file_size < sizeof(Elf32_Ehdr) || memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0) {
+            if (raw_ok)
+                return load_raw(filename, memory, mem_size);
+            fprintf(stderr, "Error: '%s' is not a valid ELF file\n", filename);
+            return false;
+        }
+
+        // Check for 32-bit RISC-V
+        if (ehdr->e_ident[EI_CLASS] != ELFCLASS32) {
+            fprintf(stderr, "Error: Only 32-bit ELF files are supported\n");
+            return false;
+        }
+
+        if (ehdr->e_machine != EM_RISCV) {
+            fprintf(stderr, "Warning: ELF file is not for RISC-V (machine type: %d)\n", ehdr->e_machine);
+        }
+
+        // Initialize memory to zero
+        memset(memory, 0, mem_size);
+
+        if (!quiet) {
+            printf("Loading ELF file: %s\n", filename);
+            printf("Entry point: 0x%08x\n", ehdr->e_entry);
+        }
+
+        // Load program headers
+        Elf32_Phdr* phdr = (Elf32_Phdr*)((char*)mapped_file + ehdr->e_phoff);
+        for (int i = 0; i < ehdr->e_phnum; i++) {
+            if (phdr[i].p_type == PT_LOAD) {
+                uint32_t paddr = phdr[i].p_paddr;
+                uint32_t vaddr = phdr[i].p_vaddr;
+                uint32_t filesz = phdr[i].p_filesz;
+                uint32_t memsz = phdr[i].p_memsz;
+                uint32_t offset = phdr[i].p_offset;
+
+                // Use physical address if available, otherwise virtual address
+                uint32_t load_addr = (paddr != 0) ? paddr : vaddr;
+
+                if (!quiet)
+                    printf("  Segment %d: addr=0x%08x size=0x%08x (file=0x%08x)\n", 
+                       i, load_addr, memsz, filesz);
+
+                // Check bounds
+                if (load_addr >= mem_size || (uint64_t)load_addr + memsz > mem_size) {
+                    fprintf(stderr, "Error: Segment %d exceeds memory bounds (0x%08x + 0x%08x > 0x%08zx)\n",
+                            i, load_addr, memsz, mem_size);
+                    return false;
+                }
+
+                // Copy file data
+                if (filesz > 0) {
+                    uint8_t* src = (uint8_t*)mapped_file + offset;
+                    uint8_t* dst = (uint8_t*)memory + load_addr;
+                    memcpy(dst, src, filesz);
+                }
+
+                // Zero out BSS (memsz > filesz)
+                if (memsz > filesz) {
+                    uint8_t* dst = (uint8_t*)memory + load_addr + filesz;
+                    memset(dst, 0, memsz - filesz);
+                }
+            }
+        }
+
+        if (!quiet)
+            printf("ELF loaded successfully\n\n");
+        return true;
+    }
+
+    // Load an ELF file, or anything else as a raw binary image
+    bool load_image(const char* filename, void* memory, size_t mem_size) {
+        raw_ok = true;
+        return load(filename, memory, mem_size);
+    }
+
+    // Look up a symbol in the symbol table of the loaded ELF file
+    bool find_symbol(const char* name, uint32_t* value) const {
+        if (!mapped_file || file_size < sizeof(Elf32_Ehdr) || memcmp(mapped_file, ELFMAG, SELFMAG) != 0)
+            return false;
+        Elf32_Ehdr* ehdr = (Elf32_Ehdr*)mapped_file;
+        Elf32_Shdr* shdr = (Elf32_Shdr*)((char*)mapped_file + ehdr->e_shoff);
+        for (int i = 0; i < ehdr->e_shnum; i++) {
+            if (shdr[i].sh_type != SHT_SYMTAB || shdr[i].sh_link >= ehdr->e_shnum)
+                continue;
+            Elf32_Sym* sym = (Elf32_Sym*)((char*)mapped_file + shdr[i].sh_offset);
+            const char* strtab = (const char*)mapped_file + shdr[shdr[i].sh_link].sh_offset;
+            int count = shdr[i].sh_size / sizeof(Elf32_Sym);
+            for (int j = 0; j < count; j++) {
+                if (strcmp(strtab + sym[j].st_name, name) == 0) {
+                    *value = sym[j].st_value;
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Call f(name, value, size) for each function symbol of the loaded ELF file
+    template <typename F>
+    void for_each_function(F f) const {
+        if (!mapped_file || file_size < sizeof(Elf32_Ehdr) || memcmp(mapped_file, ELFMAG, SELFMAG) != 0)
+            return;
+        Elf32_Ehdr* ehdr = (Elf32_Ehdr*)mapped_file;
+        Elf32_Shdr* shdr = (Elf32_Shdr*)((char*)mapped_file + ehdr->e_shoff);
+        for (int i = 0; i < ehdr->e_shnum; i++) {
+            if (shdr[i].sh_type != SHT_SYMTAB || shdr[i].sh_link >= ehdr->e_shnum)
+                continue;
+            Elf32_Sym* sym = (Elf32_Sym*)((char*)mapped_file + shdr[i].sh_offset);
+            const char* strtab = (const char*)mapped_file + shdr[shdr[i].sh_link].sh_offset;
+            int count = shdr[i].sh_size / sizeof(Elf32_Sym);
+            for (int j = 0; j < count; j++)
+                if (ELF32_ST_TYPE(sym[j].st_info) == STT_FUNC)
+                    f(strtab + sym[j].st_name, (uint32_t)sym[j].st_value, (uint32_t)sym[j].st_size);
+        }
+    }
+};
+
+#endif
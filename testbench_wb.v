@@ -264,7 +264,7 @@ module wb_ram #(
 	end
 
 	always @(posedge wb_clk_i) begin
-		if (waddr2 < 128 * 1024 / 4) begin
+		if (waddr < 128 * 1024 / 4) begin
 			if (we[0])
 				mem[waddr2][7:0] <= wb_dat_i[7:0];
 